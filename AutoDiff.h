@@ -0,0 +1,196 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+// tangent directions carried by an active scalar: a jacobian takes one sweep per block of dualWidth columns
+constexpr size_t dualWidth = 8;
+
+// Forward-mode active scalar: carries a value and its tangent with respect to up to N input variables, inline
+// so that no operation allocates. A constant (inactive) scalar skips the tangent arithmetic, so that mixing
+// market data with calibrated variables costs nothing; its tangent stays zero.
+template <typename T, size_t N = dualWidth>
+class Dual
+{
+public:
+	using value_type = T;
+	static constexpr size_t width = N;
+
+	Dual() {}
+	Dual(T t_value)
+		: m_value(t_value)
+	{}
+
+	// seeds the tangent direction t_index (below N) with the variable
+	static Dual variable(T t_value, size_t t_index)
+	{
+		Dual result(t_value);
+		result.m_bActive = true;
+		result.m_tangent[t_index] = T(1);
+		return result;
+	}
+
+	T value() const
+	{
+		return m_value;
+	}
+	std::array<T, N> const& tangent() const
+	{
+		return m_tangent;
+	}
+	T tangent(size_t t_index) const
+	{
+		return m_tangent[t_index];
+	}
+
+	Dual& operator+=(Dual const& t_other)
+	{
+		m_value += t_other.m_value;
+		addScaled(t_other, T(1));
+		return *this;
+	}
+	Dual& operator-=(Dual const& t_other)
+	{
+		m_value -= t_other.m_value;
+		addScaled(t_other, T(-1));
+		return *this;
+	}
+	Dual& operator*=(Dual const& t_other)
+	{
+		scale(t_other.m_value);
+		addScaled(t_other, m_value);
+		m_value *= t_other.m_value;
+		return *this;
+	}
+	Dual& operator/=(Dual const& t_other)
+	{
+		T inverse = T(1) / t_other.m_value;
+		m_value *= inverse;
+		scale(inverse);
+		addScaled(t_other, -m_value * inverse);
+		return *this;
+	}
+
+	friend Dual operator-(Dual t_x)
+	{
+		t_x.m_value = -t_x.m_value;
+		t_x.scale(T(-1));
+		return t_x;
+	}
+
+	friend Dual operator+(Dual t_x, Dual const& t_y) { return t_x += t_y; }
+	friend Dual operator-(Dual t_x, Dual const& t_y) { return t_x -= t_y; }
+	friend Dual operator*(Dual t_x, Dual const& t_y) { return t_x *= t_y; }
+	friend Dual operator/(Dual t_x, Dual const& t_y) { return t_x /= t_y; }
+
+	friend Dual operator+(Dual t_x, T const& t_y) { t_x.m_value += t_y; return t_x; }
+	friend Dual operator+(T const& t_x, Dual t_y) { t_y.m_value += t_x; return t_y; }
+	friend Dual operator-(Dual t_x, T const& t_y) { t_x.m_value -= t_y; return t_x; }
+	friend Dual operator-(T const& t_x, Dual t_y) { t_y = -t_y; t_y.m_value += t_x; return t_y; }
+	friend Dual operator*(Dual t_x, T const& t_y) { t_x.m_value *= t_y; t_x.scale(t_y); return t_x; }
+	friend Dual operator*(T const& t_x, Dual t_y) { t_y.m_value *= t_x; t_y.scale(t_x); return t_y; }
+	friend Dual operator/(Dual t_x, T const& t_y) { return t_x * (T(1) / t_y); }
+	friend Dual operator/(T const& t_x, Dual t_y)
+	{
+		T inverse = T(1) / t_y.m_value;
+		t_y.scale(-t_x * inverse * inverse);
+		t_y.m_value = t_x * inverse;
+		return t_y;
+	}
+
+	friend bool operator<(Dual const& t_x, Dual const& t_y) { return t_x.m_value < t_y.m_value; }
+	friend bool operator>(Dual const& t_x, Dual const& t_y) { return t_x.m_value > t_y.m_value; }
+	friend bool operator<=(Dual const& t_x, Dual const& t_y) { return t_x.m_value <= t_y.m_value; }
+	friend bool operator>=(Dual const& t_x, Dual const& t_y) { return t_x.m_value >= t_y.m_value; }
+	friend bool operator==(Dual const& t_x, Dual const& t_y) { return t_x.m_value == t_y.m_value; }
+	friend bool operator!=(Dual const& t_x, Dual const& t_y) { return t_x.m_value != t_y.m_value; }
+
+	// d/dx f(x) = t_derivative, applied through the chain rule
+	Dual chain(T t_value, T t_derivative) const
+	{
+		Dual result = *this;
+		result.m_value = t_value;
+		result.scale(t_derivative);
+		return result;
+	}
+
+private:
+
+	void scale(T const& t_factor)
+	{
+		if (!m_bActive)
+		{
+			return;
+		}
+		for (size_t i = 0; i < N; i++)
+		{
+			m_tangent[i] *= t_factor;
+		}
+	}
+
+	void addScaled(Dual const& t_other, T const& t_factor)
+	{
+		if (!t_other.m_bActive)
+		{
+			return;
+		}
+		if (!m_bActive)
+		{
+			m_bActive = true;
+			for (size_t i = 0; i < N; i++)
+			{
+				m_tangent[i] = t_factor * t_other.m_tangent[i];
+			}
+			return;
+		}
+		for (size_t i = 0; i < N; i++)
+		{
+			m_tangent[i] += t_factor * t_other.m_tangent[i];
+		}
+	}
+
+	T m_value{};
+	bool m_bActive = false;
+	std::array<T, N> m_tangent{};
+};
+
+template <typename T, size_t N>
+Dual<T, N> exp(Dual<T, N> const& t_x)
+{
+	T value = std::exp(t_x.value());
+	return t_x.chain(value, value);
+}
+
+template <typename T, size_t N>
+Dual<T, N> log(Dual<T, N> const& t_x)
+{
+	return t_x.chain(std::log(t_x.value()), T(1) / t_x.value());
+}
+
+template <typename T, size_t N>
+Dual<T, N> sqrt(Dual<T, N> const& t_x)
+{
+	T value = std::sqrt(t_x.value());
+	return t_x.chain(value, T(0.5) / value);
+}
+
+template <typename T, size_t N>
+Dual<T, N> pow(Dual<T, N> const& t_x, T const& t_exponent)
+{
+	T value = std::pow(t_x.value(), t_exponent);
+	return t_x.chain(value, t_exponent * value / t_x.value());
+}
+
+// plain scalars and active scalars are read through the same helpers in the templated pricers
+template <typename T>
+T valueOf(T const& t_x)
+{
+	return t_x;
+}
+
+template <typename T, size_t N>
+T valueOf(Dual<T, N> const& t_x)
+{
+	return t_x.value();
+}
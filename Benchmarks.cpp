@@ -0,0 +1,1935 @@
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+#include <random>
+#include <sstream>
+
+#include "MarketData.h"
+#include "Exposure.h"
+#include "MultiCurve.h"
+#include "Snapshot.h"
+#include "QuoteLoader.h"
+#include "HistoricalCalibration.h"
+#include "Risk.h"
+#include "Scenario.h"
+#include "Instruments/HullWhite1Factor.h"
+#include "Bermudan.h"
+
+// Benchmarks of the pricers and calibrations, and the checks they make on their results, built as a program of
+// their own (the Benchmarks project): main runs them and returns non-zero when one of the checks fails.
+
+// heap allocations through the global operator new (and new[], which forwards to it), counted by the allocation
+// checks of the benchmarks. The storage comes from the aligned allocation functions, which are not replaced.
+// Replacing them here, in the benchmark program, leaves the allocation of any other program untouched.
+std::atomic<size_t> benchmarkAllocations{ 0 };
+
+void* operator new(std::size_t t_iSize)
+{
+    benchmarkAllocations.fetch_add(1, std::memory_order_relaxed);
+    return ::operator new(t_iSize, std::align_val_t(alignof(std::max_align_t)));
+}
+
+void operator delete(void* t_pPointer) noexcept
+{
+    ::operator delete(t_pPointer, std::align_val_t(alignof(std::max_align_t)));
+}
+
+void operator delete(void* t_pPointer, std::size_t) noexcept
+{
+    ::operator delete(t_pPointer, std::align_val_t(alignof(std::max_align_t)));
+}
+
+// OIS swaps of the market data on a curve of any scalar type
+auto benchmarkOISSwaps = [](auto& myCurve)
+{
+    std::vector<SwapOn<decltype(myCurve)>> mySwapVect;
+    for (size_t i = 0; i < maturitiesOIS.size(); i++)
+    {
+        int nbOfPayments = (int)(maturitiesOIS[i] > 1 ? maturitiesOIS[i] : 1);
+        SwapOn<decltype(myCurve)> swap(SwapType::PAYER, notional, strikesOIS[i], 0., 0., maturitiesOIS[i], nbOfPayments, myCurve);
+        mySwapVect.push_back(swap);
+    }
+    return mySwapVect;
+};
+
+YieldCurve benchmarkOISCurve(InterpolationType t_interpolationMethod = LOGLINEAR_ON_EXP_X_TIMES_Y)
+{
+    Stripper<Swap> bootstrappOIS(maturitiesOIS, initialRatesOIS, benchmarkOISSwaps, t_interpolationMethod);
+    bootstrappOIS.calibrate(SEQUENTIAL_BOOTSTRAP);
+
+    return bootstrappOIS.getZeroCoupon();
+}
+
+// discount factors on the OIS curve: the scalar interpolate template behind price(YieldCurve, t) against
+// the compiled curve, one point at a time and through the batched (vectorised when built for AVX2/AVX-512) kernel.
+// The compiled discount factors are checked against price(curve, t): returns 1 when one differs by more than
+// 1E-12 relatively.
+int benchmarkInterpolation(size_t t_size = 1000000)
+{
+    std::mt19937_64 generator(42);
+    std::uniform_real_distribution<Time> distribution(0., 55.);
+    std::vector<Time> times(t_size);
+    for (Time& time : times)
+    {
+        time = distribution(generator);
+    }
+    std::vector<Time> sortedTimes = times;
+    std::sort(sortedTimes.begin(), sortedTimes.end());
+
+    std::vector<Value> discounts(t_size);
+    std::vector<Value> reference(t_size);
+    std::vector<Value> sortedReference(t_size);
+    // largest relative difference of the discount factors just computed to the interpolated ones
+    auto largestDifference = [&](std::vector<Value> const& t_vdReference)
+    {
+        Value difference = 0.;
+        for (size_t i = 0; i < t_size; i++)
+        {
+            difference = std::max(difference, std::abs(discounts[i] / t_vdReference[i] - 1.));
+        }
+        return difference;
+    };
+    Value largest = 0.;
+    std::string methodNames[] = { "LINEAR_ON_Y", "LOGLINEAR_ON_Y", "LINEAR_ON_EXP_X_TIMES_Y", "LOGLINEAR_ON_EXP_X_TIMES_Y" };
+
+    std::cout << "\n*******************************************************************************************\n";
+    std::cout << "\nDiscount factors on the OIS curve, " << t_size << " random times, " << discountBatchInstructionSet << " kernel: " << "\n";
+
+    for (InterpolationType method : { LINEAR_ON_Y, LOGLINEAR_ON_Y, LINEAR_ON_EXP_X_TIMES_Y, LOGLINEAR_ON_EXP_X_TIMES_Y })
+    {
+        // LOGLINEAR_ON_Y needs positive rates, the OIS strip is negative at the short end
+        YieldCurve curve = method == LOGLINEAR_ON_Y
+            ? YieldCurve(maturitiesOIS, std::vector<Value>(maturitiesOIS.size(), 0.01), method)
+            : benchmarkOISCurve(method);
+        FrozenYieldCurve frozenCurve(curve);
+        Value checksum = 0.;
+        for (size_t i = 0; i < t_size; i++)
+        {
+            sortedReference[i] = price(curve, sortedTimes[i]);
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < t_size; i++)
+        {
+            reference[i] = price(curve, times[i]);
+        }
+        std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+        double scalarTemplate = std::chrono::duration<double, std::nano>(stop - start).count() / t_size;
+        checksum += reference.back();
+
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < t_size; i++)
+        {
+            discounts[i] = frozenCurve.discount(times[i]);
+        }
+        stop = std::chrono::steady_clock::now();
+        double scalarFrozen = std::chrono::duration<double, std::nano>(stop - start).count() / t_size;
+        checksum += discounts.back();
+        Value frozenDifference = largestDifference(reference);
+
+        start = std::chrono::steady_clock::now();
+        frozenCurve.discount(times.data(), discounts.data(), t_size);
+        stop = std::chrono::steady_clock::now();
+        double batchUnsorted = std::chrono::duration<double, std::nano>(stop - start).count() / t_size;
+        checksum += discounts.back();
+        Value batchDifference = largestDifference(reference);
+
+        start = std::chrono::steady_clock::now();
+        frozenCurve.discount(sortedTimes.data(), discounts.data(), t_size, true);
+        stop = std::chrono::steady_clock::now();
+        double batchSorted = std::chrono::duration<double, std::nano>(stop - start).count() / t_size;
+        checksum += discounts.back();
+        Value sortedDifference = largestDifference(sortedReference);
+        largest = std::max({ largest, frozenDifference, batchDifference, sortedDifference });
+
+        std::cout << methodNames[method] << ": interpolate " << scalarTemplate << " ns, frozen " << scalarFrozen
+            << " ns, batch " << batchUnsorted << " ns, sorted batch " << batchSorted << " ns per discount factor"
+            << " (checksum " << checksum << ")\n";
+        std::cout << "    largest relative difference to interpolate: frozen " << frozenDifference << ", batch " << batchDifference
+            << ", sorted batch " << sortedDifference << "\n";
+    }
+    std::cout << "\n*******************************************************************************************\n";
+
+    return largest > 1E-12 ? 1 : 0;
+}
+
+// random vanilla swaps of 1 to 30 years, paying annually, semi-annually or quarterly
+std::vector<Swap> benchmarkSwaps(size_t t_size, YieldCurve const& t_curve)
+{
+    std::mt19937_64 generator(42);
+    std::uniform_int_distribution<int> years(1, 30);
+    std::uniform_int_distribution<int> frequency(0, 2);
+    std::uniform_real_distribution<Value> strike(-0.01, 0.03);
+    int paymentsPerYear[] = { 1, 2, 4 };
+    std::vector<Swap> swaps;
+    for (size_t i = 0; i < t_size; i++)
+    {
+        int maturity = years(generator);
+        SwapType type = i % 2 ? PAYER : RECEIVER;
+        swaps.push_back(Swap(type, notional, strike(generator), 0., 0., maturity, maturity * paymentsPerYear[frequency(generator)], t_curve));
+    }
+    return swaps;
+}
+
+// book of random vanilla swaps on the OIS curve: one swap at a time on the compiled curve against the
+// structure-of-arrays portfolio priced in one pass
+int benchmarkSwapPortfolio(size_t t_size = 20000, size_t t_repetitions = 20)
+{
+    YieldCurve curve = benchmarkOISCurve();
+    FrozenYieldCurve frozenCurve(curve);
+
+    std::vector<Swap> swaps = benchmarkSwaps(t_size, curve);
+    SwapPortfolio portfolio(swaps);
+
+    SwapPricingBuffers buffers;
+    std::vector<Value> prices(t_size);
+    Value checksum = 0.;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < t_repetitions; r++)
+    {
+        for (size_t i = 0; i < t_size; i++)
+        {
+            prices[i] = price(swaps[i], frozenCurve, frozenCurve, 0., buffers);
+        }
+    }
+    std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+    double oneByOne = std::chrono::duration<double, std::milli>(stop - start).count() / t_repetitions;
+    checksum += prices.back();
+
+    start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < t_repetitions; r++)
+    {
+        price(portfolio, frozenCurve, frozenCurve, 0., prices.data(), buffers);
+    }
+    stop = std::chrono::steady_clock::now();
+    double book = std::chrono::duration<double, std::milli>(stop - start).count() / t_repetitions;
+    checksum += prices.back();
+
+    std::cout << "\n*******************************************************************************************\n";
+    std::cout << "\nBook of " << t_size << " swaps (" << portfolio.periods() << " periods, " << portfolio.dates().size()
+        << " distinct dates), " << discountBatchInstructionSet << " kernel: " << "\n";
+    std::cout << "swap by swap " << oneByOne << " ms, portfolio " << book << " ms per pricing of the book"
+        << " (checksum " << checksum << ")\n";
+    std::cout << "\n*******************************************************************************************\n";
+
+    return 0;
+}
+
+// heap allocations of price(Swap, FrozenYieldCurve, FrozenYieldCurve, t, SwapPricingBuffers&) once its buffers
+// are warm: the swaps priced unaged and aged (between payment dates), on one curve and on an OIS discount curve
+// with a distinct forward curve. Returns 1 when any allocation is counted.
+int benchmarkSwapAllocations(size_t t_size = 1000)
+{
+    YieldCurve curve = benchmarkOISCurve();
+    FrozenYieldCurve oisCurve(curve);
+    FrozenYieldCurve forwardCurve(YieldCurve(maturitiesEUR3M, initialRatesEUR3M, LOGLINEAR_ON_EXP_X_TIMES_Y));
+    std::vector<Swap> swaps = benchmarkSwaps(t_size, curve);
+
+    SwapPricingBuffers buffers;
+    Time pricingDates[] = { 0., 0.6 };
+    FrozenYieldCurve const* forwardCurves[] = { &oisCurve, &forwardCurve };
+    Value checksum = 0.;
+    auto priceAll = [&]()
+    {
+        for (Time pricingDate : pricingDates)
+        {
+            for (FrozenYieldCurve const* forward : forwardCurves)
+            {
+                for (Swap const& swap : swaps)
+                {
+                    checksum += price(swap, oisCurve, *forward, pricingDate, buffers);
+                }
+            }
+        }
+    };
+
+    priceAll(); // buffers sized on the longest swap
+    size_t before = benchmarkAllocations.load();
+    priceAll();
+    size_t allocations = benchmarkAllocations.load() - before;
+
+    std::cout << "\n*******************************************************************************************\n";
+    std::cout << "\nHeap allocations of " << 4 * t_size << " warm swap pricings (unaged and aged, single and dual curve): "
+        << allocations << " (checksum " << checksum << ")\n";
+    std::cout << "\n*******************************************************************************************\n";
+
+    return allocations > 0 ? 1 : 0;
+}
+
+// speed-up from 1 to t_maxThreads threads (powers of two) of the book pricers and of the jacobians of the
+// OIS strip, exact and bumped. Results are the same whatever the number of threads.
+int benchmarkThreadScaling(size_t t_maxThreads = std::max(std::thread::hardware_concurrency(), 1u), size_t t_size = 50000)
+{
+    YieldCurve curve = benchmarkOISCurve();
+    FrozenYieldCurve frozenCurve(curve);
+    std::vector<Swap> swaps = benchmarkSwaps(t_size, curve);
+    SwapPortfolio portfolio(swaps);
+
+    std::vector<Value> rates = curve.getInterestRates();
+    std::function<std::vector<Dual<Value>>(std::vector<Dual<Value>>)> activeObjectiveFunction = [&](std::vector<Dual<Value>> t_vRates)
+    {
+        BasicYieldCurve<Dual<Value>> activeCurve(maturitiesOIS, t_vRates, LOGLINEAR_ON_EXP_X_TIMES_Y);
+        return priceVector(benchmarkOISSwaps(activeCurve));
+    };
+    std::function<std::vector<Value>(std::vector<Value>)> objectiveFunction = [&](std::vector<Value> t_vdRates)
+    {
+        YieldCurve bumpedCurve(maturitiesOIS, t_vdRates, LOGLINEAR_ON_EXP_X_TIMES_Y);
+        return priceVector(benchmarkOISSwaps(bumpedCurve));
+    };
+
+    std::cout << "\n*******************************************************************************************\n";
+    std::cout << "\nThread scaling, book of " << t_size << " swaps, jacobian of " << rates.size() << " pillars: " << "\n";
+
+    std::vector<size_t> threadCounts;
+    for (size_t threads = 1; threads < t_maxThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(t_maxThreads);
+
+    // first pricing outside the timings: it sizes the scratch buffers
+    priceVector(portfolio, frozenCurve, frozenCurve, 0.);
+
+    double reference[4] = {};
+    for (size_t threads : threadCounts)
+    {
+        ThreadPool pool(threads);
+        std::vector<Value> functionValue;
+        double timings[4];
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::vector<Value> portfolioPrices = priceVector(portfolio, frozenCurve, frozenCurve, 0., pool);
+        std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+        timings[0] = std::chrono::duration<double, std::milli>(stop - start).count();
+
+        start = std::chrono::steady_clock::now();
+        std::vector<Value> swapPrices = priceVector(swaps, 0., pool);
+        stop = std::chrono::steady_clock::now();
+        timings[1] = std::chrono::duration<double, std::milli>(stop - start).count();
+
+        start = std::chrono::steady_clock::now();
+        computeJacobian<Value>(rates, activeObjectiveFunction, functionValue, &pool);
+        stop = std::chrono::steady_clock::now();
+        timings[2] = std::chrono::duration<double, std::milli>(stop - start).count();
+
+        start = std::chrono::steady_clock::now();
+        computeJacobian<Value>(rates, objectiveFunction, &pool);
+        stop = std::chrono::steady_clock::now();
+        timings[3] = std::chrono::duration<double, std::milli>(stop - start).count();
+
+        if (threads == 1)
+        {
+            std::copy(timings, timings + 4, reference);
+        }
+        std::cout << threads << " threads: portfolio " << timings[0] << " ms (x" << reference[0] / timings[0]
+            << "), swap by swap " << timings[1] << " ms (x" << reference[1] / timings[1]
+            << "), exact jacobian " << timings[2] << " ms (x" << reference[2] / timings[2]
+            << "), bumped jacobian " << timings[3] << " ms (x" << reference[3] / timings[3] << ")"
+            << " (checksum " << portfolioPrices.back() + swapPrices.back() << ")\n";
+    }
+    std::cout << "\n*******************************************************************************************\n";
+
+    return 0;
+}
+
+// jacobian of the OIS strip at its solution on one thread, as Stripper::calibrate computes it: one reverse
+// sweep per swap on the curve compiled once (CompiledStrip), against forward mode on active scalars and bumped
+// revaluations, with the largest differences relative to the largest derivative. Returns 1 when the two exact
+// jacobians differ by more than 1E-12.
+int benchmarkJacobian(size_t t_repetitions = 200)
+{
+    std::vector<Value> rates = benchmarkOISCurve().getInterestRates();
+    std::function<std::vector<Dual<Value>>(std::vector<Dual<Value>>)> activeObjectiveFunction = [&](std::vector<Dual<Value>> t_vRates)
+    {
+        BasicYieldCurve<Dual<Value>> activeCurve(maturitiesOIS, t_vRates, LOGLINEAR_ON_EXP_X_TIMES_Y);
+        return priceVector(benchmarkOISSwaps(activeCurve));
+    };
+    std::function<std::vector<Value>(std::vector<Value>)> objectiveFunction = [&](std::vector<Value> t_vdRates)
+    {
+        YieldCurve bumpedCurve(maturitiesOIS, t_vdRates, LOGLINEAR_ON_EXP_X_TIMES_Y);
+        return priceVector(benchmarkOISSwaps(bumpedCurve));
+    };
+
+    YieldCurve strippedCurve(maturitiesOIS, rates, LOGLINEAR_ON_EXP_X_TIMES_Y);
+    strippedCurve.setStripTag(newStripTag());
+    CompiledStrip strip;
+    strip.set(benchmarkOISSwaps(strippedCurve), { strippedCurve.stripTag() }, { rates.size() });
+
+    Matrix<Value> adjoint;
+    Matrix<Value> forward;
+    Matrix<Value> bumped;
+    std::vector<Value> functionValue(rates.size());
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < t_repetitions; r++)
+    {
+        strip.compile(0, maturitiesOIS, rates, LOGLINEAR_ON_EXP_X_TIMES_Y);
+        strip.evaluate(functionValue.data(), &adjoint);
+    }
+    std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+    double adjointTime = std::chrono::duration<double, std::milli>(stop - start).count() / t_repetitions;
+
+    start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < t_repetitions; r++)
+    {
+        computeJacobian<Value>(rates, activeObjectiveFunction, functionValue, forward);
+    }
+    stop = std::chrono::steady_clock::now();
+    double forwardTime = std::chrono::duration<double, std::milli>(stop - start).count() / t_repetitions;
+
+    start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < t_repetitions; r++)
+    {
+        computeJacobian<Value>(rates, objectiveFunction, bumped);
+    }
+    stop = std::chrono::steady_clock::now();
+    double bumpedTime = std::chrono::duration<double, std::milli>(stop - start).count() / t_repetitions;
+
+    Value largest = 0.;
+    Value forwardDifference = 0.;
+    Value bumpedDifference = 0.;
+    for (size_t j = 0; j < adjoint.columns(); j++)
+    {
+        for (size_t i = 0; i < adjoint.rows(); i++)
+        {
+            largest = std::max(largest, std::abs(adjoint(i, j)));
+            forwardDifference = std::max(forwardDifference, std::abs(adjoint(i, j) - forward(i, j)));
+            bumpedDifference = std::max(bumpedDifference, std::abs(adjoint(i, j) - bumped(i, j)));
+        }
+    }
+
+    std::cout << "\n*******************************************************************************************\n";
+    std::cout << "\nJacobian of the OIS strip, " << rates.size() << " pillars: " << "\n";
+    std::cout << "adjoint " << adjointTime << " ms (x" << bumpedTime / adjointTime << " against bumped), forward mode "
+        << forwardTime << " ms (" << Dual<Value>::width << " tangents per sweep), bumped " << bumpedTime << " ms per jacobian" << "\n";
+    std::cout << "largest relative difference to forward mode " << forwardDifference / largest << ", to bumped "
+        << bumpedDifference / largest << "\n";
+    std::cout << "\n*******************************************************************************************\n";
+
+    return forwardDifference <= 1E-12 * largest ? 0 : 1;
+}
+
+// Hull-White paths on the OIS curve: simulation of t_paths paths over t_dates exposure dates, then the zero
+// coupons of a quarterly 30Y grid on every path and date. The deflated zero coupons are martingales, their
+// Monte Carlo means are checked against the initial discount factors.
+int benchmarkHullWhite1Factor(size_t t_paths = 10000, size_t t_dates = 200, Value t_dLambda = 0.05, Value t_dEta = 0.01)
+{
+    HullWhite1Factor model(benchmarkOISCurve(), t_dLambda, t_dEta);
+    std::vector<Time> simulationDates = linspace<Time>(30. / t_dates, 30., t_dates);
+    std::vector<Time> maturities = linspace<Time>(0.25, 30., 120);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    HullWhite1FactorEngine engine(model, simulationDates, maturities, t_paths);
+    engine.simulate();
+    std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+    double simulation = std::chrono::duration<double, std::milli>(stop - start).count();
+
+    std::vector<Value> zeroCoupons(maturities.size() * t_paths);
+    std::vector<Value> deflatedMeans(maturities.size() * t_dates, 0.);
+    double reconstruction = 0.;
+    for (size_t k = 0; k < t_dates; k++)
+    {
+        start = std::chrono::steady_clock::now();
+        engine.zeroCoupons(k, zeroCoupons.data());
+        stop = std::chrono::steady_clock::now();
+        reconstruction += std::chrono::duration<double, std::milli>(stop - start).count();
+
+        Value const* deflator = engine.deflator(k);
+        for (size_t j = 0; j < maturities.size(); j++)
+        {
+            for (size_t p = 0; p < t_paths; p++)
+            {
+                deflatedMeans[k * maturities.size() + j] += deflator[p] * zeroCoupons[j * t_paths + p] / t_paths;
+            }
+        }
+    }
+
+    Value maximumError = 0.;
+    for (size_t k = 0; k < t_dates; k++)
+    {
+        for (size_t j = 0; j < maturities.size(); j++)
+        {
+            if (maturities[j] >= simulationDates[k])
+            {
+                Value error = deflatedMeans[k * maturities.size() + j] / model.getZeroCoupon().discount(maturities[j]) - 1.;
+                maximumError = std::max(maximumError, std::abs(error));
+            }
+        }
+    }
+
+    std::cout << "\n*******************************************************************************************\n";
+    std::cout << "\nHull-White 1F, lambda " << t_dLambda << ", eta " << t_dEta << ", " << t_paths << " paths x " << t_dates
+        << " dates, " << discountBatchInstructionSet << " kernel: " << "\n";
+    std::cout << "simulation " << simulation << " ms, " << maturities.size() << " zero coupons per path and date "
+        << reconstruction << " ms, largest relative error of the deflated zero coupon means " << maximumError << "\n";
+    std::cout << "\n*******************************************************************************************\n";
+
+    return 0;
+}
+
+// zero coupons of every maturity on every path from the short rate by the closed form, batched over the paths
+// against one scalar call per path and maturity, then the deflated means against the initial curve
+int benchmarkHullWhite1FactorShortRate(size_t t_paths = 10000, size_t t_dates = 200, Value t_dLambda = 0.05, Value t_dEta = 0.01)
+{
+    HullWhite1Factor model(benchmarkOISCurve(), t_dLambda, t_dEta);
+    std::vector<Time> simulationDates = linspace<Time>(30. / t_dates, 30., t_dates);
+    std::vector<Time> maturities = linspace<Time>(0.25, 30., 120);
+    HullWhite1FactorEngine engine(model, simulationDates, maturities, t_paths);
+    engine.simulate();
+
+    std::vector<Value> shortRates(t_paths);
+    std::vector<Value> zeroCoupons(maturities.size() * t_paths);
+    std::vector<Value> deflatedMeans(maturities.size() * t_dates, 0.);
+    double batched = 0.;
+    double scalar = 0.;
+    Value largestDifference = 0.;
+    for (size_t k = 0; k < t_dates; k++)
+    {
+        engine.shortRate(k, shortRates.data());
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        model.zeroCoupons(simulationDates[k], shortRates.data(), t_paths, maturities.data(), maturities.size(), zeroCoupons.data());
+        std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+        batched += std::chrono::duration<double, std::milli>(stop - start).count();
+
+        Value const* deflator = engine.deflator(k);
+        for (size_t j = 0; j < maturities.size(); j++)
+        {
+            for (size_t p = 0; p < t_paths; p++)
+            {
+                deflatedMeans[k * maturities.size() + j] += deflator[p] * zeroCoupons[j * t_paths + p] / t_paths;
+            }
+        }
+
+        // the scalar closed form on a tenth of the dates
+        if (k % 10 == 0)
+        {
+            start = std::chrono::steady_clock::now();
+            for (size_t j = 0; j < maturities.size(); j++)
+            {
+                if (maturities[j] < simulationDates[k])
+                {
+                    continue;
+                }
+                for (size_t p = 0; p < t_paths; p++)
+                {
+                    Value zeroCoupon = model.zeroCoupon(simulationDates[k], maturities[j], shortRates[p]);
+                    largestDifference = std::max(largestDifference, std::abs(zeroCoupon - zeroCoupons[j * t_paths + p]));
+                }
+            }
+            stop = std::chrono::steady_clock::now();
+            scalar += std::chrono::duration<double, std::milli>(stop - start).count();
+        }
+    }
+
+    Value maximumError = 0.;
+    size_t bonds = 0;
+    size_t scalarBonds = 0;
+    for (size_t k = 0; k < t_dates; k++)
+    {
+        for (size_t j = 0; j < maturities.size(); j++)
+        {
+            if (maturities[j] >= simulationDates[k])
+            {
+                Value error = deflatedMeans[k * maturities.size() + j] / model.getZeroCoupon().discount(maturities[j]) - 1.;
+                maximumError = std::max(maximumError, std::abs(error));
+                bonds += t_paths;
+                scalarBonds += k % 10 == 0 ? t_paths : 0;
+            }
+        }
+    }
+
+    std::cout << "\n*******************************************************************************************\n";
+    std::cout << "\nHull-White 1F zero coupons on the short rate, " << t_paths << " paths x " << t_dates << " dates x "
+        << maturities.size() << " maturities: " << "\n";
+    std::cout << "batched " << 1E6 * batched / bonds << " ns, scalar " << 1E6 * scalar / scalarBonds
+        << " ns per zero coupon, largest difference " << largestDifference << "\n";
+    std::cout << "largest relative error of the deflated zero coupon means " << maximumError << "\n";
+    std::cout << "\n*******************************************************************************************\n";
+
+    return 0;
+}
+
+// exposures of a book of random swaps netted as one netting set on Hull-White paths of the OIS curve,
+// one statistics line per date of a yearly subgrid, then the profile totals
+int benchmarkExposures(size_t t_size = 20000, size_t t_paths = 10000, size_t t_dates = 120)
+{
+    YieldCurve curve = benchmarkOISCurve();
+    SwapPortfolio portfolio(benchmarkSwaps(t_size, curve));
+    HullWhite1Factor model(curve, 0.05, 0.01);
+    std::vector<Time> exposureDates = linspace<Time>(30. / t_dates, 30., t_dates);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    HullWhite1FactorEngine engine(model, exposureDates, portfolio.dates(), t_paths);
+    engine.simulate();
+
+    std::cout << "\n*******************************************************************************************\n";
+    std::cout << "\nExposures of " << t_size << " swaps, " << t_paths << " paths x " << t_dates << " dates: " << "\n";
+
+    size_t step = std::max(t_dates / 30, (size_t)1);
+    ExposureProfile profile = computeExposures(portfolio, engine, CreditParameters{ 0.02, 0.4 }, CreditParameters{ 0.01, 0.4 }, 0.95,
+        [&](ExposureDate const& t_exposure)
+        {
+            if ((t_exposure.index + 1) % (4 * step) == 0)
+            {
+                std::cout << "t = " << t_exposure.date << ": EE " << t_exposure.expectedExposure
+                    << ", ENE " << t_exposure.expectedNegativeExposure
+                    << ", PFE 95% " << t_exposure.potentialFutureExposure << "\n";
+            }
+        });
+    std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+
+    std::cout << "EPE " << profile.expectedPositiveExposure << ", CVA " << profile.cva << ", DVA " << profile.dva
+        << " in " << std::chrono::duration<double, std::milli>(stop - start).count() << " ms\n";
+    std::cout << "\n*******************************************************************************************\n";
+
+    return 0;
+}
+
+// Philox and Sobol normal throughput, then the convergence of the CVA of a book of random swaps with the
+// number of paths: root mean square errors over t_seeds seeds of the Philox paths and of the shifted Sobol
+// paths through Brownian bridges, against a Sobol run of t_referencePaths paths
+int benchmarkRandomNumbers(size_t t_size = 2000, size_t t_dates = 60, size_t t_referencePaths = 32768, size_t t_seeds = 8)
+{
+    size_t draws = 1 << 22;
+    std::vector<Value> normals(draws);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Philox philox(42);
+    philox.normals(0, 0, normals.data(), draws);
+    std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+    double philoxTime = std::chrono::duration<double, std::milli>(stop - start).count();
+
+    Sobol sobol(2 * t_dates);
+    std::vector<uint32_t> point(sobol.dimensions());
+    start = std::chrono::steady_clock::now();
+    sobol.integers(1, point.data());
+    for (size_t n = 1; n * sobol.dimensions() < draws; n++)
+    {
+        sobol.next(n, point.data());
+        sobol.normals(point.data(), normals.data());
+    }
+    stop = std::chrono::steady_clock::now();
+    double sobolTime = std::chrono::duration<double, std::milli>(stop - start).count();
+
+    YieldCurve curve = benchmarkOISCurve();
+    SwapPortfolio portfolio(benchmarkSwaps(t_size, curve));
+    HullWhite1Factor model(curve, 0.05, 0.01);
+    std::vector<Time> exposureDates = linspace<Time>(30. / t_dates, 30., t_dates);
+    CreditParameters counterparty{ 0.02, 0.4 };
+    CreditParameters own{ 0.01, 0.4 };
+    auto cva = [&](size_t t_paths, unsigned long long t_iSeed, RandomNumbers t_randomNumbers)
+    {
+        HullWhite1FactorEngine engine(model, exposureDates, portfolio.dates(), t_paths, t_iSeed, t_randomNumbers);
+        engine.simulate();
+        return computeExposures(portfolio, engine, counterparty, own).cva;
+    };
+    Value reference = cva(t_referencePaths, 42, QUASI_RANDOM);
+
+    std::cout << "\n*******************************************************************************************\n";
+    std::cout << "\nRandom numbers: " << draws << " normals, Philox " << philoxTime << " ms, Sobol in "
+        << sobol.dimensions() << " dimensions " << sobolTime << " ms" << "\n";
+    std::cout << "CVA of " << t_size << " swaps over " << t_dates << " dates, reference " << reference << " (Sobol, "
+        << t_referencePaths << " paths): " << "\n";
+    for (size_t paths = 256; paths <= t_referencePaths / 8; paths *= 4)
+    {
+        Value philoxError = 0.;
+        Value sobolError = 0.;
+        for (size_t seed = 1; seed <= t_seeds; seed++)
+        {
+            Value error = cva(paths, seed, PSEUDO_RANDOM) - reference;
+            philoxError += error * error / t_seeds;
+            error = cva(paths, seed, QUASI_RANDOM) - reference;
+            sobolError += error * error / t_seeds;
+        }
+        std::cout << paths << " paths: relative rms error Philox " << sqrt(philoxError) / reference
+            << ", Sobol " << sqrt(sobolError) / reference << "\n";
+    }
+    std::cout << "\n*******************************************************************************************\n";
+
+    return 0;
+}
+
+// LU solve and Cholesky of the jacobian of the OIS strip (and of its normal matrix J^T J) on the header-only
+// kernels and, when the build has one, on the LAPACK library, t_repetitions times each
+int benchmarkLinearAlgebra(size_t t_repetitions = 10000)
+{
+    YieldCurve curve = benchmarkOISCurve();
+    std::vector<Value> rates = curve.getInterestRates();
+    std::function<std::vector<Dual<Value>>(std::vector<Dual<Value>>)> activeObjectiveFunction = [&](std::vector<Dual<Value>> t_vRates)
+    {
+        BasicYieldCurve<Dual<Value>> activeCurve(maturitiesOIS, t_vRates, LOGLINEAR_ON_EXP_X_TIMES_Y);
+        return priceVector(benchmarkOISSwaps(activeCurve));
+    };
+    std::vector<Value> functionValue;
+    Matrix<Value> jacobian = computeJacobian<Value>(rates, activeObjectiveFunction, functionValue);
+    int n = (int)rates.size();
+    int lda = (int)jacobian.leadingDimension();
+
+    Matrix<Value> normalMatrix(n, n, 0.);
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            for (int k = 0; k < n; k++)
+            {
+                normalMatrix(i, j) += jacobian(k, i) * jacobian(k, j);
+            }
+        }
+    }
+
+    Matrix<Value> factors;
+    std::vector<Value> solution(n);
+    std::vector<int> pivots(n);
+    auto timeSolver = [&](auto t_factorize, auto t_solve)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < t_repetitions; r++)
+        {
+            factors = jacobian;
+            solution = functionValue;
+            t_factorize(n, factors.data(), lda, pivots.data());
+            t_solve(n, factors.data(), lda, pivots.data(), solution.data());
+        }
+        std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+
+        Value residual = 0.;
+        for (int i = 0; i < n; i++)
+        {
+            Value row = -functionValue[i];
+            for (int j = 0; j < n; j++)
+            {
+                row += jacobian(i, j) * solution[j];
+            }
+            residual = std::max(residual, std::abs(row));
+        }
+        std::cout << "LU solve " << 1000. * std::chrono::duration<double, std::milli>(stop - start).count() / t_repetitions
+            << " us, residual " << residual;
+    };
+    auto timeCholesky = [&](auto t_factorize)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < t_repetitions; r++)
+        {
+            factors = normalMatrix;
+            t_factorize(n, factors.data(), lda);
+        }
+        std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+        std::cout << ", Cholesky " << 1000. * std::chrono::duration<double, std::milli>(stop - start).count() / t_repetitions
+            << " us\n";
+    };
+
+    // both sides on the same systems in one run, then the dispatch the solvers go through
+    std::cout << "\n*******************************************************************************************\n";
+    std::cout << "\nLinear algebra on the " << n << "x" << n << " OIS jacobian, " << linearAlgebraBackend << " backend, "
+        << "header-only kernels up to " << smallSystemSize << " unknowns: " << "\n";
+    std::cout << "header-only: ";
+    timeSolver(smallLuFactorize, smallLuSolve);
+    timeCholesky(smallCholeskyFactorize);
+#if defined(XVA_USE_MKL) || defined(XVA_USE_LAPACK)
+    std::cout << linearAlgebraBackend << ": ";
+    timeSolver(libraryLuFactorize, libraryLuSolve);
+    timeCholesky(libraryCholeskyFactorize);
+    std::cout << "dispatched: ";
+    timeSolver(luFactorize, luSolve);
+    timeCholesky(choleskyFactorize);
+#else
+    std::cout << "no library to compare with: build with XVA_USE_MKL or XVA_USE_LAPACK\n";
+#endif
+    std::cout << "\n*******************************************************************************************\n";
+
+    return 0;
+}
+
+// OIS strip by the three Newton methods (exact jacobians), from the initial rates of the market data, then
+// recalibrated from the stripped curve after the quotes moved by up to t_dQuoteMove: jacobians computed,
+// time and largest repricing error of each
+int benchmarkNewtonMethods(Value t_dQuoteMove = 0.5E-4)
+{
+    std::vector<Value> strikes = strikesOIS;
+    auto oisSwaps = [&](auto& myCurve)
+    {
+        std::vector<SwapOn<decltype(myCurve)>> mySwapVect;
+        for (size_t i = 0; i < maturitiesOIS.size(); i++)
+        {
+            int nbOfPayments = (int)(maturitiesOIS[i] > 1 ? maturitiesOIS[i] : 1);
+            mySwapVect.emplace_back(SwapType::PAYER, notional, strikes[i], 0., 0., maturitiesOIS[i], nbOfPayments, myCurve);
+        }
+        return mySwapVect;
+    };
+    std::function<std::vector<Dual<Value>>(std::vector<Dual<Value>>)> activeObjectiveFunction = [&](std::vector<Dual<Value>> t_vRates)
+    {
+        BasicYieldCurve<Dual<Value>> activeCurve(maturitiesOIS, t_vRates, LOGLINEAR_ON_EXP_X_TIMES_Y);
+        return priceVector(oisSwaps(activeCurve));
+    };
+    auto largestError = [&](std::vector<Value> const& t_vdRates)
+    {
+        YieldCurve curve(maturitiesOIS, t_vdRates, LOGLINEAR_ON_EXP_X_TIMES_Y);
+        Value error = 0.;
+        for (Value swapPrice : priceVector(oisSwaps(curve)))
+        {
+            error = std::max(error, std::abs(swapPrice));
+        }
+        return error;
+    };
+
+    std::vector<std::pair<NewtonMethod, char const*>> methods = {
+        { NEWTON, "Newton" }, { BROYDEN, "Broyden" }, { LEVENBERG_MARQUARDT, "Levenberg-Marquardt" } };
+    std::vector<std::string> lines;
+    std::vector<Value> stripped;
+    for (bool recalibration : { false, true })
+    {
+        std::vector<Value> start = initialRatesOIS;
+        if (recalibration)
+        {
+            start = stripped;
+            std::mt19937_64 generator(42);
+            std::uniform_real_distribution<Value> move(-t_dQuoteMove, t_dQuoteMove);
+            for (Value& strike : strikes)
+            {
+                strike += move(generator);
+            }
+        }
+        for (auto const& method : methods)
+        {
+            std::vector<Value> rates = start;
+            NewtonState<Value> state; // quiet, and cold: Broyden starts from a jacobian of its own
+            state.verbose = false;
+            std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+            int jacobians = multivariateNewtonRaphson<Value>(rates, activeObjectiveFunction, 1E-16, 100, nullptr, method.first, &state);
+            std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+            if (!recalibration && method.first == NEWTON)
+            {
+                stripped = rates;
+            }
+            std::ostringstream line;
+            line << (recalibration ? "recalibration, " : "calibration, ") << method.second << ": " << jacobians << " jacobians, "
+                << std::chrono::duration<double, std::milli>(end - begin).count() << " ms, largest swap price " << largestError(rates);
+            lines.push_back(line.str());
+        }
+    }
+
+    std::cout << "\n*******************************************************************************************\n";
+    std::cout << "\nNewton methods on the OIS strip, quotes then moved by up to " << t_dQuoteMove << ": " << "\n";
+    for (std::string const& line : lines)
+    {
+        std::cout << line << "\n";
+    }
+    std::cout << "\n*******************************************************************************************\n";
+
+    return 0;
+}
+
+// market ticks on the OIS strip: every tick moves the quote of one random swap by up to t_dQuoteMove and the
+// curve is recalibrated from the previous one, against a strip from the initial rates of the market data
+// on every tick. Mean time per tick and largest repricing error after the last tick.
+int benchmarkRecalibration(size_t t_ticks = 1000, Value t_dQuoteMove = 0.25E-4)
+{
+    std::mt19937_64 generator(42);
+    std::uniform_int_distribution<size_t> instrument(0, maturitiesOIS.size() - 1);
+    std::uniform_real_distribution<Value> move(-t_dQuoteMove, t_dQuoteMove);
+    std::vector<std::pair<size_t, Value>> ticks(t_ticks);
+    std::vector<Value> quotes = strikesOIS;
+    for (auto& tick : ticks)
+    {
+        tick.first = instrument(generator);
+        quotes[tick.first] += move(generator);
+        tick.second = quotes[tick.first];
+    }
+
+    // the quotes after the last tick
+    auto quotedSwaps = [&](auto& myCurve)
+    {
+        std::vector<SwapOn<decltype(myCurve)>> mySwapVect;
+        for (size_t i = 0; i < maturitiesOIS.size(); i++)
+        {
+            int nbOfPayments = (int)(maturitiesOIS[i] > 1 ? maturitiesOIS[i] : 1);
+            mySwapVect.emplace_back(SwapType::PAYER, notional, quotes[i], 0., 0., maturitiesOIS[i], nbOfPayments, myCurve);
+        }
+        return mySwapVect;
+    };
+
+    auto largestError = [](Stripper<Swap>& t_stripper)
+    {
+        Value error = 0.;
+        for (Value swapPrice : t_stripper.evaluateInstruments())
+        {
+            error = std::max(error, std::abs(swapPrice));
+        }
+        return error;
+    };
+
+    std::vector<std::pair<CalibrationMethod, char const*>> methods = {
+        { SEQUENTIAL_BOOTSTRAP, "bootstrap" }, { NEWTON_RAPHSON, "Newton-Raphson" } };
+    std::vector<std::string> lines;
+    for (auto const& method : methods)
+    {
+        Stripper<Swap> incremental(maturitiesOIS, initialRatesOIS, benchmarkOISSwaps, LOGLINEAR_ON_EXP_X_TIMES_Y);
+        incremental.setVerbose(false);
+        incremental.calibrate(method.first);
+        incremental.recalibrate({}); // dependencies of the bootstrap read once
+
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        for (auto const& tick : ticks)
+        {
+            incremental.recalibrate({ tick });
+        }
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        double incrementalTime = std::chrono::duration<double, std::micro>(end - begin).count() / t_ticks;
+
+        size_t scratchTicks = std::min(t_ticks, (size_t)50);
+        begin = std::chrono::steady_clock::now();
+        for (size_t t = 0; t < scratchTicks; t++)
+        {
+            Stripper<Swap> fromScratch(maturitiesOIS, initialRatesOIS, quotedSwaps, LOGLINEAR_ON_EXP_X_TIMES_Y);
+            fromScratch.setVerbose(false);
+            fromScratch.calibrate(method.first);
+        }
+        end = std::chrono::steady_clock::now();
+        double scratchTime = std::chrono::duration<double, std::micro>(end - begin).count() / scratchTicks;
+
+        std::ostringstream line;
+        line << method.second << ": recalibration " << incrementalTime << " us per tick, largest swap price "
+            << largestError(incremental) << "; strip from scratch " << scratchTime << " us per tick";
+        lines.push_back(line.str());
+    }
+
+    std::cout << "\n*******************************************************************************************\n";
+    std::cout << "\n" << t_ticks << " ticks of up to " << t_dQuoteMove << " on one OIS quote: " << "\n";
+    for (std::string const& line : lines)
+    {
+        std::cout << line << "\n";
+    }
+    std::cout << "\n*******************************************************************************************\n";
+
+    return 0;
+}
+
+// OIS and EUR3M curves stripped one after the other (the EUR3M swaps against the stripped OIS) and jointly by
+// the block calibrator, then with a EUR6M curve added on 3M/6M basis swaps. The basis spreads are
+// illustrative, a few basis points decreasing with the maturity. Time, iterations and largest repricing error.
+int benchmarkMultiCurve()
+{
+    auto oisSwaps = [](auto& curves)
+    {
+        std::vector<SwapOn<decltype(curves[0])>> mySwapVect;
+        for (size_t i = 0; i < maturitiesOIS.size(); i++)
+        {
+            int nbOfPayments = (int)(maturitiesOIS[i] > 1 ? maturitiesOIS[i] : 1);
+            mySwapVect.emplace_back(SwapType::PAYER, notional, strikesOIS[i], 0., 0., maturitiesOIS[i], nbOfPayments, curves[0]);
+        }
+        return mySwapVect;
+    };
+    auto eur3mSwaps = [](auto& curves)
+    {
+        std::vector<SwapOn<decltype(curves[0])>> mySwapVect;
+        for (size_t i = 0; i < maturitiesEUR3M.size(); i++)
+        {
+            int nbOfPayments = (int)(maturitiesEUR3M[i] > 1 ? 4 * maturitiesEUR3M[i] : 4);
+            mySwapVect.emplace_back(SwapType::PAYER, notional, strikesEUR3M[i], 0., 0., maturitiesEUR3M[i], nbOfPayments, curves[0], curves[1]);
+        }
+        return mySwapVect;
+    };
+    std::vector<Value> basisSpreads;
+    for (Time maturity : maturitiesEUR3M)
+    {
+        basisSpreads.push_back(0.0008 + 0.0004 * exp(-maturity / 10.));
+    }
+    auto eur6mBasisSwaps = [&](auto& curves)
+    {
+        std::vector<BasisSwapOn<decltype(curves[0])>> mySwapVect;
+        for (size_t i = 0; i < maturitiesEUR3M.size(); i++)
+        {
+            size_t quarterly = (size_t)(maturitiesEUR3M[i] > 1 ? 4 * maturitiesEUR3M[i] : 4);
+            size_t semiAnnual = (size_t)(maturitiesEUR3M[i] > 1 ? 2 * maturitiesEUR3M[i] : 2);
+            mySwapVect.emplace_back(notional, basisSpreads[i], 0., 0., maturitiesEUR3M[i], quarterly, semiAnnual,
+                curves[0], curves[1], curves[2]);
+        }
+        return mySwapVect;
+    };
+
+    auto largestError = [](std::vector<Value> const& t_vdPrices, Value t_dError)
+    {
+        for (Value swapPrice : t_vdPrices)
+        {
+            t_dError = std::max(t_dError, std::abs(swapPrice));
+        }
+        return t_dError;
+    };
+
+    std::vector<std::string> lines;
+    {
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        Stripper<Swap> ois(maturitiesOIS, initialRatesOIS, [&](auto& myCurve)
+        {
+            std::vector<std::decay_t<decltype(myCurve)>> curves = { myCurve };
+            return oisSwaps(curves);
+        }, LOGLINEAR_ON_EXP_X_TIMES_Y);
+        ois.setVerbose(false);
+        ois.calibrate();
+        YieldCurve oisCurve = ois.getZeroCoupon();
+        Stripper<Swap> eur3m(maturitiesEUR3M, initialRatesEUR3M, [&](auto& myCurve)
+        {
+            std::vector<std::decay_t<decltype(myCurve)>> curves = { std::decay_t<decltype(myCurve)>(oisCurve), myCurve };
+            return eur3mSwaps(curves);
+        }, LOGLINEAR_ON_EXP_X_TIMES_Y);
+        eur3m.setVerbose(false);
+        eur3m.calibrate();
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        std::ostringstream line;
+        line << "OIS then EUR3M strips: " << std::chrono::duration<double, std::milli>(end - begin).count()
+            << " ms, largest swap price " << largestError(eur3m.evaluateInstruments(), largestError(ois.evaluateInstruments(), 0.));
+        lines.push_back(line.str());
+    }
+    for (bool basis : { false, true })
+    {
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        MultiCurveStripper curves;
+        curves.addCurve(maturitiesOIS, initialRatesOIS, { 0 }, oisSwaps, LOGLINEAR_ON_EXP_X_TIMES_Y);
+        curves.addCurve(maturitiesEUR3M, initialRatesEUR3M, { 0, 1 }, eur3mSwaps, LOGLINEAR_ON_EXP_X_TIMES_Y);
+        if (basis)
+        {
+            curves.addCurve(maturitiesEUR3M, initialRatesEUR3M, { 0, 1, 2 }, eur6mBasisSwaps, LOGLINEAR_ON_EXP_X_TIMES_Y);
+        }
+        int iterations = curves.calibrate();
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        Value error = 0.;
+        for (size_t c = 0; c < curves.size(); c++)
+        {
+            error = largestError(curves.evaluateInstruments(c), error);
+        }
+        std::ostringstream line;
+        line << (basis ? "OIS, EUR3M and EUR6M jointly: " : "OIS and EUR3M jointly: ") << iterations << " iterations, "
+            << std::chrono::duration<double, std::milli>(end - begin).count() << " ms, largest swap price " << error;
+        lines.push_back(line.str());
+    }
+
+    std::cout << "\n*******************************************************************************************\n";
+    std::cout << "\nMulti-curve calibration: " << "\n";
+    for (std::string const& line : lines)
+    {
+        std::cout << line << "\n";
+    }
+    std::cout << "\n*******************************************************************************************\n";
+
+    return 0;
+}
+
+// Newton strip of a curve of more than 100 pillars, the OIS pillars with ECB meeting dates every six weeks up
+// to 5 years and turn-of-year nodes up to 30 years, quoted at par on the stripped OIS curve. Dense jacobians
+// against jacobians on their (lower triangular) pattern, bumped and exact.
+int benchmarkSparseJacobian()
+{
+    YieldCurve oisCurve = benchmarkOISCurve();
+
+    std::vector<Time> nodes = maturitiesOIS;
+    for (int i = 1; 6. * i / 52. <= 5.; i++)
+    {
+        nodes.push_back(6. * i / 52.);
+    }
+    for (int year = 1; year <= 30; year++)
+    {
+        nodes.push_back(year + 2. / 365.);
+    }
+    std::sort(nodes.begin(), nodes.end());
+    std::vector<Time> pillars;
+    for (Time node : nodes)
+    {
+        if (pillars.empty() || node - pillars.back() > 1. / 365.)
+        {
+            pillars.push_back(node);
+        }
+    }
+
+    auto nbOfPayments = [](Time t_dMaturity) { return (size_t)(t_dMaturity > 1 ? t_dMaturity : 1); };
+    std::vector<Value> quotes;
+    for (Time pillar : pillars)
+    {
+        Value floating = price(Swap(SwapType::PAYER, notional, 0., 0., 0., pillar, nbOfPayments(pillar), oisCurve));
+        Value annuity = floating - price(Swap(SwapType::PAYER, notional, 1., 0., 0., pillar, nbOfPayments(pillar), oisCurve));
+        quotes.push_back(floating / annuity);
+    }
+    auto swaps = [&](auto& myCurve)
+    {
+        std::vector<SwapOn<decltype(myCurve)>> mySwapVect;
+        for (size_t i = 0; i < pillars.size(); i++)
+        {
+            mySwapVect.emplace_back(SwapType::PAYER, notional, quotes[i], 0., 0., pillars[i], nbOfPayments(pillars[i]), myCurve);
+        }
+        return mySwapVect;
+    };
+    std::function<std::vector<Swap>(YieldCurve&)> plainSwaps = swaps;
+    std::vector<Value> initialRates(pillars.size(), 0.01);
+
+    std::vector<std::string> lines;
+    for (bool exact : { false, true })
+    {
+        for (bool sparse : { false, true })
+        {
+            Stripper<Swap> stripper = exact
+                ? Stripper<Swap>(pillars, initialRates, swaps, LOGLINEAR_ON_EXP_X_TIMES_Y)
+                : Stripper<Swap>(pillars, initialRates, plainSwaps, LOGLINEAR_ON_EXP_X_TIMES_Y);
+            stripper.setVerbose(false);
+            if (sparse)
+            {
+                stripper.setSparseJacobian();
+            }
+
+            std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+            stripper.calibrate();
+            std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+            Value error = 0.;
+            for (Value swapPrice : stripper.evaluateInstruments())
+            {
+                error = std::max(error, std::abs(swapPrice));
+            }
+            std::ostringstream line;
+            line << (exact ? "exact, " : "bumped, ") << (sparse ? "sparse: " : "dense: ")
+                << std::chrono::duration<double, std::milli>(end - begin).count() << " ms, largest swap price " << error;
+            lines.push_back(line.str());
+        }
+    }
+
+    std::function<std::vector<Value>(std::vector<Value>)> objectiveFunction = [&](std::vector<Value> t_vdRates)
+    {
+        YieldCurve curve(pillars, t_vdRates, LOGLINEAR_ON_EXP_X_TIMES_Y);
+        return priceVector(swaps(curve));
+    };
+    JacobianPattern pattern = jacobianPattern(computeJacobian<Value>(initialRates, objectiveFunction));
+
+    std::cout << "\n*******************************************************************************************\n";
+    std::cout << "\nNewton strip of " << pillars.size() << " pillars, jacobian pattern "
+        << (pattern.lowerTriangular ? "lower triangular" : "general") << " in " << pattern.colours.size() << " colours: " << "\n";
+    for (std::string const& line : lines)
+    {
+        std::cout << line << "\n";
+    }
+    std::cout << "\n*******************************************************************************************\n";
+
+    return 0;
+}
+
+// t_curves historical OIS curves (the stripped curve moved by a random walk of 1bp a day) written to a snapshot
+// file, mapped back and priced on in place: the OIS swaps on every mapped curve against the same swaps on
+// curves compiled from copies, largest difference and time of each
+int benchmarkSnapshot(size_t t_curves = 2500)
+{
+    YieldCurve oisCurve = benchmarkOISCurve();
+    std::mt19937_64 generator(42);
+    std::normal_distribution<Value> move(0., 1E-4);
+
+    std::vector<CurveSnapshot> snapshots(t_curves);
+    std::vector<Value> rates = oisCurve.interestRates();
+    for (size_t c = 0; c < t_curves; c++)
+    {
+        Value shift = move(generator);
+        for (Value& rate : rates)
+        {
+            rate += shift;
+        }
+        snapshots[c].name = "EUR-OIS";
+        snapshots[c].date = 20100101 + (int)c; // an index rather than a calendar date
+        snapshots[c].curve = YieldCurve(maturitiesOIS, rates, LOGLINEAR_ON_EXP_X_TIMES_Y);
+        snapshots[c].calibrationMethod = SEQUENTIAL_BOOTSTRAP;
+        snapshots[c].quoteMaturities = maturitiesOIS;
+        snapshots[c].quotes = strikesOIS;
+    }
+
+    std::string path = (std::filesystem::temp_directory_path() / "xva_curves.snapshot").string();
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    bool written = writeSnapshot(path, snapshots);
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    double writeTime = std::chrono::duration<double, std::milli>(end - begin).count();
+
+    SnapshotFile file;
+    begin = std::chrono::steady_clock::now();
+    bool opened = written && file.open(path);
+    end = std::chrono::steady_clock::now();
+    double openTime = std::chrono::duration<double, std::milli>(end - begin).count();
+    if (!opened || file.size() != t_curves)
+    {
+        std::cout << "\nCould not write or map " << path << "\n";
+        return 1;
+    }
+
+    std::vector<Swap> swaps = benchmarkOISSwaps(oisCurve);
+    std::vector<Value> mappedPrices(t_curves * swaps.size());
+    begin = std::chrono::steady_clock::now();
+    for (size_t c = 0; c < t_curves; c++)
+    {
+        MappedYieldCurve curve = file[c];
+        for (size_t i = 0; i < swaps.size(); i++)
+        {
+            mappedPrices[c * swaps.size() + i] = price(swaps[i], curve, curve);
+        }
+    }
+    end = std::chrono::steady_clock::now();
+    double mappedTime = std::chrono::duration<double, std::milli>(end - begin).count();
+
+    Value difference = 0.;
+    begin = std::chrono::steady_clock::now();
+    for (size_t c = 0; c < t_curves; c++)
+    {
+        FrozenYieldCurve curve(file[c].yieldCurve());
+        for (size_t i = 0; i < swaps.size(); i++)
+        {
+            difference = std::max(difference, std::abs(price(swaps[i], curve, curve) - mappedPrices[c * swaps.size() + i]));
+        }
+    }
+    end = std::chrono::steady_clock::now();
+    double copiedTime = std::chrono::duration<double, std::milli>(end - begin).count();
+    file.close();
+
+    // a snapshot whose indexing fields are corrupt must not open
+    std::vector<char> bytes(std::filesystem::file_size(path));
+    std::ifstream(path, std::ios::binary).read(bytes.data(), (std::streamsize)bytes.size());
+    SnapshotRecord record;
+    std::memcpy(&record, bytes.data() + sizeof(SnapshotHeader), sizeof(record));
+    auto corrupt = [&](auto t_change)
+    {
+        std::vector<char> corrupted = bytes;
+        SnapshotRecord changed = record;
+        t_change(changed, corrupted);
+        std::memcpy(corrupted.data() + sizeof(SnapshotHeader), &changed, sizeof(changed));
+        std::ofstream(path, std::ios::binary | std::ios::trunc).write(corrupted.data(), (std::streamsize)corrupted.size());
+        return file.open(path);
+    };
+    auto setMaturity = [](std::vector<char>& t_bytes, uint64_t t_offset, size_t t_index, Time t_value)
+    {
+        std::memcpy(t_bytes.data() + t_offset + t_index * sizeof(Time), &t_value, sizeof(Time));
+    };
+    bool corruptOpened = corrupt([](SnapshotRecord& r, std::vector<char>&) { r.interpolationMethod = 4; })
+        || corrupt([](SnapshotRecord& r, std::vector<char>&) { r.bucketWidth = 0.; })
+        || corrupt([](SnapshotRecord& r, std::vector<char>&) { r.bucketWidth = std::numeric_limits<double>::quiet_NaN(); })
+        || corrupt([](SnapshotRecord& r, std::vector<char>&) { r.bucketWidth = 1E-300; })
+        || corrupt([](SnapshotRecord& r, std::vector<char>& b)
+            { uint32_t past = r.pillars + 1; std::memcpy(b.data() + r.bucketSegment + sizeof(uint32_t), &past, sizeof(past)); })
+        || corrupt([&](SnapshotRecord& r, std::vector<char>& b) { setMaturity(b, r.maturities, 3, maturitiesOIS[1]); })
+        || corrupt([&](SnapshotRecord& r, std::vector<char>& b) { setMaturity(b, r.maturities, 0, std::numeric_limits<double>::infinity()); });
+    file.close();
+    std::filesystem::remove(path);
+    if (corruptOpened)
+    {
+        std::cout << "\nA snapshot with corrupt indexing fields was mapped\n";
+        return 1;
+    }
+
+    std::cout << "\n*******************************************************************************************\n";
+    std::cout << "\n" << t_curves << " curves in a snapshot of " << std::filesystem::path(path).filename().string() << ": " << "\n";
+    std::cout << "written in " << writeTime << " ms, mapped and checked in " << openTime << " ms" << "\n";
+    std::cout << "OIS swaps priced on the mapped curves in " << mappedTime << " ms, on compiled copies in " << copiedTime
+        << " ms, largest difference " << difference << "\n";
+    std::cout << "\n*******************************************************************************************\n";
+
+    return 0;
+}
+
+// business days from t_iStart (yyyymmdd, a weekday) on, as yyyymmdd: a synthetic calendar without holidays
+std::vector<int> benchmarkBusinessDays(int t_iStart, size_t t_days)
+{
+    int year = t_iStart / 10000;
+    int month = t_iStart / 100 % 100;
+    int day = t_iStart % 100;
+    int weekday = 0; // days since t_iStart modulo 7
+    std::vector<int> dates;
+    while (dates.size() < t_days)
+    {
+        if (weekday < 5)
+        {
+            dates.push_back(10000 * year + 100 * month + day);
+        }
+        weekday = (weekday + 1) % 7;
+        bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+        int monthDays = month == 2 ? (leap ? 29 : 28) : (month == 4 || month == 6 || month == 9 || month == 11) ? 30 : 31;
+        if (++day > monthDays)
+        {
+            day = 1;
+            if (++month > 12)
+            {
+                month = 1;
+                year++;
+            }
+        }
+    }
+    return dates;
+}
+
+// t_days business days of OIS and EUR3M quotes (the market data moved by a random walk, 1bp a day for the
+// level and 0.2bp per quote) written to a csv file, with dates starting on a Monday
+std::string benchmarkQuoteFile(size_t t_days)
+{
+    std::mt19937_64 generator(42);
+    std::normal_distribution<Value> level(0., 1E-4);
+    std::normal_distribution<Value> quote(0., 0.2E-4);
+    std::vector<Value> oisQuotes = strikesOIS;
+    std::vector<Value> eur3mQuotes = strikesEUR3M;
+
+    std::string path = (std::filesystem::temp_directory_path() / "xva_quotes.csv").string();
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        return "";
+    }
+    std::fprintf(file, "date,curve,maturity,quote\n");
+    for (int date : benchmarkBusinessDays(20140106, t_days))
+    {
+        Value shift = level(generator);
+        for (size_t i = 0; i < oisQuotes.size(); i++)
+        {
+            oisQuotes[i] += shift + quote(generator);
+            std::fprintf(file, "%d,EUR-OIS,%.10g,%.10g\n", date, maturitiesOIS[i], oisQuotes[i]);
+        }
+        for (size_t i = 0; i < eur3mQuotes.size(); i++)
+        {
+            eur3mQuotes[i] += shift + quote(generator);
+            std::fprintf(file, "%d,EUR-3M,%.10g,%.10g\n", date, maturitiesEUR3M[i], eur3mQuotes[i]);
+        }
+    }
+    std::fclose(file);
+    return path;
+}
+
+// OIS swaps, and EUR3M swaps discounted on t_discount, on the quotes of one date
+auto historicalOISSwaps(CurveQuotes const& t_quotes)
+{
+    return [&t_quotes](auto& myCurve)
+    {
+        std::vector<SwapOn<decltype(myCurve)>> mySwapVect;
+        for (size_t i = 0; i < t_quotes.maturities.size(); i++)
+        {
+            Time maturity = t_quotes.maturities[i];
+            int nbOfPayments = (int)(maturity > 1 ? maturity : 1);
+            mySwapVect.emplace_back(SwapType::PAYER, notional, t_quotes.quotes[i], 0., 0., maturity, nbOfPayments, myCurve);
+        }
+        return mySwapVect;
+    };
+}
+
+auto historicalEUR3MSwaps(CurveQuotes const& t_quotes, YieldCurve const& t_discount)
+{
+    return [&t_quotes, &t_discount](auto& myCurve)
+    {
+        std::vector<SwapOn<decltype(myCurve)>> mySwapVect;
+        for (size_t i = 0; i < t_quotes.maturities.size(); i++)
+        {
+            Time maturity = t_quotes.maturities[i];
+            int nbOfPayments = (int)(maturity > 1 ? 4 * maturity : 4);
+            mySwapVect.emplace_back(SwapType::PAYER, notional, t_quotes.quotes[i], 0., 0., maturity, nbOfPayments,
+                std::decay_t<decltype(myCurve)>(t_discount), myCurve);
+        }
+        return mySwapVect;
+    };
+}
+
+// 10 years of daily OIS and EUR3M quotes streamed from a csv file into bootstraps, each date warm-started from
+// the curves of the date before: parsing alone, then parsing overlapped with the strips
+int benchmarkQuoteStreaming(size_t t_days = 2610)
+{
+    std::string path = benchmarkQuoteFile(t_days);
+    if (path.empty())
+    {
+        std::cout << "\nCould not write the quote file" << "\n";
+        return 1;
+    }
+
+    QuoteReader reader;
+    QuoteDate quotes;
+    size_t rows = 0;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    reader.open(path);
+    while (reader.next(quotes))
+    {
+        for (size_t c = 0; c < quotes.curveCount; c++)
+        {
+            rows += quotes.curves[c].quotes.size();
+        }
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    double parseTime = std::chrono::duration<double, std::milli>(end - begin).count();
+    reader.close();
+
+    std::vector<Value> oisRates = initialRatesOIS;
+    std::vector<Value> eur3mRates = initialRatesEUR3M;
+    Value largestError = 0.;
+    begin = std::chrono::steady_clock::now();
+    long dates = streamQuotes(path, [&](QuoteDate const& t_quotes)
+    {
+        CurveQuotes const* ois = t_quotes.find("EUR-OIS");
+        CurveQuotes const* eur3m = t_quotes.find("EUR-3M");
+        if (!ois || !eur3m)
+        {
+            return;
+        }
+
+        Stripper<Swap> oisStripper(ois->maturities, oisRates, historicalOISSwaps(*ois), LOGLINEAR_ON_EXP_X_TIMES_Y);
+        oisStripper.calibrate(SEQUENTIAL_BOOTSTRAP);
+        YieldCurve oisCurve = oisStripper.getZeroCoupon();
+        oisRates = oisCurve.interestRates();
+
+        Stripper<Swap> eur3mStripper(eur3m->maturities, eur3mRates, historicalEUR3MSwaps(*eur3m, oisCurve), LOGLINEAR_ON_EXP_X_TIMES_Y);
+        eur3mStripper.calibrate(SEQUENTIAL_BOOTSTRAP);
+        eur3mRates = eur3mStripper.getZeroCoupon().interestRates();
+
+        for (Value swapPrice : eur3mStripper.evaluateInstruments())
+        {
+            largestError = std::max(largestError, std::abs(swapPrice));
+        }
+    });
+    end = std::chrono::steady_clock::now();
+    double pipelineTime = std::chrono::duration<double, std::milli>(end - begin).count();
+    std::filesystem::remove(path);
+
+    std::cout << "\n*******************************************************************************************\n";
+    std::cout << "\n" << rows << " quotes on " << dates << " dates: " << "\n";
+    std::cout << "parsed in " << parseTime << " ms, " << rows / parseTime / 1E3 << " million rows per second" << "\n";
+    std::cout << "parsed and stripped (OIS then EUR3M) in " << pipelineTime << " ms, " << pipelineTime / dates
+        << " ms per date, largest EUR3M swap price " << largestError << "\n";
+    std::cout << "\n*******************************************************************************************\n";
+
+    return 0;
+}
+
+// the OIS and EUR3M curves of 10 years of daily quotes calibrated on one thread, then on the pool, in
+// chunks of t_chunk dates warm-started from the day before: throughput and largest difference of the curves
+int benchmarkHistoricalCalibration(size_t t_days = 2610, size_t t_chunk = 64)
+{
+    std::string path = benchmarkQuoteFile(t_days);
+    std::vector<QuoteDate> dates;
+    long read = path.empty() ? -1 : streamQuotes(path, [&](QuoteDate const& t_quotes) { dates.push_back(t_quotes); });
+    if (read < 0)
+    {
+        std::cout << "\nCould not write or read the quote file" << "\n";
+        return 1;
+    }
+    std::filesystem::remove(path);
+
+    HistoricalCalibrator calibrator;
+    calibrator.setChunkSize(t_chunk);
+    HistoricalCurve ois;
+    ois.name = "EUR-OIS";
+    ois.stripper = [](CurveQuotes const& t_quotes, std::vector<Value> const& t_vdInitialRates, std::vector<YieldCurve> const&)
+    {
+        return Stripper<Swap>(t_quotes.maturities, t_vdInitialRates, historicalOISSwaps(t_quotes), LOGLINEAR_ON_EXP_X_TIMES_Y);
+    };
+    calibrator.addCurve(ois);
+    HistoricalCurve eur3m;
+    eur3m.name = "EUR-3M";
+    eur3m.stripper = [](CurveQuotes const& t_quotes, std::vector<Value> const& t_vdInitialRates, std::vector<YieldCurve> const& t_vCurves)
+    {
+        return Stripper<Swap>(t_quotes.maturities, t_vdInitialRates, historicalEUR3MSwaps(t_quotes, t_vCurves[0]), LOGLINEAR_ON_EXP_X_TIMES_Y);
+    };
+    calibrator.addCurve(eur3m);
+
+    HistoricalStatistics serial;
+    std::vector<CurveSnapshot> serialCurves = calibrator.calibrate(dates, &serial);
+
+    ThreadPool pool;
+    calibrator.setThreadPool(pool);
+    HistoricalStatistics parallel;
+    std::vector<CurveSnapshot> parallelCurves = calibrator.calibrate(dates, &parallel);
+
+    Value largestDifference = serialCurves.size() == parallelCurves.size() ? 0. : 1E10;
+    for (size_t c = 0; c < serialCurves.size() && c < parallelCurves.size(); c++)
+    {
+        std::vector<Value> const& serialRates = serialCurves[c].curve.interestRates();
+        std::vector<Value> const& parallelRates = parallelCurves[c].curve.interestRates();
+        for (size_t k = 0; k < serialRates.size(); k++)
+        {
+            largestDifference = std::max(largestDifference, std::abs(serialRates[k] - parallelRates[k]));
+        }
+    }
+
+    std::cout << "\n*******************************************************************************************\n";
+    std::cout << "\n" << serial.curves << " curves on " << serial.dates << " dates, chunks of " << t_chunk << " dates: " << "\n";
+    std::cout << "1 thread: " << serial.seconds << " s, " << serial.curvesPerSecond() << " curves per second" << "\n";
+    std::cout << pool.size() << " threads: " << parallel.seconds << " s, " << parallel.curvesPerSecond() << " curves per second"
+        << ", largest swap price " << parallel.largestResidual << ", largest rate difference " << largestDifference << "\n";
+    std::cout << "\n*******************************************************************************************\n";
+
+    return 0;
+}
+
+// t_trades quarterly swaps on the TARGET calendar (modified following, ACT/360), of random start and maturity up
+// to 30 years so that most have a short front stub: schedules generated once, then the book priced on their
+// cached times and accruals, one swap at a time and as a SwapPortfolio
+int benchmarkSchedules(size_t t_trades = 10000)
+{
+    YieldCurve oisCurve = benchmarkOISCurve();
+    FrozenYieldCurve frozenCurve(oisCurve);
+    Calendar calendar(TARGET);
+    Date today(2024, 1, 15);
+    std::mt19937_64 generator(42);
+    std::uniform_int_distribution<int> startDays(2, 365);
+    std::uniform_int_distribution<int> lengthDays(365, 30 * 365);
+
+    std::vector<Swap> swaps;
+    swaps.reserve(t_trades);
+    size_t periods = 0;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < t_trades; i++)
+    {
+        Date start = calendar.adjust(today.addDays(startDays(generator)), FOLLOWING);
+        Date end = start.addDays(lengthDays(generator));
+        Schedule schedule = makeSchedule(today, start, end, 3, calendar, MODIFIED_FOLLOWING, ACT_360, SHORT_FRONT);
+        periods += schedule.periods();
+        swaps.emplace_back(PAYER, notional, 0.03, 0., std::move(schedule), oisCurve, oisCurve);
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    double scheduleTime = std::chrono::duration<double, std::milli>(end - begin).count();
+
+    std::vector<Value> swapPrices(t_trades);
+    begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < t_trades; i++)
+    {
+        swapPrices[i] = price(swaps[i], frozenCurve, frozenCurve);
+    }
+    end = std::chrono::steady_clock::now();
+    double swapTime = std::chrono::duration<double, std::milli>(end - begin).count();
+
+    SwapPortfolio portfolio(swaps);
+    begin = std::chrono::steady_clock::now();
+    std::vector<Value> bookPrices = priceVector(portfolio, frozenCurve, frozenCurve);
+    end = std::chrono::steady_clock::now();
+    double bookTime = std::chrono::duration<double, std::milli>(end - begin).count();
+
+    Value largestDifference = 0.;
+    for (size_t i = 0; i < t_trades; i++)
+    {
+        largestDifference = std::max(largestDifference, std::abs(swapPrices[i] - bookPrices[i]));
+    }
+
+    std::cout << "\n*******************************************************************************************\n";
+    std::cout << "\n" << t_trades << " swaps, " << periods << " periods: " << "\n";
+    std::cout << "schedules generated in " << scheduleTime << " ms, " << 1E3 * scheduleTime / t_trades << " us per trade" << "\n";
+    std::cout << "priced one by one in " << swapTime << " ms, as a book in " << bookTime << " ms"
+        << ", largest difference " << largestDifference << "\n";
+    std::cout << "\n*******************************************************************************************\n";
+
+    return 0;
+}
+
+// bucketed DV01 of t_trades OIS and EUR3M swaps (random maturities up to 30 years, discounted on OIS) against
+// the 52 quotes of the joint OIS and EUR3M calibration: adjoint through the calibrated jacobian, for every
+// trade and for the book, against central differences of the book over 2 x 52 recalibrations
+int benchmarkRisk(size_t t_trades = 50000)
+{
+    std::vector<Value> oisQuotes = strikesOIS;
+    std::vector<Value> eur3mQuotes = strikesEUR3M;
+    auto oisSwaps = [&](auto& curves)
+    {
+        std::vector<SwapOn<decltype(curves[0])>> mySwapVect;
+        for (size_t i = 0; i < maturitiesOIS.size(); i++)
+        {
+            int nbOfPayments = (int)(maturitiesOIS[i] > 1 ? maturitiesOIS[i] : 1);
+            mySwapVect.emplace_back(SwapType::PAYER, notional, oisQuotes[i], 0., 0., maturitiesOIS[i], nbOfPayments, curves[0]);
+        }
+        return mySwapVect;
+    };
+    auto eur3mSwaps = [&](auto& curves)
+    {
+        std::vector<SwapOn<decltype(curves[0])>> mySwapVect;
+        for (size_t i = 0; i < maturitiesEUR3M.size(); i++)
+        {
+            int nbOfPayments = (int)(maturitiesEUR3M[i] > 1 ? 4 * maturitiesEUR3M[i] : 4);
+            mySwapVect.emplace_back(SwapType::PAYER, notional, eur3mQuotes[i], 0., 0., maturitiesEUR3M[i], nbOfPayments, curves[0], curves[1]);
+        }
+        return mySwapVect;
+    };
+
+    MultiCurveStripper stripper;
+    stripper.addCurve(maturitiesOIS, initialRatesOIS, { 0 }, oisSwaps, LOGLINEAR_ON_EXP_X_TIMES_Y);
+    stripper.addCurve(maturitiesEUR3M, initialRatesEUR3M, { 0 }, eur3mSwaps, LOGLINEAR_ON_EXP_X_TIMES_Y);
+    stripper.calibrate();
+
+    std::mt19937_64 generator(42);
+    std::uniform_real_distribution<Time> maturity(1., 30.);
+    std::uniform_real_distribution<Value> strike(0., 0.04);
+    YieldCurve oisCurve = stripper.getZeroCoupon(0);
+    YieldCurve eur3mCurve = stripper.getZeroCoupon(1);
+    std::vector<Swap> swaps;
+    std::vector<size_t> discountCurves(t_trades, 0);
+    std::vector<size_t> forwardCurves;
+    for (size_t k = 0; k < t_trades; k++)
+    {
+        Time end = maturity(generator);
+        SwapType swapType = k % 3 == 0 ? RECEIVER : PAYER;
+        if (k % 2 == 0)
+        {
+            swaps.emplace_back(swapType, notional, strike(generator), 0., 0., end, (size_t)end + 1, oisCurve);
+            forwardCurves.push_back(0);
+        }
+        else
+        {
+            swaps.emplace_back(swapType, notional, strike(generator), 0., 0., end, (size_t)(4 * end) + 1, oisCurve, eur3mCurve);
+            forwardCurves.push_back(1);
+        }
+    }
+
+    auto bookValue = [&]()
+    {
+        FrozenYieldCurve ois = stripper.getFrozenZeroCoupon(0);
+        FrozenYieldCurve eur3m = stripper.getFrozenZeroCoupon(1);
+        Value value = 0.;
+        for (size_t k = 0; k < t_trades; k++)
+        {
+            value += price(swaps[k], ois, forwardCurves[k] == 0 ? ois : eur3m);
+        }
+        return value;
+    };
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    Matrix<Value> tradeDV01 = bucketedDV01(stripper, swaps, discountCurves, forwardCurves);
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    double tradeTime = std::chrono::duration<double, std::milli>(end - begin).count();
+
+    begin = std::chrono::steady_clock::now();
+    std::vector<Value> bookDV01 = portfolioDV01(stripper, swaps, discountCurves, forwardCurves);
+    end = std::chrono::steady_clock::now();
+    double bookTime = std::chrono::duration<double, std::milli>(end - begin).count();
+
+    // central differences of the book, every quote moved by 1E-6 both ways and the curves calibrated again
+    Value bump = 1E-6;
+    std::vector<Value> finiteDifferenceDV01;
+    begin = std::chrono::steady_clock::now();
+    for (size_t q = 0; q < stripper.unknowns(); q++)
+    {
+        Value& quote = q < oisQuotes.size() ? oisQuotes[q] : eur3mQuotes[q - oisQuotes.size()];
+        quote += bump;
+        stripper.calibrate();
+        Value up = bookValue();
+        quote -= 2 * bump;
+        stripper.calibrate();
+        Value down = bookValue();
+        quote += bump;
+        finiteDifferenceDV01.push_back((up - down) / (2 * bump) * 1E-4);
+    }
+    end = std::chrono::steady_clock::now();
+    double finiteDifferenceTime = std::chrono::duration<double, std::milli>(end - begin).count();
+
+    Value largestBook = 0.;
+    Value largestDifference = 0.;
+    Value largestTradeDifference = 0.;
+    for (size_t q = 0; q < bookDV01.size(); q++)
+    {
+        Value tradeSum = 0.;
+        for (size_t k = 0; k < t_trades; k++)
+        {
+            tradeSum += tradeDV01(q, k);
+        }
+        largestBook = std::max(largestBook, std::abs(bookDV01[q]));
+        largestDifference = std::max(largestDifference, std::abs(bookDV01[q] - finiteDifferenceDV01[q]));
+        largestTradeDifference = std::max(largestTradeDifference, std::abs(bookDV01[q] - tradeSum));
+    }
+
+    std::cout << "\n*******************************************************************************************\n";
+    std::cout << "\nDV01 of " << t_trades << " swaps against " << bookDV01.size() << " OIS and EUR3M quotes: " << "\n";
+    std::cout << "adjoint, every trade: " << tradeTime << " ms, the book: " << bookTime << " ms" << "\n";
+    std::cout << "central differences of the book over " << 2 * bookDV01.size() << " calibrations: " << finiteDifferenceTime << " ms" << "\n";
+    std::cout << "largest book DV01 " << largestBook << ", largest difference to the central differences " << largestDifference
+        << ", to the sum of the trades " << largestTradeDifference << "\n";
+    std::cout << "\n*******************************************************************************************\n";
+
+    return 0;
+}
+
+// historical VaR of t_trades OIS and EUR3M swaps: the 1 day moves of the last t_scenarios dates of a 10 year
+// quote history applied to the quotes of its last date, the curves stripped again for every scenario, then
+// parallel stress shifts of the quotes and of the zero rates
+int benchmarkScenarios(size_t t_trades = 10000, size_t t_scenarios = 500)
+{
+    std::string path = benchmarkQuoteFile(2610);
+    std::vector<QuoteDate> dates;
+    long read = path.empty() ? -1 : streamQuotes(path, [&](QuoteDate const& t_quotes) { dates.push_back(t_quotes); });
+    if (read < 0)
+    {
+        std::cout << "\nCould not write or read the quote file" << "\n";
+        return 1;
+    }
+    std::filesystem::remove(path);
+
+    ScenarioEngine engine;
+    HistoricalCurve ois;
+    ois.name = "EUR-OIS";
+    ois.stripper = [](CurveQuotes const& t_quotes, std::vector<Value> const& t_vdInitialRates, std::vector<YieldCurve> const&)
+    {
+        return Stripper<Swap>(t_quotes.maturities, t_vdInitialRates, historicalOISSwaps(t_quotes), LOGLINEAR_ON_EXP_X_TIMES_Y);
+    };
+    engine.addCurve(ois, *dates.back().find("EUR-OIS"));
+    HistoricalCurve eur3m;
+    eur3m.name = "EUR-3M";
+    eur3m.stripper = [](CurveQuotes const& t_quotes, std::vector<Value> const& t_vdInitialRates, std::vector<YieldCurve> const& t_vCurves)
+    {
+        return Stripper<Swap>(t_quotes.maturities, t_vdInitialRates, historicalEUR3MSwaps(t_quotes, t_vCurves[0]), LOGLINEAR_ON_EXP_X_TIMES_Y);
+    };
+    engine.addCurve(eur3m, *dates.back().find("EUR-3M"));
+
+    std::mt19937_64 generator(42);
+    std::uniform_real_distribution<Time> maturity(1., 30.);
+    std::uniform_real_distribution<Value> strike(0., 0.04);
+    std::vector<Swap> oisSwaps;
+    std::vector<Swap> eur3mSwaps;
+    YieldCurve flat({ 1. }, { 0.02 });
+    for (size_t k = 0; k < t_trades; k++)
+    {
+        Time end = maturity(generator);
+        SwapType swapType = k % 3 == 0 ? RECEIVER : PAYER;
+        if (k % 2 == 0)
+        {
+            oisSwaps.emplace_back(swapType, notional, strike(generator), 0., 0., end, (size_t)end + 1, flat);
+        }
+        else
+        {
+            eur3mSwaps.emplace_back(swapType, notional, strike(generator), 0., 0., end, (size_t)(4 * end) + 1, flat);
+        }
+    }
+    SwapPortfolio oisBook(oisSwaps);
+    SwapPortfolio eur3mBook(eur3mSwaps);
+    engine.addBook(oisBook, 0, 0);
+    engine.addBook(eur3mBook, 0, 1);
+    engine.calibrate();
+
+    std::vector<Scenario> scenarios = engine.historicalScenarios(dates);
+    scenarios.erase(scenarios.begin(), scenarios.end() - std::min(t_scenarios, scenarios.size()));
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    std::vector<Value> serialPnL = engine.run(scenarios);
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    double serialTime = std::chrono::duration<double, std::milli>(end - begin).count();
+
+    ThreadPool pool;
+    engine.setThreadPool(pool);
+    Matrix<Value> tradePnL;
+    begin = std::chrono::steady_clock::now();
+    std::vector<Value> pnl = engine.run(scenarios, &tradePnL);
+    end = std::chrono::steady_clock::now();
+    double parallelTime = std::chrono::duration<double, std::milli>(end - begin).count();
+
+    Value largestDifference = 0.;
+    for (size_t s = 0; s < pnl.size(); s++)
+    {
+        largestDifference = std::max(largestDifference, std::abs(pnl[s] - serialPnL[s]));
+    }
+
+    std::vector<Scenario> stresses = {
+        engine.parallelShift("quotes +100bp", QUOTE_SHIFT, 0.01),
+        engine.parallelShift("quotes -100bp", QUOTE_SHIFT, -0.01),
+        engine.parallelShift("zero rates +100bp", ZERO_RATE_SHIFT, 0.01),
+        engine.parallelShift("zero rates -100bp", ZERO_RATE_SHIFT, -0.01) };
+    std::vector<Value> stressPnL = engine.run(stresses);
+
+    std::cout << "\n*******************************************************************************************\n";
+    std::cout << "\n" << t_trades << " swaps under " << scenarios.size() << " historical 1 day scenarios: " << "\n";
+    std::cout << "1 thread: " << serialTime << " ms, " << pool.size() << " threads: " << parallelTime << " ms, "
+        << 1E3 * scenarios.size() / parallelTime << " scenarios per second, largest difference " << largestDifference << "\n";
+    std::cout << "99% VaR " << valueAtRisk(pnl, 0.99) << ", expected shortfall " << expectedShortfall(pnl, 0.99) << "\n";
+    for (size_t s = 0; s < stresses.size(); s++)
+    {
+        std::cout << stresses[s].name << ": " << stressPnL[s] << "\n";
+    }
+    std::cout << "\n*******************************************************************************************\n";
+
+    return 0;
+}
+
+// nightly calibration of Hull-White to the swaptions of many dates: the co-terminal strips into 10Y and 20Y,
+// annual ATM swaptions quoted at the normal volatilities of a reference model moved by noise, fitted for the
+// mean reversion and one volatility per expiry, then a Jamshidian price against Monte Carlo
+int benchmarkHullWhiteCalibration(size_t t_dates = 200, Value t_dNoise = 0.02)
+{
+    YieldCurve curve = benchmarkOISCurve();
+    std::vector<Time> expiries = linspace<Time>(1., 9., 9);
+    HullWhite1Factor reference(curve, 0.04, expiries, { 0.006, 0.0065, 0.007, 0.0068, 0.0066, 0.0064, 0.0062, 0.006, 0.0058 });
+
+    std::vector<Swap> swaps;
+    std::vector<Value> volatilities;
+    for (int end : { 10, 20 })
+    {
+        for (Time expiry : expiries)
+        {
+            HullWhiteSwaption forward = makeSwaption(Swap(PAYER, 1, 0., 0., expiry, end, (size_t)(end - expiry) + 1, curve), curve);
+            swaps.emplace_back(PAYER, 1, forward.forwardSwapRate, 0., expiry, end, (size_t)(end - expiry) + 1, curve);
+            HullWhiteSwaption atm = makeSwaption(swaps.back(), curve);
+            volatilities.push_back(impliedNormalVolatility(atm, jamshidianPrice(atm, reference)));
+        }
+    }
+
+    std::mt19937_64 generator(42);
+    std::normal_distribution<Value> noise(0., t_dNoise);
+    Value averageLambda = 0.;
+    Value largestError = 0.;
+    int jacobians = 0;
+    double seconds = 0.;
+    HullWhite1Factor model;
+    for (size_t d = 0; d < t_dates; d++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        HullWhiteCalibrator calibrator(curve);
+        for (size_t s = 0; s < swaps.size(); s++)
+        {
+            calibrator.addSwaption(swaps[s], volatilities[s] * (1. + noise(generator)));
+        }
+        jacobians += calibrator.calibrate();
+        std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+        seconds += std::chrono::duration<double>(stop - start).count();
+
+        averageLambda += calibrator.getMeanReversion() / t_dates;
+        for (Value error : calibrator.evaluateInstruments())
+        {
+            largestError = std::max(largestError, std::abs(error));
+        }
+        model = calibrator.getModel();
+    }
+
+    HullWhiteSwaption swaption = makeSwaption(swaps[4], curve);
+    size_t repetitions = 100000;
+    Value price = 0.;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < repetitions; r++)
+    {
+        price += jamshidianPrice(swaption, model) / repetitions;
+    }
+    std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+    double pricing = std::chrono::duration<double, std::nano>(stop - start).count() / repetitions;
+
+    // the option to pay the fixed leg, the payments as zero coupon weights, on the paths of the last model
+    size_t paths = 100000;
+    std::vector<Time> const& dates = swaps[4].getPaymentDates();
+    std::vector<Value> weights(dates.size(), 0.);
+    weights[0] = 1.;
+    for (size_t i = 1; i < dates.size(); i++)
+    {
+        weights[i] = -swaps[4].getAccruals()[i - 1] * swaps[4].getStrike();
+    }
+    weights.back() -= 1.;
+    HullWhite1FactorEngine engine(model, { dates[0] }, dates, paths);
+    engine.simulate();
+    std::vector<Value> values(paths);
+    engine.zeroCouponCombination(0, weights.data(), values.data());
+    Value monteCarlo = 0.;
+    for (size_t p = 0; p < paths; p++)
+    {
+        monteCarlo += engine.deflator(0)[p] * std::max(values[p], 0.) / paths;
+    }
+
+    std::cout << "\n*******************************************************************************************\n";
+    std::cout << "\nHull-White calibration to " << swaps.size() << " swaptions on " << t_dates << " dates: "
+        << 1E3 * seconds / t_dates << " ms per date, " << (double)jacobians / t_dates << " jacobians" << "\n";
+    std::cout << "average mean reversion " << averageLambda << " (reference 0.04), largest normal volatility error "
+        << 1E4 * largestError << "bp" << "\n";
+    std::cout << "Jamshidian " << swaption.expiry << "Y x " << swaption.tenors.back() << "Y " << price << " in " << pricing
+        << " ns, Monte Carlo " << monteCarlo << " on " << paths << " paths" << "\n";
+    std::cout << "\n*******************************************************************************************\n";
+
+    return 0;
+}
+
+// Bermudan payer swaption, 1Y into 10Y exercisable on every quarterly payment date, by Longstaff-Schwartz:
+// the price on the regression paths, the price of its boundary on fresh paths, against the European into the
+// whole swap and the largest of the co-terminal Europeans, both by Jamshidian
+int benchmarkBermudan(size_t t_paths = 50000, size_t t_exerciseDates = 40, Value t_dLambda = 0.03, Value t_dEta = 0.007)
+{
+    YieldCurve curve = benchmarkOISCurve();
+    HullWhite1Factor model(curve, t_dLambda, t_dEta);
+    Time start = 1.;
+    Time end = start + t_exerciseDates / 4.;
+    HullWhiteSwaption forward = makeSwaption(Swap(PAYER, 1, 0., 0., start, end, t_exerciseDates + 1, curve), curve);
+    Swap underlying(PAYER, 1, forward.forwardSwapRate, 0., start, end, t_exerciseDates + 1, curve);
+    std::vector<Time> const& paymentDates = underlying.getPaymentDates();
+    std::vector<Time> exerciseDates(paymentDates.begin(), paymentDates.end() - 1);
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    HullWhite1FactorEngine engine(model, exerciseDates, paymentDates, t_paths);
+    engine.simulate();
+    std::chrono::steady_clock::time_point simulated = std::chrono::steady_clock::now();
+    ExerciseBoundary boundary;
+    Value price = priceBermudan(underlying, exerciseDates, engine, &boundary);
+    std::chrono::steady_clock::time_point priced = std::chrono::steady_clock::now();
+
+    HullWhite1FactorEngine freshEngine(model, exerciseDates, paymentDates, t_paths, 9);
+    freshEngine.simulate();
+    std::vector<unsigned int> exercise;
+    Value freshPrice = exerciseBermudan(underlying, boundary, freshEngine, &exercise);
+    size_t exercised = std::count_if(exercise.begin(), exercise.end(), [&](unsigned int e) { return e < boundary.size(); });
+
+    Value largestEuropean = 0.;
+    for (size_t e = 0; e < exerciseDates.size(); e++)
+    {
+        Schedule schedule = equalSchedule(paymentDates[e], end, t_exerciseDates + 1 - e);
+        Swap coTerminal(PAYER, 1, underlying.getStrike(), 0., schedule, curve, curve);
+        largestEuropean = std::max(largestEuropean, jamshidianPrice(makeSwaption(coTerminal, curve), model));
+    }
+
+    std::cout << "\n*******************************************************************************************\n";
+    std::cout << "\nBermudan payer swaption " << start << "Y x " << end - start << "Y ATM (" << underlying.getStrike()
+        << "), " << t_exerciseDates << " exercise dates, " << t_paths << " paths: " << "\n";
+    std::cout << "simulation " << std::chrono::duration<double, std::milli>(simulated - begin).count() << " ms, regression "
+        << std::chrono::duration<double, std::milli>(priced - simulated).count() << " ms" << "\n";
+    std::cout << "price " << price << ", on fresh paths " << freshPrice << " (" << 100. * exercised / t_paths << "% exercised)"
+        << ", European " << jamshidianPrice(makeSwaption(underlying, curve), model) << ", largest co-terminal European "
+        << largestEuropean << "\n";
+    std::cout << "\n*******************************************************************************************\n";
+
+    return 0;
+}
+
+// Runs the benchmarks named on the command line, all of them without arguments, and reports the ones whose
+// checks failed. Returns the number of failures.
+int main(int argc, char** argv)
+{
+    std::vector<std::pair<std::string, std::function<int()>>> benchmarks = {
+        { "benchmarkInterpolation", [] { return benchmarkInterpolation(); } },
+        { "benchmarkSwapPortfolio", [] { return benchmarkSwapPortfolio(); } },
+        { "benchmarkSwapAllocations", [] { return benchmarkSwapAllocations(); } },
+        { "benchmarkThreadScaling", [] { return benchmarkThreadScaling(); } },
+        { "benchmarkJacobian", [] { return benchmarkJacobian(); } },
+        { "benchmarkHullWhite1Factor", [] { return benchmarkHullWhite1Factor(); } },
+        { "benchmarkHullWhite1FactorShortRate", [] { return benchmarkHullWhite1FactorShortRate(); } },
+        { "benchmarkExposures", [] { return benchmarkExposures(); } },
+        { "benchmarkRandomNumbers", [] { return benchmarkRandomNumbers(); } },
+        { "benchmarkLinearAlgebra", [] { return benchmarkLinearAlgebra(); } },
+        { "benchmarkNewtonMethods", [] { return benchmarkNewtonMethods(); } },
+        { "benchmarkRecalibration", [] { return benchmarkRecalibration(); } },
+        { "benchmarkMultiCurve", [] { return benchmarkMultiCurve(); } },
+        { "benchmarkSparseJacobian", [] { return benchmarkSparseJacobian(); } },
+        { "benchmarkSnapshot", [] { return benchmarkSnapshot(); } },
+        { "benchmarkQuoteStreaming", [] { return benchmarkQuoteStreaming(); } },
+        { "benchmarkHistoricalCalibration", [] { return benchmarkHistoricalCalibration(); } },
+        { "benchmarkSchedules", [] { return benchmarkSchedules(); } },
+        { "benchmarkRisk", [] { return benchmarkRisk(); } },
+        { "benchmarkScenarios", [] { return benchmarkScenarios(); } },
+        { "benchmarkHullWhiteCalibration", [] { return benchmarkHullWhiteCalibration(); } },
+        { "benchmarkBermudan", [] { return benchmarkBermudan(); } }
+    };
+
+    std::vector<std::string> selected(argv + 1, argv + argc);
+    for (std::string const& name : selected)
+    {
+        if (std::find_if(benchmarks.begin(), benchmarks.end(), [&](auto const& t_benchmark) { return t_benchmark.first == name; })
+            == benchmarks.end())
+        {
+            std::cout << "Unknown benchmark " << name << "\n";
+            return 1;
+        }
+    }
+
+    std::vector<std::string> failed;
+    for (auto const& benchmark : benchmarks)
+    {
+        if (!selected.empty() && std::find(selected.begin(), selected.end(), benchmark.first) == selected.end())
+        {
+            continue;
+        }
+        if (benchmark.second() != 0)
+        {
+            failed.push_back(benchmark.first);
+        }
+    }
+
+    for (std::string const& name : failed)
+    {
+        std::cout << "FAILED: " << name << "\n";
+    }
+    return (int)failed.size();
+}
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <array>
+#include <limits>
+
+#include "Diffusion/HullWhite1Factor.h"
+
+using Time = double;
+using Value = double;
+
+// continuation value regressed on 1, z, z^2 and the exercise value, z the factor over its standard deviation
+constexpr size_t bermudanBasisSize = 4;
+
+// Exercise rule of a Bermudan swaption found by Longstaff-Schwartz: on exercise date e the swap is entered on
+// a path when its value is positive and above the regressed continuation value. It only reads the factor and
+// the exercise value of a path, so that it applies to other paths of the same model, e.g. an exposure
+// simulation where the option turns into the swap on the path after its exercise.
+struct ExerciseBoundary
+{
+	std::vector<Time> dates;
+	std::vector<Value> factorDeviations;                               // sqrt(Var x) on every date
+	std::vector<std::array<Value, bermudanBasisSize>> coefficients; // of the basis on every date
+
+	size_t size() const
+	{
+		return dates.size();
+	}
+
+	Value continuation(size_t t_date, Value t_dFactor, Value t_dExerciseValue) const
+	{
+		std::array<Value, bermudanBasisSize> const& beta = coefficients[t_date];
+		Value z = t_dFactor / factorDeviations[t_date];
+		return beta[0] + z * (beta[1] + z * beta[2]) + beta[3] * t_dExerciseValue;
+	}
+
+	bool exercise(size_t t_date, Value t_dFactor, Value t_dExerciseValue) const
+	{
+		return t_dExerciseValue > 0. && t_dExerciseValue > continuation(t_date, t_dFactor, t_dExerciseValue);
+	}
+};
+
+// indices of t_vdTimes in t_vdGrid, false when one of them is not on it
+inline bool bermudanGridIndices(std::vector<Time> const& t_vdTimes, std::vector<Time> const& t_vdGrid, std::vector<size_t>& t_viIndices)
+{
+	t_viIndices.resize(t_vdTimes.size());
+	for (size_t i = 0; i < t_vdTimes.size(); i++)
+	{
+		size_t index = std::lower_bound(t_vdGrid.begin(), t_vdGrid.end(), t_vdTimes[i] - 1E-10) - t_vdGrid.begin();
+		if (index == t_vdGrid.size() || std::abs(t_vdGrid[index] - t_vdTimes[i]) > 1E-10)
+		{
+			return false;
+		}
+		t_viIndices[i] = index;
+	}
+	return true;
+}
+
+// Zero coupon weights, on the maturities of the engine, of the swap entered on its payment date t_iStart:
+// P(t, T_start) - P(t, T_n) - sum delta_i K P(t, T_i) for a payer, on the discount curve simulated
+inline void bermudanExerciseWeights(Swap const& t_underlying, std::vector<size_t> const& t_viMaturities, size_t t_iStart,
+	std::vector<Value>& t_vdWeights)
+{
+	Value notional = t_underlying.getSwapType() == PAYER ? (Value)t_underlying.getNotional() : -(Value)t_underlying.getNotional();
+	std::vector<Time> const& accruals = t_underlying.getAccruals();
+	std::fill(t_vdWeights.begin(), t_vdWeights.end(), 0.);
+	t_vdWeights[t_viMaturities[t_iStart]] += notional;
+	t_vdWeights[t_viMaturities.back()] -= notional;
+	for (size_t i = t_iStart + 1; i < t_viMaturities.size(); i++)
+	{
+		t_vdWeights[t_viMaturities[i]] -= notional * accruals[i - 1] * t_underlying.getStrike();
+	}
+}
+
+// the exercise values of every path on simulation date t_iDate
+inline void bermudanExerciseValues(HullWhite1FactorEngine const& t_engine, size_t t_iDate, Value const* t_vdWeights, Value* out,
+	ThreadPool* t_pThreadPool)
+{
+	if (t_pThreadPool)
+	{
+		t_pThreadPool->parallelFor(t_engine.paths(), [&](size_t begin, size_t end)
+		{
+			t_engine.zeroCouponCombination(t_iDate, t_vdWeights, out, begin, end);
+		}, 256);
+	}
+	else
+	{
+		t_engine.zeroCouponCombination(t_iDate, t_vdWeights, out);
+	}
+}
+
+// Bermudan swaption by least squares Monte Carlo on the paths of a Hull-White engine: the right to enter, on
+// any of t_vdExerciseDates, the periods of t_underlying starting on or after it. The exercise dates have to
+// be payment dates of the swap (but the last) and simulation dates of the engine, the payment dates
+// maturities of the engine: HullWhite1FactorEngine(model, exerciseDates, underlying.getPaymentDates(), paths).
+// Backward from the last date, the deflated cash flows of the exercises found so far are regressed on the
+// in the money paths: their basis matrix is filled column by column in one aligned block, its normal
+// equations (bermudanBasisSize unknowns) solved by Cholesky. The boundary is written to t_pBoundary when
+// given. Returns the price, or -1 when the dates are not on the grids.
+inline Value priceBermudan(Swap const& t_underlying,
+	std::vector<Time> const& t_vdExerciseDates,
+	HullWhite1FactorEngine const& t_engine,
+	ExerciseBoundary* t_pBoundary = nullptr,
+	ThreadPool* t_pThreadPool = nullptr)
+{
+	std::vector<Time> const& paymentDates = t_underlying.getPaymentDates();
+	std::vector<size_t> maturities;
+	std::vector<size_t> simulationDates;
+	std::vector<size_t> starts;
+	if (t_vdExerciseDates.empty()
+		|| !bermudanGridIndices(paymentDates, t_engine.maturities(), maturities)
+		|| !bermudanGridIndices(t_vdExerciseDates, t_engine.simulationDates(), simulationDates)
+		|| !bermudanGridIndices(t_vdExerciseDates, paymentDates, starts)
+		|| starts.back() + 1 >= paymentDates.size())
+	{
+		return -1.;
+	}
+
+	size_t paths = t_engine.paths();
+	size_t exerciseDates = t_vdExerciseDates.size();
+	ExerciseBoundary boundary;
+	boundary.dates = t_vdExerciseDates;
+	boundary.factorDeviations.resize(exerciseDates);
+	boundary.coefficients.assign(exerciseDates, std::array<Value, bermudanBasisSize>{});
+
+	std::vector<Value> weights(t_engine.maturities().size());
+	std::vector<Value> exerciseValues(paths);
+	std::vector<Value> cashFlows(paths, 0.); // deflated, of the exercise found on every path
+	std::vector<size_t> inTheMoney(paths);
+	Matrix<Value> basis;
+	Matrix<Value> normal(bermudanBasisSize, bermudanBasisSize);
+	std::vector<Value> targets(paths);
+
+	for (size_t e = exerciseDates; e-- > 0;)
+	{
+		size_t k = simulationDates[e];
+		bermudanExerciseWeights(t_underlying, maturities, starts[e], weights);
+		bermudanExerciseValues(t_engine, k, weights.data(), exerciseValues.data(), t_pThreadPool);
+		Value const* factor = t_engine.factor(k);
+		Value const* deflator = t_engine.deflator(k);
+		Value deviation = sqrt(t_engine.model().moments(0., t_vdExerciseDates[e]).factorVariance);
+		boundary.factorDeviations[e] = deviation > 0. ? deviation : 1.;
+
+		size_t count = 0;
+		for (size_t p = 0; p < paths; p++)
+		{
+			if (exerciseValues[p] > 0.)
+			{
+				inTheMoney[count++] = p;
+			}
+		}
+
+		// on the last date exercised whenever in the money, never with too few paths to regress on
+		std::array<Value, bermudanBasisSize>& beta = boundary.coefficients[e];
+		if (e + 1 < exerciseDates && count < 4 * bermudanBasisSize)
+		{
+			beta[0] = std::numeric_limits<Value>::infinity();
+		}
+		else if (e + 1 < exerciseDates)
+		{
+			// columns 1, z, z^2 and the exercise value over its largest size, continuation values in the money
+			basis.resize(count, bermudanBasisSize);
+			Value* constant = basis.column(0);
+			Value* z = basis.column(1);
+			Value* squared = basis.column(2);
+			Value* value = basis.column(3);
+			Value scale = 0.;
+			for (size_t i = 0; i < count; i++)
+			{
+				size_t p = inTheMoney[i];
+				constant[i] = 1.;
+				z[i] = factor[p] / boundary.factorDeviations[e];
+				squared[i] = z[i] * z[i];
+				value[i] = exerciseValues[p];
+				targets[i] = cashFlows[p] / deflator[p];
+				scale = std::max(scale, exerciseValues[p]);
+			}
+			for (size_t i = 0; i < count; i++)
+			{
+				value[i] /= scale;
+			}
+
+			std::array<Value, bermudanBasisSize> rhs;
+			for (size_t j = 0; j < bermudanBasisSize; j++)
+			{
+				Value const* column = basis.column(j);
+				for (size_t l = 0; l <= j; l++)
+				{
+					normal(l, j) = std::inner_product(column, column + count, basis.column(l), 0.);
+				}
+				rhs[j] = std::inner_product(column, column + count, targets.begin(), 0.);
+			}
+			if (choleskyFactorize((int)bermudanBasisSize, normal.data(), (int)normal.leadingDimension()) != 0)
+			{
+				beta[0] = std::numeric_limits<Value>::infinity();
+			}
+			else
+			{
+				choleskySolve((int)bermudanBasisSize, normal.data(), (int)normal.leadingDimension(), rhs.data());
+				beta = rhs;
+				beta[3] /= scale;
+			}
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			size_t p = inTheMoney[i];
+			if (boundary.exercise(e, factor[p], exerciseValues[p]))
+			{
+				cashFlows[p] = deflator[p] * exerciseValues[p];
+			}
+		}
+	}
+
+	if (t_pBoundary)
+	{
+		*t_pBoundary = std::move(boundary);
+	}
+	return std::accumulate(cashFlows.begin(), cashFlows.end(), 0.) / paths;
+}
+
+// Exercise of the Bermudan swaption on other paths (of the same model) by a boundary of priceBermudan: the
+// price, without the foresight of the paths the boundary was regressed on (a lower bound up to the Monte
+// Carlo error), and in t_pExercise the index of the exercise date of every path, boundary.size() when never
+// exercised. Returns -1 when the dates are not on the grids.
+inline Value exerciseBermudan(Swap const& t_underlying,
+	ExerciseBoundary const& t_boundary,
+	HullWhite1FactorEngine const& t_engine,
+	std::vector<unsigned int>* t_pExercise = nullptr,
+	ThreadPool* t_pThreadPool = nullptr)
+{
+	std::vector<Time> const& paymentDates = t_underlying.getPaymentDates();
+	std::vector<size_t> maturities;
+	std::vector<size_t> simulationDates;
+	std::vector<size_t> starts;
+	if (!bermudanGridIndices(paymentDates, t_engine.maturities(), maturities)
+		|| !bermudanGridIndices(t_boundary.dates, t_engine.simulationDates(), simulationDates)
+		|| !bermudanGridIndices(t_boundary.dates, paymentDates, starts))
+	{
+		return -1.;
+	}
+
+	size_t paths = t_engine.paths();
+	std::vector<unsigned int> exercise(paths, (unsigned int)t_boundary.size());
+	std::vector<Value> weights(t_engine.maturities().size());
+	std::vector<Value> exerciseValues(paths);
+	Value price = 0.;
+	for (size_t e = 0; e < t_boundary.size(); e++)
+	{
+		size_t k = simulationDates[e];
+		bermudanExerciseWeights(t_underlying, maturities, starts[e], weights);
+		bermudanExerciseValues(t_engine, k, weights.data(), exerciseValues.data(), t_pThreadPool);
+		Value const* factor = t_engine.factor(k);
+		Value const* deflator = t_engine.deflator(k);
+		for (size_t p = 0; p < paths; p++)
+		{
+			if (exercise[p] == t_boundary.size() && t_boundary.exercise(e, factor[p], exerciseValues[p]))
+			{
+				exercise[p] = (unsigned int)e;
+				price += deflator[p] * exerciseValues[p];
+			}
+		}
+	}
+
+	if (t_pExercise)
+	{
+		*t_pExercise = std::move(exercise);
+	}
+	return price / paths;
+}
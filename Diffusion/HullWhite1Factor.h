@@ -1 +1,459 @@
 #pragma once
+
+#include "../Instruments/InterestRate.h"
+#include "../Random.h"
+#include "../ThreadPool.h"
+
+using Time = double;
+using Value = double;
+
+// Moments of the Hull-White factor over [s, t] given x(s): the variance of x(t), its covariance with int_s^t x
+// and the variance of int_s^t x
+struct HullWhiteMoments
+{
+	Value factorVariance = 0.;
+	Value covariance = 0.;
+	Value integralVariance = 0.;
+};
+
+// Hull-White one factor short rate dr = (theta(t) - lambda r) dt + eta(t) dW fitted to an initial curve, eta
+// piecewise constant (constant by default). The rate is written r(t) = x(t) + phi(t), x being the
+// Ornstein-Uhlenbeck factor dx = -lambda x dt + eta dW started at 0, so that theta never has to be computed:
+// zero coupons and the deflator exp(-int r) only need the initial discount factors and the moments of x.
+class HullWhite1Factor
+{
+public:
+	HullWhite1Factor() {}
+	HullWhite1Factor(YieldCurve const& t_ZeroCoupon, Value t_dLambda, Value t_dEta)
+		: m_ZeroCoupon(t_ZeroCoupon),
+		m_dLambda(t_dLambda),
+		m_vdEta{ t_dEta }
+	{}
+	// eta_i on (t_(i-1), t_i], t_vdVolatilityTimes holding the t_i but the last one: the last volatility also
+	// runs after them. Without volatilities, or with fewer times than that, the model is left without any
+	// (deterministic, as default constructed).
+	HullWhite1Factor(YieldCurve const& t_ZeroCoupon, Value t_dLambda, std::vector<Time> const& t_vdVolatilityTimes,
+		std::vector<Value> const& t_vdEta)
+		: m_ZeroCoupon(t_ZeroCoupon),
+		m_dLambda(t_dLambda)
+	{
+		if (!t_vdEta.empty() && t_vdVolatilityTimes.size() + 1 >= t_vdEta.size())
+		{
+			m_vdVolatilityTimes.assign(t_vdVolatilityTimes.begin(), t_vdVolatilityTimes.begin() + (t_vdEta.size() - 1));
+			m_vdEta = t_vdEta;
+		}
+	}
+
+	Value getLambda() const
+	{
+		return m_dLambda;
+	}
+	std::vector<Time> const& getVolatilityTimes() const
+	{
+		return m_vdVolatilityTimes;
+	}
+	std::vector<Value> const& getVolatilities() const
+	{
+		return m_vdEta;
+	}
+	FrozenYieldCurve const& getZeroCoupon() const
+	{
+		return m_ZeroCoupon;
+	}
+
+	Value B(Time t, Time T) const
+	{
+		return (1. - exp(-m_dLambda * (T - t))) / m_dLambda;
+	}
+
+	// Sums the closed form integrals of eta^2 exp(-2 lambda (t - u)), eta^2 exp(-lambda (t - u)) B(u, t) and
+	// eta^2 B(u, t)^2 over the pieces of the volatility within [s, t]
+	static HullWhiteMoments moments(Value t_dLambda, std::vector<Time> const& t_vdVolatilityTimes, std::vector<Value> const& t_vdEta,
+		Time s, Time t)
+	{
+		HullWhiteMoments moments;
+		for (size_t i = 0; i < t_vdEta.size(); i++)
+		{
+			Time begin = std::max(i == 0 ? 0. : t_vdVolatilityTimes[i - 1], s);
+			Time end = i + 1 < t_vdEta.size() ? std::min(t_vdVolatilityTimes[i], t) : t;
+			if (end <= begin)
+			{
+				continue;
+			}
+			Value decayEnd = exp(-t_dLambda * (t - end));
+			Value decayBegin = exp(-t_dLambda * (t - begin));
+			Value single = (decayEnd - decayBegin) / t_dLambda;
+			Value squared = (decayEnd * decayEnd - decayBegin * decayBegin) / (2. * t_dLambda);
+			Value variance = t_vdEta[i] * t_vdEta[i];
+			moments.factorVariance += variance * squared;
+			moments.covariance += variance * (single - squared) / t_dLambda;
+			moments.integralVariance += variance * (end - begin - 2. * single + squared) / (t_dLambda * t_dLambda);
+		}
+		return moments;
+	}
+	HullWhiteMoments moments(Time s, Time t) const
+	{
+		return moments(m_dLambda, m_vdVolatilityTimes, m_vdEta, s, t);
+	}
+
+	// variance of int_t^T x(s) ds given x(t)
+	Value V(Time t, Time T) const
+	{
+		return moments(t, T).integralVariance;
+	}
+
+	// P(t, T) = exp(logA(t, T) - B(t, T) x(t))
+	Value logA(Time t, Time T) const
+	{
+		return log(m_ZeroCoupon.discount(T) / m_ZeroCoupon.discount(t)) + 0.5 * (V(t, T) - V(0., T) + V(0., t));
+	}
+
+	// exp(-int_0^t r) = exp(logDeflator(t) - int_0^t x), whose expectation is the initial discount factor
+	Value logDeflator(Time t) const
+	{
+		return log(m_ZeroCoupon.discount(t)) - 0.5 * V(0., t);
+	}
+
+	// r(t) = x(t) + phi(t), phi(t) = f(0, t) + int_0^t eta(u)^2 exp(-lambda (t - u)) B(u, t) du
+	Value phi(Time t) const
+	{
+		return m_ZeroCoupon.instantaneousForward(t) + moments(0., t).covariance;
+	}
+
+	// P(t, T) = exp(logAShortRate(t, T) - B(t, T) r(t)) on the short rate itself, market consistent:
+	// P(0, T) / P(0, t) exp(B f(0, t) - B^2 Var x(t) / 2) for the factor of exp
+	Value logAShortRate(Time t, Time T) const
+	{
+		Value b = B(t, T);
+		return log(m_ZeroCoupon.discount(T) / m_ZeroCoupon.discount(t)) + b * m_ZeroCoupon.instantaneousForward(t)
+			- 0.5 * b * b * moments(0., t).factorVariance;
+	}
+
+	Value zeroCoupon(Time t, Time T, Value t_dShortRate) const
+	{
+		return exp(logAShortRate(t, T) - B(t, T) * t_dShortRate);
+	}
+
+	// P(t, T_j | r_p) for t_iPaths short rates and t_iMaturities maturities, out[j * t_iPaths + p], 0 for
+	// maturities before t: logA and B once per maturity, then one multiply-add and one exp per path
+	void zeroCoupons(Time t, Value const* t_vdShortRates, size_t t_iPaths, Time const* t_vdMaturities, size_t t_iMaturities,
+		Value* out) const
+	{
+		for (size_t j = 0; j < t_iMaturities; j++)
+		{
+			Value* zeroCoupon = out + j * t_iPaths;
+			if (t_vdMaturities[j] < t)
+			{
+				std::fill(zeroCoupon, zeroCoupon + t_iPaths, 0.);
+				continue;
+			}
+			Value logA = logAShortRate(t, t_vdMaturities[j]);
+			Value b = B(t, t_vdMaturities[j]);
+			for (size_t p = 0; p < t_iPaths; p++)
+			{
+				zeroCoupon[p] = logA - b * t_vdShortRates[p];
+			}
+			expBatch(zeroCoupon, zeroCoupon, t_iPaths);
+		}
+	}
+
+private:
+	FrozenYieldCurve m_ZeroCoupon;
+	Value m_dLambda = 0.;
+	std::vector<Time> m_vdVolatilityTimes;
+	std::vector<Value> m_vdEta;
+};
+
+enum RandomNumbers
+{
+	PSEUDO_RANDOM, // Philox streams, one per path
+	QUASI_RANDOM   // Sobol points digitally shifted by the seed, one per path, through Brownian bridges
+};
+
+// Monte Carlo paths of the Hull-White factor on a grid of simulation dates. Every step draws the factor and
+// its time integral jointly from their exact gaussian transition, so the grid can be as coarse as the
+// exposure dates. Paths are stored date by date (all the paths of a date contiguous) and the zero coupons
+// are rebuilt from logA/B tables computed once for the given maturities.
+// The shocks of path p are drawn from its own counter range (Philox stream p or Sobol point p + 1): the paths
+// do not depend on the number of threads nor on how they are batched.
+class HullWhite1FactorEngine
+{
+public:
+	HullWhite1FactorEngine(HullWhite1Factor const& t_model,
+		std::vector<Time> const& t_vdSimulationDates,
+		std::vector<Time> const& t_vdMaturities,
+		size_t t_iPaths,
+		unsigned long long t_iSeed = 42,
+		RandomNumbers t_randomNumbers = PSEUDO_RANDOM)
+		: m_model(t_model),
+		m_vdSimulationDates(t_vdSimulationDates),
+		m_vdMaturities(t_vdMaturities),
+		m_iPaths(t_iPaths),
+		m_randomNumbers(t_randomNumbers),
+		m_generator(t_iSeed),
+		m_sobol(t_randomNumbers == QUASI_RANDOM ? 2 * t_vdSimulationDates.size() : 0, t_iSeed)
+	{
+		if (m_randomNumbers == QUASI_RANDOM)
+		{
+			m_bridge = BrownianBridge(m_vdSimulationDates);
+		}
+
+		size_t dates = m_vdSimulationDates.size();
+		size_t maturities = m_vdMaturities.size();
+		Value lambda = m_model.getLambda();
+
+		m_vdDecay.resize(dates);
+		m_vdIntegralDrift.resize(dates);
+		m_vdFactorStdDev.resize(dates);
+		m_vdIntegralLoading.resize(dates);
+		m_vdIntegralStdDev.resize(dates);
+		m_vdLogDeflator.resize(dates);
+		for (size_t k = 0; k < dates; k++)
+		{
+			Time previous = k == 0 ? 0. : m_vdSimulationDates[k - 1];
+			Time step = m_vdSimulationDates[k] - previous;
+			Value decay = exp(-lambda * step);
+			HullWhiteMoments moments = m_model.moments(previous, m_vdSimulationDates[k]);
+			Value factorVariance = moments.factorVariance;
+			Value integralVariance = moments.integralVariance;
+			Value covariance = moments.covariance;
+
+			// cholesky factor of the joint increment of (x, int x)
+			m_vdDecay[k] = decay;
+			m_vdIntegralDrift[k] = (1. - decay) / lambda;
+			m_vdFactorStdDev[k] = sqrt(factorVariance);
+			m_vdIntegralLoading[k] = factorVariance > 0. ? covariance / m_vdFactorStdDev[k] : 0.;
+			m_vdIntegralStdDev[k] = sqrt(std::max(integralVariance - m_vdIntegralLoading[k] * m_vdIntegralLoading[k], 0.));
+			m_vdLogDeflator[k] = m_model.logDeflator(m_vdSimulationDates[k]);
+		}
+
+		m_vdLogA.assign(dates * maturities, 0.);
+		m_vdB.assign(dates * maturities, 0.);
+		for (size_t k = 0; k < dates; k++)
+		{
+			for (size_t j = 0; j < maturities; j++)
+			{
+				if (m_vdMaturities[j] >= m_vdSimulationDates[k])
+				{
+					m_vdLogA[k * maturities + j] = m_model.logA(m_vdSimulationDates[k], m_vdMaturities[j]);
+					m_vdB[k * maturities + j] = m_model.B(m_vdSimulationDates[k], m_vdMaturities[j]);
+				}
+			}
+		}
+	}
+
+	void simulate(ThreadPool* t_pThreadPool = nullptr)
+	{
+		size_t dates = m_vdSimulationDates.size();
+		m_vdFactor.resize(dates * m_iPaths);
+		m_vdDeflator.resize(dates * m_iPaths);
+
+		if (t_pThreadPool)
+		{
+			t_pThreadPool->parallelFor(m_iPaths, [&](size_t begin, size_t end)
+			{
+				simulate(begin, end);
+			}, 64);
+		}
+		else
+		{
+			simulate(0, m_iPaths);
+		}
+	}
+
+	size_t paths() const
+	{
+		return m_iPaths;
+	}
+	std::vector<Time> const& simulationDates() const
+	{
+		return m_vdSimulationDates;
+	}
+	std::vector<Time> const& maturities() const
+	{
+		return m_vdMaturities;
+	}
+	HullWhite1Factor const& model() const
+	{
+		return m_model;
+	}
+
+	// x on simulation date k, one value per path
+	Value const* factor(size_t t_date) const
+	{
+		return m_vdFactor.data() + t_date * m_iPaths;
+	}
+
+	// exp(-int_0^t r) on simulation date k, one value per path
+	Value const* deflator(size_t t_date) const
+	{
+		return m_vdDeflator.data() + t_date * m_iPaths;
+	}
+
+	// r on simulation date k, x + phi, one value per path
+	void shortRate(size_t t_date, Value* out) const
+	{
+		Value phi = m_model.phi(m_vdSimulationDates[t_date]);
+		Value const* x = factor(t_date);
+		for (size_t p = 0; p < m_iPaths; p++)
+		{
+			out[p] = x[p] + phi;
+		}
+	}
+
+	// P(t_k, T_j) on every path for maturity j, 0 once the maturity is past
+	void zeroCoupon(size_t t_date, size_t t_maturity, Value* out) const
+	{
+		if (m_vdMaturities[t_maturity] < m_vdSimulationDates[t_date])
+		{
+			std::fill(out, out + m_iPaths, 0.);
+			return;
+		}
+
+		size_t index = t_date * m_vdMaturities.size() + t_maturity;
+		Value logA = m_vdLogA[index];
+		Value B = m_vdB[index];
+		Value const* x = factor(t_date);
+		for (size_t p = 0; p < m_iPaths; p++)
+		{
+			out[p] = logA - B * x[p];
+		}
+		expBatch(out, out, m_iPaths);
+	}
+
+	// P(t_k, T_j) for all maturities, out[j * paths() + p]
+	void zeroCoupons(size_t t_date, Value* out) const
+	{
+		for (size_t j = 0; j < m_vdMaturities.size(); j++)
+		{
+			zeroCoupon(t_date, j, out + j * m_iPaths);
+		}
+	}
+
+	// sum_j t_vdWeights[j] P(t_k, T_j) on every path, past maturities and zero weights skipped: the value of
+	// any linear combination of zero coupons (cash flows fixed or fixing in the future on the simulated curve)
+	void zeroCouponCombination(size_t t_date, Value const* t_vdWeights, Value* out, size_t t_begin = 0, size_t t_end = size_t(-1)) const
+	{
+		t_end = std::min(t_end, m_iPaths);
+		size_t maturities = m_vdMaturities.size();
+		Value const* x = factor(t_date);
+		std::fill(out + t_begin, out + t_end, 0.);
+
+		// blocks of paths small enough for the exp arguments to stay in cache over all the maturities
+		constexpr size_t block = 256;
+		Value zeroCoupon[block];
+		for (size_t begin = t_begin; begin < t_end; begin += block)
+		{
+			size_t size = std::min(block, t_end - begin);
+			for (size_t j = 0; j < maturities; j++)
+			{
+				if (t_vdWeights[j] == 0. || m_vdMaturities[j] < m_vdSimulationDates[t_date])
+				{
+					continue;
+				}
+				Value logA = m_vdLogA[t_date * maturities + j];
+				Value B = m_vdB[t_date * maturities + j];
+				for (size_t p = 0; p < size; p++)
+				{
+					zeroCoupon[p] = logA - B * x[begin + p];
+				}
+				expBatch(zeroCoupon, zeroCoupon, size);
+				for (size_t p = 0; p < size; p++)
+				{
+					out[begin + p] += t_vdWeights[j] * zeroCoupon[p];
+				}
+			}
+		}
+	}
+
+private:
+	// paths [t_begin, t_end), by blocks whose shocks (2 per date and path) stay in cache
+	void simulate(size_t t_begin, size_t t_end)
+	{
+		size_t dates = m_vdSimulationDates.size();
+		constexpr size_t block = 64;
+		std::vector<Value> shocks(2 * dates * block);
+		std::vector<Value> bridgeOrder(2 * dates);
+		std::vector<uint32_t> sobolPoint(m_sobol.dimensions());
+		Value factor[block];
+		Value integral[block];
+
+		for (size_t begin = t_begin; begin < t_end; begin += block)
+		{
+			size_t size = std::min(block, t_end - begin);
+
+			// path p: factor shocks z1 at [p * 2 * dates, + dates), integral shocks z2 right after
+			for (size_t p = 0; p < size; p++)
+			{
+				Value* z = shocks.data() + p * 2 * dates;
+				if (m_randomNumbers == QUASI_RANDOM)
+				{
+					if (p == 0)
+					{
+						m_sobol.integers(begin + 1, sobolPoint.data());
+					}
+					else
+					{
+						m_sobol.next(begin + p, sobolPoint.data());
+					}
+					m_sobol.normals(sobolPoint.data(), bridgeOrder.data());
+					m_bridge.transform(bridgeOrder.data(), z);
+					m_bridge.transform(bridgeOrder.data() + dates, z + dates);
+				}
+				else
+				{
+					m_generator.normals(begin + p, 0, z, 2 * dates);
+				}
+			}
+
+			std::fill(factor, factor + size, 0.);
+			std::fill(integral, integral + size, 0.);
+			for (size_t k = 0; k < dates; k++)
+			{
+				Value decay = m_vdDecay[k];
+				Value integralDrift = m_vdIntegralDrift[k];
+				Value factorStdDev = m_vdFactorStdDev[k];
+				Value integralLoading = m_vdIntegralLoading[k];
+				Value integralStdDev = m_vdIntegralStdDev[k];
+				Value logDeflator = m_vdLogDeflator[k];
+				Value* deflator = m_vdDeflator.data() + k * m_iPaths + begin;
+				Value* x = m_vdFactor.data() + k * m_iPaths + begin;
+
+				for (size_t p = 0; p < size; p++)
+				{
+					Value z1 = shocks[p * 2 * dates + k];
+					Value z2 = shocks[p * 2 * dates + dates + k];
+					integral[p] += integralDrift * factor[p] + integralLoading * z1 + integralStdDev * z2;
+					factor[p] = decay * factor[p] + factorStdDev * z1;
+					deflator[p] = logDeflator - integral[p];
+					x[p] = factor[p];
+				}
+				expBatch(deflator, deflator, size);
+			}
+		}
+	}
+
+	HullWhite1Factor m_model;
+	std::vector<Time> m_vdSimulationDates;
+	std::vector<Time> m_vdMaturities;
+	size_t m_iPaths;
+	RandomNumbers m_randomNumbers;
+	Philox m_generator;
+	Sobol m_sobol;
+	BrownianBridge m_bridge;
+
+	// exact transition of (x, int x) from the previous simulation date
+	std::vector<Value> m_vdDecay;
+	std::vector<Value> m_vdIntegralDrift;
+	std::vector<Value> m_vdFactorStdDev;
+	std::vector<Value> m_vdIntegralLoading;
+	std::vector<Value> m_vdIntegralStdDev;
+	std::vector<Value> m_vdLogDeflator;
+
+	// zero coupon tables, [date * maturities + maturity]
+	std::vector<Value> m_vdLogA;
+	std::vector<Value> m_vdB;
+
+	std::vector<Value> m_vdFactor;
+	std::vector<Value> m_vdDeflator;
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "Pricers.h"
+#include "Diffusion/HullWhite1Factor.h"
+
+using Time = double;
+using Value = double;
+
+// flat hazard rate and recovery of a counterparty (or of ourselves for the DVA)
+struct CreditParameters
+{
+	Value hazardRate = 0.;
+	Value recovery = 0.4;
+
+	Value survival(Time t) const
+	{
+		return exp(-hazardRate * t);
+	}
+};
+
+// exposure statistics of a netting set on one date of the exposure grid, over all the paths
+struct ExposureDate
+{
+	size_t index = 0;
+	Time date = 0.;
+	Value expectedExposure = 0.;                   // E[max(V, 0)]
+	Value expectedNegativeExposure = 0.;           // E[min(V, 0)]
+	Value potentialFutureExposure = 0.;            // quantile of max(V, 0)
+	Value discountedExpectedExposure = 0.;         // E[D(t) max(V, 0)], D the deflator exp(-int r)
+	Value discountedExpectedNegativeExposure = 0.; // E[D(t) min(V, 0)]
+};
+
+struct ExposureProfile
+{
+	std::vector<ExposureDate> dates;
+	Value expectedPositiveExposure = 0.; // time average of the expected exposure over the grid
+	Value cva = 0.;
+	Value dva = 0.;
+};
+
+// Exposures of a book netted as one netting set on the curves simulated by a Hull-White engine, the exposure
+// grid being the simulation dates of the engine and its maturities the date grid of the book
+// (HullWhite1FactorEngine(model, exposureDates, portfolio.dates(), paths)).
+//
+// On one curve a swap is a fixed combination of zero coupons, every period contributing
+// P(t, Ts) - (1 + delta K) P(t, Te), so that the netting set on date t only takes the weights of the grid
+// dates, with the aging rule of price(Swap, t) (paid periods dropped, the period running over t keeping its
+// fixed leg only), then one zero coupon combination per path. The paths x dates x trades cube is never built:
+// a date is priced, reduced to its statistics, handed to t_onDate if given, and dropped.
+// Unilateral CVA and DVA are integrated on the exposure grid against the default probabilities.
+ExposureProfile computeExposures(
+	SwapPortfolio const& portfolio,
+	HullWhite1FactorEngine const& engine,
+	CreditParameters const& t_counterparty,
+	CreditParameters const& t_own,
+	Value t_dQuantile = 0.95,
+	std::function<void(ExposureDate const&)> t_onDate = nullptr,
+	ThreadPool* t_pThreadPool = nullptr)
+{
+	std::vector<Time> const& exposureDates = engine.simulationDates();
+	std::vector<Time> const& dates = portfolio.dates();
+	std::vector<size_t> const& offsets = portfolio.periodOffsets();
+	std::vector<unsigned int> const& startDate = portfolio.periodStartDate();
+	std::vector<unsigned int> const& endDate = portfolio.periodEndDate();
+	std::vector<Time> const& accrual = portfolio.periodAccrual();
+	std::vector<Value> const& strike = portfolio.periodStrike();
+	size_t paths = engine.paths();
+
+	std::vector<Value> weights(dates.size());
+	std::vector<Value> values(paths);
+	std::vector<Value> positiveExposures(paths);
+
+	ExposureProfile profile;
+	for (size_t k = 0; k < exposureDates.size(); k++)
+	{
+		Time t = exposureDates[k];
+		unsigned int firstDate = (unsigned int)(std::lower_bound(dates.begin(), dates.end(), t) - dates.begin());
+
+		std::fill(weights.begin(), weights.end(), 0.);
+		for (size_t s = 0; s < portfolio.size(); s++)
+		{
+			Value notional = portfolio.swapTypes()[s] == PAYER
+				? (Value)portfolio.notionals()[s]
+				: -(Value)portfolio.notionals()[s];
+			for (size_t i = offsets[s]; i < offsets[s + 1]; i++)
+			{
+				if (endDate[i] < firstDate)
+				{
+					continue;
+				}
+				if (startDate[i] >= firstDate)
+				{
+					weights[startDate[i]] += notional;
+					weights[endDate[i]] -= notional;
+				}
+				weights[endDate[i]] -= notional * accrual[i] * strike[i];
+			}
+		}
+
+		if (t_pThreadPool)
+		{
+			t_pThreadPool->parallelFor(paths, [&](size_t begin, size_t end)
+			{
+				engine.zeroCouponCombination(k, weights.data(), values.data(), begin, end);
+			}, 256);
+		}
+		else
+		{
+			engine.zeroCouponCombination(k, weights.data(), values.data());
+		}
+
+		ExposureDate exposure;
+		exposure.index = k;
+		exposure.date = t;
+		Value const* deflator = engine.deflator(k);
+		for (size_t p = 0; p < paths; p++)
+		{
+			Value positive = std::max(values[p], 0.);
+			Value negative = std::min(values[p], 0.);
+			exposure.expectedExposure += positive;
+			exposure.expectedNegativeExposure += negative;
+			exposure.discountedExpectedExposure += deflator[p] * positive;
+			exposure.discountedExpectedNegativeExposure += deflator[p] * negative;
+			positiveExposures[p] = positive;
+		}
+		exposure.expectedExposure /= paths;
+		exposure.expectedNegativeExposure /= paths;
+		exposure.discountedExpectedExposure /= paths;
+		exposure.discountedExpectedNegativeExposure /= paths;
+
+		size_t quantile = std::min((size_t)(t_dQuantile * paths), paths - 1);
+		std::nth_element(positiveExposures.begin(), positiveExposures.begin() + quantile, positiveExposures.end());
+		exposure.potentialFutureExposure = positiveExposures[quantile];
+
+		Time previous = k == 0 ? 0. : exposureDates[k - 1];
+		profile.cva += (1. - t_counterparty.recovery) * exposure.discountedExpectedExposure
+			* (t_counterparty.survival(previous) - t_counterparty.survival(t));
+		profile.dva -= (1. - t_own.recovery) * exposure.discountedExpectedNegativeExposure
+			* (t_own.survival(previous) - t_own.survival(t));
+		profile.expectedPositiveExposure += exposure.expectedExposure * (t - previous);
+
+		if (t_onDate)
+		{
+			t_onDate(exposure);
+		}
+		profile.dates.push_back(exposure);
+	}
+	if (!exposureDates.empty() && exposureDates.back() > 0.)
+	{
+		profile.expectedPositiveExposure /= exposureDates.back();
+	}
+
+	return profile;
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <chrono>
+
+#include "Pricers.h"
+#include "QuoteLoader.h"
+#include "Snapshot.h"
+
+using Time = double;
+using Value = double;
+
+// One curve of the history: stripped on every date from its quotes (CurveQuotes::curve == name) and from the
+// curves of the same date added before it, e.g. a EUR3M curve discounted on the OIS curve of its date.
+struct HistoricalCurve
+{
+	std::string name;
+	// the Stripper of one date from its quotes, the first guess of the pillars and the curves of the date
+	// already stripped, in the order they were added
+	std::function<Stripper<Swap>(CurveQuotes const&, std::vector<Value> const&, std::vector<YieldCurve> const&)> stripper;
+	CalibrationMethod calibrationMethod = SEQUENTIAL_BOOTSTRAP;
+	Value initialRate = 0.01; // flat first guess of the first date of a chunk
+};
+
+struct HistoricalStatistics
+{
+	size_t dates = 0;
+	size_t curves = 0;       // calibrated
+	size_t missingCurves = 0; // not calibrated, the date having no quotes for them or for a curve before them
+	Value largestResidual = 0.;
+	double seconds = 0.;
+
+	double curvesPerSecond() const
+	{
+		return seconds > 0. ? curves / seconds : 0.;
+	}
+};
+
+// Batch calibration of the curves of many dates, e.g. the nightly backfill of the history. The dates are cut
+// into chunks of consecutive dates calibrated concurrently on the thread pool; within a chunk every date starts
+// from the curves of the date before it, which are only a day's move away, and the first date of a chunk from
+// the flat initial rates. The chunks do not depend on the number of threads, nor do the curves.
+class HistoricalCalibrator
+{
+public:
+
+	HistoricalCalibrator() {}
+
+	// Adds curve number size(), stripped on every date after the curves added before it.
+	size_t addCurve(HistoricalCurve t_curve)
+	{
+		m_vCurves.push_back(t_curve);
+		return m_vCurves.size() - 1;
+	}
+
+	size_t size() const
+	{
+		return m_vCurves.size();
+	}
+
+	void setThreadPool(ThreadPool& t_threadPool)
+	{
+		m_pThreadPool = &t_threadPool;
+	}
+
+	// dates calibrated in a row by one thread: longer chunks start from the flat guess less often, shorter
+	// ones balance better between the threads
+	void setChunkSize(size_t t_iDates)
+	{
+		m_iChunkSize = std::max(t_iDates, size_t(1));
+	}
+
+	// The curves of every date, date by date in the order of t_vDates and, within a date, in the order they
+	// were added. A date missing the quotes of a curve has neither that curve nor the ones added after it.
+	std::vector<CurveSnapshot> calibrate(std::vector<QuoteDate> const& t_vDates, HistoricalStatistics* t_pStatistics = nullptr) const
+	{
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+		size_t dates = t_vDates.size();
+		std::vector<CurveSnapshot> results(dates * m_vCurves.size());
+		std::vector<char> calibrated(results.size(), 0);
+		size_t chunks = (dates + m_iChunkSize - 1) / m_iChunkSize;
+		auto calibrateChunks = [&](size_t t_iBegin, size_t t_iEnd)
+		{
+			for (size_t chunk = t_iBegin; chunk < t_iEnd; chunk++)
+			{
+				calibrateChunk(t_vDates, chunk * m_iChunkSize, std::min((chunk + 1) * m_iChunkSize, dates), results, calibrated);
+			}
+		};
+		if (m_pThreadPool)
+		{
+			m_pThreadPool->parallelFor(chunks, calibrateChunks);
+		}
+		else
+		{
+			calibrateChunks(0, chunks);
+		}
+
+		HistoricalStatistics statistics;
+		statistics.dates = dates;
+		std::vector<CurveSnapshot> curves;
+		curves.reserve(results.size());
+		for (size_t r = 0; r < results.size(); r++)
+		{
+			if (!calibrated[r])
+			{
+				statistics.missingCurves++;
+				continue;
+			}
+			statistics.largestResidual = std::max(statistics.largestResidual, results[r].largestResidual);
+			curves.push_back(std::move(results[r]));
+		}
+		statistics.curves = curves.size();
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		statistics.seconds = std::chrono::duration<double>(end - begin).count();
+
+		if (t_pStatistics)
+		{
+			*t_pStatistics = statistics;
+		}
+		return curves;
+	}
+
+private:
+
+	// the dates [t_iBegin, t_iEnd) in a row, each one warm-started from the one before
+	void calibrateChunk(std::vector<QuoteDate> const& t_vDates, size_t t_iBegin, size_t t_iEnd,
+		std::vector<CurveSnapshot>& t_vResults, std::vector<char>& t_vCalibrated) const
+	{
+		std::vector<YieldCurve> previous(m_vCurves.size());
+		std::vector<char> hasPrevious(m_vCurves.size(), 0);
+		std::vector<YieldCurve> curves;
+
+		for (size_t d = t_iBegin; d < t_iEnd; d++)
+		{
+			QuoteDate const& quoteDate = t_vDates[d];
+			curves.clear();
+			for (size_t c = 0; c < m_vCurves.size(); c++)
+			{
+				HistoricalCurve const& definition = m_vCurves[c];
+				CurveQuotes const* quotes = quoteDate.find(definition.name);
+				if (!quotes)
+				{
+					break;
+				}
+
+				// the curve of the day before when it has the same pillars
+				std::vector<Value> initialRates(quotes->maturities.size(), definition.initialRate);
+				if (hasPrevious[c] && previous[c].maturities() == quotes->maturities)
+				{
+					initialRates = previous[c].interestRates();
+				}
+
+				Stripper<Swap> stripper = definition.stripper(*quotes, initialRates, curves);
+				stripper.calibrate(definition.calibrationMethod);
+
+				CurveSnapshot& result = t_vResults[d * m_vCurves.size() + c];
+				result.name = definition.name;
+				result.date = quoteDate.date;
+				result.curve = stripper.getZeroCoupon();
+				result.calibrationMethod = definition.calibrationMethod;
+				result.quoteMaturities = quotes->maturities;
+				result.quotes = quotes->quotes;
+				for (Value residual : stripper.evaluateInstruments())
+				{
+					result.largestResidual = std::max(result.largestResidual, std::abs(residual));
+				}
+				t_vCalibrated[d * m_vCurves.size() + c] = 1;
+
+				previous[c] = result.curve;
+				hasPrevious[c] = 1;
+				curves.push_back(result.curve);
+			}
+		}
+	}
+
+	std::vector<HistoricalCurve> m_vCurves;
+	size_t m_iChunkSize = 64;
+	ThreadPool* m_pThreadPool = nullptr;
+};
@@ -1,59 +1,332 @@
 #pragma once
 
-#include "../MathTools.h"
+// Instruments priced in closed form in the Hull-White one factor model. Zero coupons on the short rate come
+// from HullWhite1Factor::zeroCoupon(s), on the initial discount factors and forwards: theta is never integrated.
+#include "../Diffusion/HullWhite1Factor.h"
 
-template <typename T>
-void hw1fCalibration(
-	std::function<T(T)> zcPrice,
-	T hw1fLambda,
-	T hw1fEta)
+using Time = double;
+using Value = double;
+
+constexpr Value inverseSqrt2 = 0.70710678118654752440;   // 1 / sqrt(2)
+constexpr Value inverseSqrt2Pi = 0.39894228040143267794; // 1 / sqrt(2 pi), the standard normal density at 0
+
+inline Value normalCdf(Value x)
+{
+	return 0.5 * std::erfc(-x * inverseSqrt2);
+}
+
+// European swaption into a Swap starting on its expiry, the right to enter it (a PAYER swap pays the strike),
+// cached on the discount curve for repeated pricing: its fixed leg is the coupon bond sum c_i P(T_i), c_i the
+// accrual times the strike (plus the notional on the last date), and its floating leg P(T_0) - P(T_n) on the
+// same curve, the forwarding curve of the swap not being read.
+struct HullWhiteSwaption
+{
+	SwapType swapType = PAYER;
+	Value notional = 1.;
+	Value strike = 0.;
+	Time expiry = 0.;
+	Value expiryDiscount = 1.;      // P(0, T_0)
+	std::vector<Time> tenors;       // T_i - T_0
+	std::vector<Value> coupons;     // c_i
+	std::vector<Value> discounts;   // P(0, T_i)
+	Value annuity = 0.;             // sum delta_i P(0, T_i)
+	Value forwardSwapRate = 0.;
+};
+
+inline HullWhiteSwaption makeSwaption(Swap const& t_underlying, FrozenYieldCurve const& t_discountCurve)
+{
+	std::vector<Time> const& paymentDates = t_underlying.getPaymentDates();
+	std::vector<Time> const& accruals = t_underlying.getAccruals();
+
+	HullWhiteSwaption swaption;
+	swaption.swapType = t_underlying.getSwapType();
+	swaption.notional = (Value)t_underlying.getNotional();
+	swaption.strike = t_underlying.getStrike();
+	swaption.expiry = paymentDates.front();
+	swaption.expiryDiscount = t_discountCurve.discount(swaption.expiry);
+	for (size_t i = 1; i < paymentDates.size(); i++)
+	{
+		Value discount = t_discountCurve.discount(paymentDates[i]);
+		swaption.tenors.push_back(paymentDates[i] - swaption.expiry);
+		swaption.coupons.push_back(accruals[i - 1] * t_underlying.getStrike());
+		swaption.discounts.push_back(discount);
+		swaption.annuity += accruals[i - 1] * discount;
+	}
+	swaption.coupons.back() += 1.;
+	swaption.forwardSwapRate = (swaption.expiryDiscount - swaption.discounts.back()) / swaption.annuity;
+	return swaption;
+}
+
+// price with a normal volatility of the swap rate (Bachelier), the way swaptions are quoted
+inline Value bachelierPrice(HullWhiteSwaption const& t_swaption, Value t_dNormalVolatility)
+{
+	Value moneyness = t_swaption.forwardSwapRate - t_swaption.strike;
+	moneyness = t_swaption.swapType == PAYER ? moneyness : -moneyness;
+	Value deviation = t_dNormalVolatility * sqrt(t_swaption.expiry);
+	if (deviation <= 0.)
+	{
+		return t_swaption.notional * t_swaption.annuity * std::max(moneyness, 0.);
+	}
+	Value d = moneyness / deviation;
+	return t_swaption.notional * t_swaption.annuity
+		* (moneyness * normalCdf(d) + deviation * exp(-0.5 * d * d) * inverseSqrt2Pi);
+}
+
+// d bachelierPrice / d normal volatility
+inline Value bachelierVega(HullWhiteSwaption const& t_swaption, Value t_dNormalVolatility)
 {
-	T h = 1E-6;
-	auto forwardRate = [](T const& time)
+	Value deviation = t_dNormalVolatility * sqrt(t_swaption.expiry);
+	Value d = (t_swaption.forwardSwapRate - t_swaption.strike) / deviation;
+	return t_swaption.notional * t_swaption.annuity * sqrt(t_swaption.expiry) * exp(-0.5 * d * d) * inverseSqrt2Pi;
+}
+
+// normal volatility of a Bachelier price by Newton's method, -1 when the price is below the intrinsic value
+inline Value impliedNormalVolatility(HullWhiteSwaption const& t_swaption, Value t_dPrice)
+{
+	if (t_dPrice < bachelierPrice(t_swaption, 0.))
+	{
+		return -1.;
+	}
+	Value volatility = t_dPrice / (t_swaption.notional * t_swaption.annuity * sqrt(t_swaption.expiry) * inverseSqrt2Pi);
+	for (int i = 0; i < 50; i++)
+	{
+		Value step = (bachelierPrice(t_swaption, volatility) - t_dPrice) / bachelierVega(t_swaption, volatility);
+		volatility = std::max(volatility - step, 0.5 * volatility);
+		if (std::abs(step) < 1E-15)
+		{
+			break;
+		}
+	}
+	return volatility;
+}
+
+// Jamshidian: exercised when the coupon bond is below par, the swaption is a portfolio of options on the zero
+// coupons struck at their price on the factor x* where the bond is at par. With x = r - f(0, T_0) the zero
+// coupons are P(T_0, T_i) = P(0, T_i) / P(0, T_0) exp(-B_i x - B_i^2 y / 2), y = Var x(T_0), and the options
+// share one threshold: the price only takes lambda and y, a root search and n + 1 normal distributions.
+inline Value jamshidianPrice(HullWhiteSwaption const& t_swaption, Value t_dLambda, Value t_dFactorVariance)
+{
+	size_t n = t_swaption.tenors.size();
+	Value bondValue = 0.;
+	for (size_t i = 0; i < n; i++)
+	{
+		bondValue += t_swaption.coupons[i] * t_swaption.discounts[i];
+	}
+	if (t_dFactorVariance <= 0.)
+	{
+		Value payer = t_swaption.expiryDiscount - bondValue;
+		return t_swaption.notional * std::max(t_swaption.swapType == PAYER ? payer : -payer, 0.);
+	}
+
+	// c_i P(T_0, T_i) at x = 0 and B_i: the coupon bond is decreasing in x (the coupons may be negative, with
+	// the strike, but the bond is dominated by the last one)
+	Value const* coupons = t_swaption.coupons.data();
+	Value weights[256];
+	Value loadings[256];
+	std::vector<Value> buffer;
+	Value* weight = weights;
+	Value* loading = loadings;
+	if (n > 256)
+	{
+		buffer.resize(2 * n);
+		weight = buffer.data();
+		loading = weight + n;
+	}
+	for (size_t i = 0; i < n; i++)
+	{
+		loading[i] = (1. - exp(-t_dLambda * t_swaption.tenors[i])) / t_dLambda;
+		weight[i] = coupons[i] * t_swaption.discounts[i] / t_swaption.expiryDiscount * exp(-0.5 * loading[i] * loading[i] * t_dFactorVariance);
+	}
+
+	Value threshold = 0.;
+	for (int iteration = 0; iteration < 100; iteration++)
+	{
+		Value bond = -1.;
+		Value slope = 0.;
+		for (size_t i = 0; i < n; i++)
+		{
+			Value term = weight[i] * exp(-loading[i] * threshold);
+			bond += term;
+			slope -= loading[i] * term;
+		}
+		Value step = bond / slope;
+		threshold -= step;
+		if (std::abs(step) < 1E-14)
+		{
+			break;
+		}
+	}
+
+	Value deviation = sqrt(t_dFactorVariance);
+	Value d = -threshold / deviation;
+	Value price = 0.;
+	if (t_swaption.swapType == PAYER)
 	{
-		return -log(zcPrice(time + h) / zcPrice(time - h)) / (2. * h); 
-	};
+		price = t_swaption.expiryDiscount * normalCdf(d);
+		for (size_t i = 0; i < n; i++)
+		{
+			price -= coupons[i] * t_swaption.discounts[i] * normalCdf(d - loading[i] * deviation);
+		}
+	}
+	else
+	{
+		price = -t_swaption.expiryDiscount * normalCdf(-d);
+		for (size_t i = 0; i < n; i++)
+		{
+			price += coupons[i] * t_swaption.discounts[i] * normalCdf(loading[i] * deviation - d);
+		}
+	}
+	return t_swaption.notional * price;
+}
 
-	T initialRate = forwardRate(h);
+inline Value jamshidianPrice(HullWhiteSwaption const& t_swaption, HullWhite1Factor const& t_model)
+{
+	return jamshidianPrice(t_swaption, t_model.getLambda(), t_model.moments(0., t_swaption.expiry).factorVariance);
+}
+
+// Calibration of the mean reversion and of a piecewise constant volatility to swaptions quoted in normal
+// volatility, e.g. a co-terminal strip (and other strips of the cube for the mean reversion): the volatility
+// changes on the expiries of the swaptions and the parameters are fitted by Levenberg-Marquardt on their
+// logarithms, every residual being the price error over the vega (the normal volatility error to first
+// order). The swaptions are priced by Jamshidian on their cached discount factors, the curve is never read
+// while solving. With no more swaptions than expiries the mean reversion is kept, the volatilities then
+// fitting the swaptions exactly.
+class HullWhiteCalibrator
+{
+public:
+
+	HullWhiteCalibrator(YieldCurve const& t_discountCurve, Value t_dMeanReversion = 0.03)
+		: m_discountCurve(t_discountCurve),
+		m_frozenCurve(t_discountCurve),
+		m_dLambda(t_dMeanReversion)
+	{}
 
-	auto hw1fTheta = [](T const& time)
+	// Adds swaption number size(), the right to enter t_underlying on its start date, quoted at t_dNormalVolatility.
+	size_t addSwaption(Swap const& t_underlying, Value t_dNormalVolatility)
 	{
-		T temp = forwardRate(time) + (forwardRate(time + h) / forwardRate(time - h)) / (2. * h * hw1fLambda);
-		temp += hw1fEta * hw1fEta * (1. - exp(-2. * hw1fLambda * time)) / (2. * hw1fLambda * hw1fLambda);
-		return temp;
-	};
+		m_vSwaptions.push_back(makeSwaption(t_underlying, m_frozenCurve));
+		m_vdQuotes.push_back(t_dNormalVolatility);
+		m_vdPrices.push_back(bachelierPrice(m_vSwaptions.back(), t_dNormalVolatility));
+		m_vdVegas.push_back(bachelierVega(m_vSwaptions.back(), t_dNormalVolatility));
+		return m_vSwaptions.size() - 1;
+	}
 
-	auto hw1fB = [](T const& time_t, T const& time_T)
+	size_t size() const
 	{
-		return (exp(-hw1fLambda * (time_T - time_t)) - 1) / hw1fLambda;
-	};
+		return m_vSwaptions.size();
+	}
 
-	auto hw1fA = [](T const& time_t, T const& time_T)
+	// mean reversion fixed to t_dMeanReversion or, by default, the first guess of its calibration
+	void setMeanReversion(Value t_dMeanReversion, bool t_bCalibrate = true)
 	{
-		T temp1 = (time_T - time_t) + (exp(2 * hw1fLambda * (time_T - time_t)) * (4 * exp(hw1fLambda * (time_T - time_t)) - 1) - 3) / (2 * hw1fLambda);
-		temp1 *= hw1fEta * hw1fEta;
-		temp1 /= 2 * hw1fLambda * hw1fLambda;
+		m_dLambda = t_dMeanReversion;
+		m_bCalibrateMeanReversion = t_bCalibrate;
+	}
 
-		std::vector<T> time_grid = linspace<T>(time_t, time_T, (size_t)((time_t / time_T + 1) * time_T * 250));
+	// Returns the number of jacobians computed.
+	int calibrate(double t_dTolerance = 1E-16, int t_iMaxIterations = 100)
+	{
+		m_vdVolatilityTimes.clear();
+		for (HullWhiteSwaption const& swaption : m_vSwaptions)
+		{
+			m_vdVolatilityTimes.push_back(swaption.expiry);
+		}
+		std::sort(m_vdVolatilityTimes.begin(), m_vdVolatilityTimes.end());
+		m_vdVolatilityTimes.erase(std::unique(m_vdVolatilityTimes.begin(), m_vdVolatilityTimes.end()), m_vdVolatilityTimes.end());
 
-		std::vector<T> integralValues;
+		// first guess: the short rate as volatile as the swap rates
+		size_t pieces = m_vdVolatilityTimes.size();
+		bool calibrateMeanReversion = m_bCalibrateMeanReversion && m_vSwaptions.size() > pieces;
+		Value averageQuote = std::accumulate(m_vdQuotes.begin(), m_vdQuotes.end(), 0.) / m_vdQuotes.size();
+		std::vector<Value> parameters(pieces, log(averageQuote));
+		if (calibrateMeanReversion)
+		{
+			parameters.push_back(log(m_dLambda));
+		}
 
-		std::transform(
-			time_grid.begin(), time_grid.end(),
-			std::back_inserter(integralValues),
-			[](T const& grid_time)
+		NewtonState<Value> state;
+		state.verbose = false;
+		int jacobians = multivariateNewtonRaphson<Value>(parameters,
+			[&](std::vector<Value> t_vdParameters)
 			{
-				return hw1fTheta(grid_time) * hw1fB(grid_time, time_T);
-			});
+				return residuals(t_vdParameters, calibrateMeanReversion);
+			},
+			t_dTolerance, t_iMaxIterations, nullptr, LEVENBERG_MARQUARDT, &state);
 
-		T temp2;
-		temp2 = std::accumulate(integralValues.begin(), integralValues.end(), 0.);
-		temp2 *= hw1fLambda;
-	};
+		m_vdEta.resize(pieces);
+		for (size_t i = 0; i < pieces; i++)
+		{
+			m_vdEta[i] = exp(parameters[i]);
+		}
+		if (calibrateMeanReversion)
+		{
+			m_dLambda = exp(parameters[pieces]);
+		}
+		return jacobians;
+	}
 
-	auto hw1fZeroCoupon = [](T const& time_t, T const& time_T,std T const& shortRate)
+	Value getMeanReversion() const
+	{
+		return m_dLambda;
+	}
+	// the volatility pieces end on these expiries, the last one also running after it
+	std::vector<Time> const& getVolatilityTimes() const
+	{
+		return m_vdVolatilityTimes;
+	}
+	std::vector<Value> const& getVolatilities() const
 	{
-		return exp(hw1fA(time_t, time_T) + hw1fB(time_t, time_T) * shortRate);
+		return m_vdEta;
 	}
 
-}
+	HullWhite1Factor getModel() const
+	{
+		return HullWhite1Factor(m_discountCurve, m_dLambda, m_vdVolatilityTimes, m_vdEta);
+	}
+
+	// model minus quoted normal volatility of every swaption
+	std::vector<Value> evaluateInstruments() const
+	{
+		std::vector<Value> errors(m_vSwaptions.size());
+		for (size_t s = 0; s < m_vSwaptions.size(); s++)
+		{
+			Value factorVariance = HullWhite1Factor::moments(m_dLambda, m_vdVolatilityTimes, m_vdEta, 0., m_vSwaptions[s].expiry).factorVariance;
+			errors[s] = impliedNormalVolatility(m_vSwaptions[s], jamshidianPrice(m_vSwaptions[s], m_dLambda, factorVariance)) - m_vdQuotes[s];
+		}
+		return errors;
+	}
+
+private:
+
+	// price errors over vegas, the factor variance of an expiry summed piece by piece up to it
+	std::vector<Value> residuals(std::vector<Value> const& t_vdParameters, bool t_bCalibrateMeanReversion) const
+	{
+		size_t pieces = m_vdVolatilityTimes.size();
+		Value lambda = t_bCalibrateMeanReversion ? exp(t_vdParameters[pieces]) : m_dLambda;
+		std::vector<Value> eta(pieces);
+		for (size_t i = 0; i < pieces; i++)
+		{
+			eta[i] = exp(t_vdParameters[i]);
+		}
+
+		std::vector<Value> errors(m_vSwaptions.size());
+		for (size_t s = 0; s < m_vSwaptions.size(); s++)
+		{
+			Value factorVariance = HullWhite1Factor::moments(lambda, m_vdVolatilityTimes, eta, 0., m_vSwaptions[s].expiry).factorVariance;
+			errors[s] = (jamshidianPrice(m_vSwaptions[s], lambda, factorVariance) - m_vdPrices[s]) / m_vdVegas[s];
+		}
+		return errors;
+	}
+
+	YieldCurve m_discountCurve;
+	FrozenYieldCurve m_frozenCurve;
+	std::vector<HullWhiteSwaption> m_vSwaptions;
+	std::vector<Value> m_vdQuotes;
+	std::vector<Value> m_vdPrices;
+	std::vector<Value> m_vdVegas;
+
+	Value m_dLambda;
+	bool m_bCalibrateMeanReversion = true;
+	std::vector<Time> m_vdVolatilityTimes;
+	std::vector<Value> m_vdEta;
+};
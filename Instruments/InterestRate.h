@@ -1,5 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
+
+#include "../InterpolationKernels.h"
+#include "../Schedule.h"
+
 using Time = double;
 using Value = double;
 
@@ -9,22 +15,36 @@ enum SwapType
 	RECEIVER = 1
 };
 
-class YieldCurve
+template <typename T>
+class BasicYieldCurve
 {
 public:
-	YieldCurve() {}
-	YieldCurve(
+	using value_type = T;
+
+	BasicYieldCurve() {}
+	BasicYieldCurve(
 		std::vector<Time> t_vdMaturities,
-		std::vector<Value> t_vdInterestRates,
+		std::vector<T> t_vdInterestRates,
 		InterpolationType t_interpolationMethod = InterpolationType::LINEAR_ON_Y)
 		: m_vdMaturities(t_vdMaturities),
 		m_vdInterestRates(t_vdInterestRates),
 		m_interpolationMethod(t_interpolationMethod)
 	{}
 
+	// a calibrated curve enters an active computation as a constant
+	template <typename U, typename = std::enable_if_t<!std::is_same_v<U, T> && std::is_constructible_v<T, U const&>>>
+	BasicYieldCurve(BasicYieldCurve<U> const& t_curve)
+		: m_vdMaturities(t_curve.getMaturities()),
+		m_interpolationMethod(t_curve.getInterpolationMethod()),
+		m_iStripTag(t_curve.stripTag())
+	{
+		std::vector<U> const& interestRates = t_curve.interestRates();
+		m_vdInterestRates.assign(interestRates.begin(), interestRates.end());
+	}
+
 	auto operator() (
 		std::vector<Time> t_vdMaturities,
-		std::vector<Value> t_vdInterestRates,
+		std::vector<T> t_vdInterestRates,
 		InterpolationType t_interpolationMethod = InterpolationType::LINEAR_ON_Y)
 	{
 		m_vdMaturities = t_vdMaturities;
@@ -32,36 +52,252 @@ public:
 		m_interpolationMethod = t_interpolationMethod;
 	}
 
-	std::vector<Time> getMaturities()
+	std::vector<Time> getMaturities() const
 	{
 		return m_vdMaturities;
 	}
-	std::vector<Value> getInterestRates()
+	std::vector<T> getInterestRates() const
 	{
 		return m_vdInterestRates;
 	}
-	InterpolationType getInterpolationMethod()
+	InterpolationType getInterpolationMethod() const
 	{
 		return m_interpolationMethod;
 	}
+
+	// non-copying accessors for the pricing loops
+	std::vector<Time> const& maturities() const
+	{
+		return m_vdMaturities;
+	}
+	std::vector<T> const& interestRates() const
+	{
+		return m_vdInterestRates;
+	}
+
+	// Identity of the curve a Stripper solves for (see newStripTag), kept by its copies and so by the legs of
+	// the instruments built on it, while a curve merely equal to it has another one. 0 on any other curve,
+	// and not part of the comparison of two curves.
+	size_t stripTag() const
+	{
+		return m_iStripTag;
+	}
+	void setStripTag(size_t t_iStripTag)
+	{
+		m_iStripTag = t_iStripTag;
+	}
+
+	friend bool operator==(BasicYieldCurve const& t_x, BasicYieldCurve const& t_y)
+	{
+		return t_x.m_interpolationMethod == t_y.m_interpolationMethod
+			&& t_x.m_vdMaturities == t_y.m_vdMaturities
+			&& t_x.m_vdInterestRates == t_y.m_vdInterestRates;
+	}
 private:
 	std::vector<Time> m_vdMaturities;
-	std::vector<Value> m_vdInterestRates;
+	std::vector<T> m_vdInterestRates;
 	InterpolationType m_interpolationMethod;
+	size_t m_iStripTag = 0;
+};
+
+// a strip tag no curve has been given yet
+inline size_t newStripTag()
+{
+	static std::atomic<size_t> lastTag{ 0 };
+	return ++lastTag;
+}
+
+using YieldCurve = BasicYieldCurve<Value>;
+
+// Read-only copy of a calibrated curve, compiled once for repeated discounting.
+// Every interpolation mode is a straight line on some transform of the rates (the node values), so the
+// curve is stored as one (start time, node value, slope) triple per segment, segment 0 and segment N being
+// the flat extrapolations. A uniform bucket grid, as fine as the smallest pillar spacing up to 8 buckets per
+// pillar, maps a time to its segment in constant time.
+class FrozenYieldCurve
+{
+public:
+	FrozenYieldCurve() {}
+	FrozenYieldCurve(YieldCurve const& t_curve)
+	{
+		compile(t_curve);
+	}
+
+	// recompiles in place, reusing the storage of the previous curve (no allocation for a curve of no more pillars);
+	// a curve without pillars leaves it empty
+	void compile(YieldCurve const& t_curve)
+	{
+		compile(t_curve.maturities(), t_curve.interestRates(), t_curve.getInterpolationMethod());
+	}
+
+	// same from the pillars of a curve, e.g. the rates of a calibration iterate without building its curve
+	void compile(std::vector<Time> const& t_vdMaturities, std::vector<Value> const& t_vdInterestRates,
+		InterpolationType t_interpolationMethod)
+	{
+		m_interpolationMethod = t_interpolationMethod;
+		m_vdMaturities.assign(t_vdMaturities.begin(), t_vdMaturities.end());
+		m_vdInterestRates.assign(t_vdInterestRates.begin(), t_vdInterestRates.end());
+
+		size_t pillars = m_vdMaturities.size();
+		if (pillars == 0 || t_vdInterestRates.size() != pillars)
+		{
+			// left empty, as default constructed: nothing to discount on
+			m_vdMaturities.clear();
+			m_vdInterestRates.clear();
+			m_vdSegmentStart.clear();
+			m_vdSegmentValue.clear();
+			m_vdSegmentSlope.clear();
+			m_viBucketSegment.clear();
+			return;
+		}
+
+		// segment k > 0 starts on pillar k - 1, with that pillar's node value
+		m_vdSegmentStart.resize(pillars + 1);
+		m_vdSegmentValue.resize(pillars + 1);
+		m_vdSegmentSlope.assign(pillars + 1, 0.);
+
+		m_vdSegmentStart[0] = m_vdMaturities.front();
+		m_vdSegmentValue[0] = nodeValue(m_vdMaturities.front(), t_vdInterestRates.front());
+		for (size_t i = 0; i < pillars; i++)
+		{
+			m_vdSegmentStart[i + 1] = m_vdMaturities[i];
+			m_vdSegmentValue[i + 1] = nodeValue(m_vdMaturities[i], t_vdInterestRates[i]);
+		}
+		for (size_t i = 1; i < pillars; i++)
+		{
+			m_vdSegmentSlope[i] = (m_vdSegmentValue[i + 1] - m_vdSegmentValue[i]) / (m_vdMaturities[i] - m_vdMaturities[i - 1]);
+		}
+
+		Time minimumSpacing = m_vdMaturities.back() - m_vdMaturities.front();
+		for (size_t i = 1; i < pillars; i++)
+		{
+			minimumSpacing = std::min(minimumSpacing, m_vdMaturities[i] - m_vdMaturities[i - 1]);
+		}
+
+		// capped so that compiling stays O(N) on curves with a very dense short end
+		size_t buckets = minimumSpacing > 0
+			? std::min((size_t)((m_vdMaturities.back() - m_vdMaturities.front()) / minimumSpacing) + 1, 8 * pillars)
+			: 1;
+		m_dBucketWidth = minimumSpacing > 0 ? (m_vdMaturities.back() - m_vdMaturities.front()) / buckets : 1.;
+		m_viBucketSegment.resize(buckets + 1);
+		size_t index = 0;
+		for (size_t b = 0; b <= buckets; b++)
+		{
+			Time bucketStart = m_vdMaturities.front() + b * m_dBucketWidth;
+			while (index < pillars && m_vdMaturities[index] < bucketStart)
+			{
+				index++;
+			}
+			m_viBucketSegment[b] = (unsigned int)index;
+		}
+	}
+
+	// true when compiled from a curve equal to t_curve, which then needs no recompiling
+	bool compiledFrom(YieldCurve const& t_curve) const
+	{
+		return !m_vdMaturities.empty()
+			&& m_interpolationMethod == t_curve.getInterpolationMethod()
+			&& m_vdMaturities == t_curve.maturities()
+			&& m_vdInterestRates == t_curve.interestRates();
+	}
+
+	// number of pillars strictly before t, i.e. the segment holding t
+	size_t segment(Time t) const
+	{
+		return segmentOf(table(), t);
+	}
+
+	Value discount(Time t) const
+	{
+		SegmentTable segments = table();
+		return discountOnSegment(segments, segmentOf(segments, t), t);
+	}
+
+	// f(0, t), on the segment holding t (the one on its left at a pillar)
+	Value instantaneousForward(Time t) const
+	{
+		SegmentTable segments = table();
+		return forwardOnSegment(segments, segmentOf(segments, t), t);
+	}
+
+	// batched and vectorised, see discountBatch; sorted times are searched by a merge over the pillars
+	void discount(const Time* t, Value* out, size_t n, bool sorted = false) const
+	{
+		discountBatch(table(), t, out, n, sorted);
+	}
+
+	SegmentTable table() const
+	{
+		return SegmentTable{
+			m_interpolationMethod,
+			m_vdMaturities.data(),
+			m_vdMaturities.size(),
+			m_vdSegmentStart.data(),
+			m_vdSegmentValue.data(),
+			m_vdSegmentSlope.data(),
+			m_viBucketSegment.data(),
+			m_viBucketSegment.size() - 1,
+			m_dBucketWidth };
+	}
+
+	InterpolationType getInterpolationMethod() const
+	{
+		return m_interpolationMethod;
+	}
+	std::vector<Time> const& maturities() const
+	{
+		return m_vdMaturities;
+	}
+
+private:
+
+	// transform of the rate that the interpolation method keeps linear in time
+	Value nodeValue(Time t_maturity, Value t_interestRate) const
+	{
+		switch (m_interpolationMethod)
+		{
+		case LINEAR_ON_Y:
+			return t_interestRate;
+		case LOGLINEAR_ON_Y:
+			return log(t_interestRate);
+		case LINEAR_ON_EXP_X_TIMES_Y:
+			return exp(-t_maturity * t_interestRate);
+		case LOGLINEAR_ON_EXP_X_TIMES_Y:
+			return -t_maturity * t_interestRate;
+		}
+
+		return t_interestRate;
+	}
+
+	InterpolationType m_interpolationMethod = LINEAR_ON_Y;
+	std::vector<Time> m_vdMaturities;
+	std::vector<Value> m_vdInterestRates; // of the source curve
+
+	std::vector<Time> m_vdSegmentStart;
+	std::vector<Value> m_vdSegmentValue;
+	std::vector<Value> m_vdSegmentSlope;
+
+	Time m_dBucketWidth = 1.;
+	std::vector<unsigned int> m_viBucketSegment;
 };
 
-class Swap
+template <typename T>
+class BasicSwap
 {
 public:
-	Swap() {}
-	Swap(SwapType t_SwapType,
+	using value_type = T;
+	template <typename U>
+	using rebind = BasicSwap<U>;
+
+	BasicSwap() {}
+	BasicSwap(SwapType t_SwapType,
 		long t_Notional,
 		Value t_Strike,
 		Time t_PricingDate,
 		Time t_StartDate,
 		Time t_EndDate,
 		size_t t_NbPayments,
-		YieldCurve t_ZeroCoupon)
+		BasicYieldCurve<T> t_ZeroCoupon)
 		:
 		m_SwapType(t_SwapType),
 		m_iNotional(t_Notional),
@@ -70,20 +306,20 @@ public:
 		m_dStartDate(t_StartDate),
 		m_dEndDate(t_EndDate),
 		m_dNbPayments(t_NbPayments),
-		m_vdPaymentDates(linspace<Time>(m_dStartDate, m_dEndDate, m_dNbPayments)),
 		m_ZeroCoupon(t_ZeroCoupon),
-		m_ForwardCurve(m_ZeroCoupon)
+		m_ForwardCurve(m_ZeroCoupon),
+		m_pSchedule(std::make_shared<Schedule const>(equalSchedule(t_StartDate, t_EndDate, t_NbPayments)))
 	{}
 
-	Swap(SwapType t_SwapType,
+	BasicSwap(SwapType t_SwapType,
 		long t_Notional,
 		Value t_Strike,
 		Time t_PricingDate,
 		Time t_StartDate,
 		Time t_EndDate,
 		size_t t_NbPayments,
-		YieldCurve t_ZeroCoupon,
-		YieldCurve t_ForwardCurve)
+		BasicYieldCurve<T> t_ZeroCoupon,
+		BasicYieldCurve<T> t_ForwardCurve)
 		:
 		m_SwapType(t_SwapType),
 		m_iNotional(t_Notional),
@@ -92,9 +328,41 @@ public:
 		m_dStartDate(t_StartDate),
 		m_dEndDate(t_EndDate),
 		m_dNbPayments(t_NbPayments),
-		m_vdPaymentDates(linspace<Time>(m_dStartDate, m_dEndDate, m_dNbPayments)),
 		m_ZeroCoupon(t_ZeroCoupon),
-		m_ForwardCurve(t_ForwardCurve)
+		m_ForwardCurve(t_ForwardCurve),
+		m_pSchedule(std::make_shared<Schedule const>(equalSchedule(t_StartDate, t_EndDate, t_NbPayments)))
+	{}
+
+	// on a generated schedule (see makeSchedule), shared with the copies of the swap and the swaps it is
+	// rebuilt into, so that pricing reads the cached payment times and accruals
+	BasicSwap(SwapType t_SwapType,
+		long t_Notional,
+		Value t_Strike,
+		Time t_PricingDate,
+		std::shared_ptr<Schedule const> t_pSchedule,
+		BasicYieldCurve<T> t_ZeroCoupon,
+		BasicYieldCurve<T> t_ForwardCurve)
+		:
+		m_SwapType(t_SwapType),
+		m_iNotional(t_Notional),
+		m_dStrike(t_Strike),
+		m_dPricingDate(t_PricingDate),
+		m_dStartDate(t_pSchedule->paymentTimes.front()),
+		m_dEndDate(t_pSchedule->paymentTimes.back()),
+		m_dNbPayments(t_pSchedule->paymentTimes.size()),
+		m_ZeroCoupon(t_ZeroCoupon),
+		m_ForwardCurve(t_ForwardCurve),
+		m_pSchedule(t_pSchedule)
+	{}
+	BasicSwap(SwapType t_SwapType,
+		long t_Notional,
+		Value t_Strike,
+		Time t_PricingDate,
+		Schedule t_Schedule,
+		BasicYieldCurve<T> t_ZeroCoupon,
+		BasicYieldCurve<T> t_ForwardCurve)
+		: BasicSwap(t_SwapType, t_Notional, t_Strike, t_PricingDate, std::make_shared<Schedule const>(std::move(t_Schedule)),
+			t_ZeroCoupon, t_ForwardCurve)
 	{}
 
 	using Parameter = std::variant<
@@ -103,9 +371,58 @@ public:
 		double,
 		size_t,
 		SwapType,
-		YieldCurve,
+		BasicYieldCurve<T>,
 		std::vector<Time>>;
 
+	SwapType getSwapType() const
+	{
+		return m_SwapType;
+	}
+	long getNotional() const
+	{
+		return m_iNotional;
+	}
+	Value getStrike() const
+	{
+		return m_dStrike;
+	}
+	std::vector<Time> const& getPaymentDates() const
+	{
+		return m_pSchedule->paymentTimes;
+	}
+	// accrual fraction of every period between two payment dates
+	std::vector<Time> const& getAccruals() const
+	{
+		return m_pSchedule->accruals;
+	}
+	std::shared_ptr<Schedule const> const& getSchedule() const
+	{
+		return m_pSchedule;
+	}
+	BasicYieldCurve<T> const& getZeroCoupon() const
+	{
+		return m_ZeroCoupon;
+	}
+	BasicYieldCurve<T> const& getForwardCurve() const
+	{
+		return m_ForwardCurve;
+	}
+
+	// same trade priced on other curves, e.g. the active curve of a bootstrap
+	template <typename U>
+	BasicSwap<U> withCurves(BasicYieldCurve<U> t_ZeroCoupon, BasicYieldCurve<U> t_ForwardCurve) const
+	{
+		return BasicSwap<U>(m_SwapType, m_iNotional, m_dStrike, m_dPricingDate, m_pSchedule, t_ZeroCoupon, t_ForwardCurve);
+	}
+
+	// same trade on a new market quote
+	BasicSwap withStrike(Value t_Strike) const
+	{
+		BasicSwap swap(*this);
+		swap.m_dStrike = t_Strike;
+		return swap;
+	}
+
 	std::unordered_map<std::string, Parameter> getParameters()
 	{
 		std::unordered_map<std::string, Parameter> myMap;
@@ -115,7 +432,7 @@ public:
 		myMap["pricing_date"] = m_dPricingDate;
 		myMap["zero_coupon"] = m_ZeroCoupon;
 		myMap["forward_curve"] = m_ForwardCurve;
-		myMap["payment_dates"] = m_vdPaymentDates;
+		myMap["payment_dates"] = m_pSchedule->paymentTimes;
 		return myMap;
 	}
 
@@ -127,8 +444,210 @@ private:
 	Time m_dStartDate;
 	Time m_dEndDate;
 	size_t m_dNbPayments;
-	YieldCurve m_ZeroCoupon;
-	YieldCurve m_ForwardCurve;
+	BasicYieldCurve<T> m_ZeroCoupon;
+	BasicYieldCurve<T> m_ForwardCurve;
+
+	std::shared_ptr<Schedule const> m_pSchedule;
+};
+
+using Swap = BasicSwap<Value>;
+
+// Tenor basis swap: the floating leg on t_FirstForward plus the quoted spread against the floating leg on
+// t_SecondForward, both discounted on t_ZeroCoupon. Each leg is a payer swap on its own schedule, the first
+// one struck at minus the spread and the second one at zero, so the value is the difference of their prices.
+template <typename T>
+class BasicBasisSwap
+{
+public:
+	using value_type = T;
+	template <typename U>
+	using rebind = BasicBasisSwap<U>;
+
+	BasicBasisSwap() {}
+	BasicBasisSwap(long t_Notional,
+		Value t_Spread,
+		Time t_PricingDate,
+		Time t_StartDate,
+		Time t_EndDate,
+		size_t t_FirstNbPayments,
+		size_t t_SecondNbPayments,
+		BasicYieldCurve<T> t_ZeroCoupon,
+		BasicYieldCurve<T> t_FirstForward,
+		BasicYieldCurve<T> t_SecondForward)
+		:
+		m_dSpread(t_Spread),
+		m_FirstLeg(PAYER, t_Notional, -t_Spread, t_PricingDate, t_StartDate, t_EndDate, t_FirstNbPayments,
+			t_ZeroCoupon, t_FirstForward),
+		m_SecondLeg(PAYER, t_Notional, 0., t_PricingDate, t_StartDate, t_EndDate, t_SecondNbPayments,
+			t_ZeroCoupon, t_SecondForward)
+	{}
+
+	Value getStrike() const
+	{
+		return m_dSpread;
+	}
+	BasicSwap<T> const& getFirstLeg() const
+	{
+		return m_FirstLeg;
+	}
+	BasicSwap<T> const& getSecondLeg() const
+	{
+		return m_SecondLeg;
+	}
+
+	// same trade on a new market quote
+	BasicBasisSwap withStrike(Value t_Spread) const
+	{
+		BasicBasisSwap swap(*this);
+		swap.m_dSpread = t_Spread;
+		swap.m_FirstLeg = m_FirstLeg.withStrike(-t_Spread);
+		return swap;
+	}
+
+private:
+	Value m_dSpread;
+	BasicSwap<T> m_FirstLeg;
+	BasicSwap<T> m_SecondLeg;
+};
 
+using BasisSwap = BasicBasisSwap<Value>;
+
+// Book of swaps priced on shared curves, in structure-of-arrays form: the terms of each swap and, one entry
+// per accrual period, the flattened schedules. Payment dates are indexed into the sorted grid of the distinct
+// dates of the book, so that a pricing needs one batched discount evaluation per curve over that grid.
+class SwapPortfolio
+{
+public:
+	SwapPortfolio() {}
+	SwapPortfolio(std::vector<Swap> const& t_vSwaps)
+	{
+		for (Swap const& swap : t_vSwaps)
+		{
+			addSchedule(swap.getSwapType(), swap.getNotional(), swap.getStrike(), *swap.getSchedule());
+		}
+		compile();
+	}
+	SwapPortfolio(std::vector<SwapType> const& t_vSwapTypes,
+		std::vector<long> const& t_viNotionals,
+		std::vector<Value> const& t_vdStrikes,
+		std::vector<Time> const& t_vdStartDates,
+		std::vector<Time> const& t_vdEndDates,
+		std::vector<size_t> const& t_viNbPayments)
+	{
+		for (size_t i = 0; i < t_vSwapTypes.size(); i++)
+		{
+			addSchedule(t_vSwapTypes[i], t_viNotionals[i], t_vdStrikes[i],
+				equalSchedule(t_vdStartDates[i], t_vdEndDates[i], t_viNbPayments[i]));
+		}
+		compile();
+	}
+
+	size_t size() const
+	{
+		return m_vdStrikes.size();
+	}
+	size_t periods() const
+	{
+		return m_vdPeriodAccrual.size();
+	}
+
+	// periods of swap i are [periodOffsets()[i], periodOffsets()[i + 1])
+	std::vector<size_t> const& periodOffsets() const
+	{
+		return m_viPeriodOffset;
+	}
+	std::vector<Time> const& dates() const
+	{
+		return m_vdDates;
+	}
+	std::vector<SwapType> const& swapTypes() const
+	{
+		return m_vSwapTypes;
+	}
+	std::vector<long> const& notionals() const
+	{
+		return m_viNotionals;
+	}
+	std::vector<Value> const& strikes() const
+	{
+		return m_vdStrikes;
+	}
+
+	// positions of the start and end dates of every period on dates()
+	std::vector<unsigned int> const& periodStartDate() const
+	{
+		return m_viPeriodStartDate;
+	}
+	std::vector<unsigned int> const& periodEndDate() const
+	{
+		return m_viPeriodEndDate;
+	}
+	std::vector<Time> const& periodAccrual() const
+	{
+		return m_vdPeriodAccrual;
+	}
+	std::vector<Value> const& periodStrike() const
+	{
+		return m_vdPeriodStrike;
+	}
+
+private:
+
+	void addSchedule(SwapType t_SwapType, long t_Notional, Value t_Strike, Schedule const& t_schedule)
+	{
+		if (m_viPeriodOffset.empty())
+		{
+			m_viPeriodOffset.push_back(0);
+		}
+		m_vSwapTypes.push_back(t_SwapType);
+		m_viNotionals.push_back(t_Notional);
+		m_vdStrikes.push_back(t_Strike);
+
+		std::vector<Time> const& paymentDates = t_schedule.paymentTimes;
+		for (size_t i = 1; i < paymentDates.size(); i++)
+		{
+			m_vdPaymentDates.push_back(paymentDates[i - 1]);
+			m_vdPaymentDates.push_back(paymentDates[i]);
+			m_vdPeriodAccrual.push_back(t_schedule.accruals[i - 1]);
+			m_vdPeriodStrike.push_back(t_Strike);
+		}
+		m_viPeriodOffset.push_back(m_vdPeriodAccrual.size());
+	}
+
+	// grid of the distinct payment dates and the position of every period's dates on it
+	void compile()
+	{
+		m_vdDates = m_vdPaymentDates;
+		std::sort(m_vdDates.begin(), m_vdDates.end());
+		m_vdDates.erase(std::unique(m_vdDates.begin(), m_vdDates.end()), m_vdDates.end());
+
+		m_viPeriodStartDate.resize(periods());
+		m_viPeriodEndDate.resize(periods());
+		for (size_t i = 0; i < periods(); i++)
+		{
+			m_viPeriodStartDate[i] = (unsigned int)(std::lower_bound(m_vdDates.begin(), m_vdDates.end(), m_vdPaymentDates[2 * i]) - m_vdDates.begin());
+			m_viPeriodEndDate[i] = (unsigned int)(std::lower_bound(m_vdDates.begin(), m_vdDates.end(), m_vdPaymentDates[2 * i + 1]) - m_vdDates.begin());
+		}
+		std::vector<Time>().swap(m_vdPaymentDates);
+	}
+
+	std::vector<SwapType> m_vSwapTypes;
+	std::vector<long> m_viNotionals;
+	std::vector<Value> m_vdStrikes;
+	std::vector<size_t> m_viPeriodOffset;
+
+	// start and end date of every period, only kept until compiled
 	std::vector<Time> m_vdPaymentDates;
+	std::vector<Time> m_vdPeriodAccrual;
+	std::vector<Value> m_vdPeriodStrike;
+	std::vector<unsigned int> m_viPeriodStartDate;
+	std::vector<unsigned int> m_viPeriodEndDate;
+
+	std::vector<Time> m_vdDates;
 };
+
+// swap type to build on a given curve, for instrument builders written once for plain and active curves
+template <class Curve>
+using SwapOn = BasicSwap<typename std::decay_t<Curve>::value_type>;
+template <class Curve>
+using BasisSwapOn = BasicBasisSwap<typename std::decay_t<Curve>::value_type>;
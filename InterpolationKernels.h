@@ -0,0 +1,381 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "MathTools.h"
+
+using Time = double;
+using Value = double;
+
+// View on the compiled segments of a curve (see FrozenYieldCurve): segment k holds the times in
+// (maturities[k-1], maturities[k]], segments 0 and pillars being the flat extrapolations, and on each segment
+// the node value is segmentValue + segmentSlope * (t - segmentStart).
+struct SegmentTable
+{
+	InterpolationType interpolationMethod;
+	Time const* maturities;
+	size_t pillars;
+	Time const* segmentStart;
+	Value const* segmentValue;
+	Value const* segmentSlope;
+	unsigned int const* bucketSegment;
+	size_t buckets;
+	Time bucketWidth;
+};
+
+inline size_t segmentOf(SegmentTable const& table, Time t)
+{
+	if (t <= table.maturities[0])
+	{
+		return 0;
+	}
+	if (t > table.maturities[table.pillars - 1])
+	{
+		return table.pillars;
+	}
+
+	size_t bucket = std::min((size_t)((t - table.maturities[0]) / table.bucketWidth), table.buckets);
+	size_t index = table.bucketSegment[bucket];
+	while (index < table.pillars && table.maturities[index] < t)
+	{
+		index++;
+	}
+	while (index > 0 && table.maturities[index - 1] >= t) // bucket start rounded above t
+	{
+		index--;
+	}
+
+	return index;
+}
+
+inline Value discountOnSegment(SegmentTable const& table, size_t segment, Time t)
+{
+	Value value = table.segmentValue[segment] + table.segmentSlope[segment] * (t - table.segmentStart[segment]);
+
+	switch (table.interpolationMethod)
+	{
+	case LINEAR_ON_Y:
+		return exp(-value * t);
+	case LOGLINEAR_ON_Y:
+		return exp(-exp(value) * t);
+	case LINEAR_ON_EXP_X_TIMES_Y:
+		return t > 0 ? value : 1.;
+	case LOGLINEAR_ON_EXP_X_TIMES_Y:
+		return t > 0 ? exp(value) : 1.;
+	}
+
+	return 1.;
+}
+
+// instantaneous forward f(0, t) = -d log P(0, t) / dt on a known segment, the derivative of the interpolation
+// method's transform along the segment (the flat extrapolations keep their node value, not their rate)
+inline Value forwardOnSegment(SegmentTable const& table, size_t segment, Time t)
+{
+	Value slope = table.segmentSlope[segment];
+	Value value = table.segmentValue[segment] + slope * (t - table.segmentStart[segment]);
+
+	switch (table.interpolationMethod)
+	{
+	case LINEAR_ON_Y:
+		return value + t * slope;
+	case LOGLINEAR_ON_Y:
+		return exp(value) * (1. + t * slope);
+	case LINEAR_ON_EXP_X_TIMES_Y:
+		return -slope / value;
+	case LOGLINEAR_ON_EXP_X_TIMES_Y:
+		return -slope;
+	}
+
+	return 0.;
+}
+
+// exp(r) on |r| <= ln(2)/2 by its Taylor series up to r^13, the remaining term being below 2E-16
+constexpr double expCoefficients[14] = {
+	1., 1., 1. / 2, 1. / 6, 1. / 24, 1. / 120, 1. / 720, 1. / 5040, 1. / 40320, 1. / 362880, 1. / 3628800,
+	1. / 39916800, 1. / 479001600, 1. / 6227020800 };
+
+constexpr double expLog2E = 1.4426950408889634;
+constexpr double expLn2High = 6.93147180369123816490e-01;
+constexpr double expLn2Low = 1.90821492927058770002e-10;
+
+#if defined(__AVX512F__)
+
+inline __m512d exp512(__m512d x)
+{
+	x = _mm512_max_pd(_mm512_min_pd(x, _mm512_set1_pd(708.)), _mm512_set1_pd(-708.));
+	__m512d n = _mm512_roundscale_pd(_mm512_mul_pd(x, _mm512_set1_pd(expLog2E)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	__m512d r = _mm512_fnmadd_pd(n, _mm512_set1_pd(expLn2High), x);
+	r = _mm512_fnmadd_pd(n, _mm512_set1_pd(expLn2Low), r);
+
+	__m512d p = _mm512_set1_pd(expCoefficients[13]);
+	for (int k = 12; k >= 0; k--)
+	{
+		p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(expCoefficients[k]));
+	}
+
+	return _mm512_scalef_pd(p, n);
+}
+
+// segments of 8 query times: bucket lookup, then a vectorised walk to the exact segment
+inline __m512i segments8(SegmentTable const& table, __m512d time)
+{
+	__m512d front = _mm512_set1_pd(table.maturities[0]);
+	__m512d back = _mm512_set1_pd(table.maturities[table.pillars - 1]);
+	__m512i one = _mm512_set1_epi64(1);
+
+	__m512d bucket = _mm512_div_pd(_mm512_sub_pd(time, front), _mm512_set1_pd(table.bucketWidth));
+	bucket = _mm512_max_pd(_mm512_min_pd(bucket, _mm512_set1_pd((double)table.buckets)), _mm512_setzero_pd());
+	__m512i bucketIndex = _mm512_cvtepi32_epi64(_mm512_cvttpd_epi32(bucket));
+	__m512i index = _mm512_cvtepu32_epi64(_mm512_i64gather_epi32(bucketIndex, table.bucketSegment, 4));
+
+	// walk forward then backward until every lane sits on its segment
+	__m512i lastPillar = _mm512_set1_epi64((long long)table.pillars - 1);
+	__mmask8 move = 0xFF;
+	while (move)
+	{
+		__m512i clamped = _mm512_min_epi64(index, lastPillar);
+		__m512d pillar = _mm512_i64gather_pd(clamped, table.maturities, 8);
+		move = _mm512_cmp_epi64_mask(index, lastPillar, _MM_CMPINT_LE) & _mm512_cmp_pd_mask(pillar, time, _CMP_LT_OQ);
+		index = _mm512_mask_add_epi64(index, move, index, one);
+	}
+	move = 0xFF;
+	while (move)
+	{
+		__m512i previous = _mm512_max_epi64(_mm512_sub_epi64(index, one), _mm512_setzero_si512());
+		__m512d pillar = _mm512_i64gather_pd(previous, table.maturities, 8);
+		move = _mm512_cmp_epi64_mask(index, _mm512_setzero_si512(), _MM_CMPINT_GT) & _mm512_cmp_pd_mask(pillar, time, _CMP_GE_OQ);
+		index = _mm512_mask_sub_epi64(index, move, index, one);
+	}
+	index = _mm512_mask_mov_epi64(index, _mm512_cmp_pd_mask(time, front, _CMP_LE_OQ), _mm512_setzero_si512());
+	index = _mm512_mask_mov_epi64(index, _mm512_cmp_pd_mask(time, back, _CMP_GT_OQ), _mm512_set1_epi64((long long)table.pillars));
+
+	return index;
+}
+
+// discount factors of 8 query times on known segments: gathered segments and the interpolation method's transform
+inline __m512d discount8(SegmentTable const& table, __m512d time, __m512i index)
+{
+	__m512d start = _mm512_i64gather_pd(index, table.segmentStart, 8);
+	__m512d slope = _mm512_i64gather_pd(index, table.segmentSlope, 8);
+	__m512d value = _mm512_fmadd_pd(slope, _mm512_sub_pd(time, start), _mm512_i64gather_pd(index, table.segmentValue, 8));
+
+	__m512d result;
+	__mmask8 positive = _mm512_cmp_pd_mask(time, _mm512_setzero_pd(), _CMP_GT_OQ);
+	switch (table.interpolationMethod)
+	{
+	case LINEAR_ON_Y:
+		result = exp512(_mm512_mul_pd(_mm512_sub_pd(_mm512_setzero_pd(), value), time));
+		break;
+	case LOGLINEAR_ON_Y:
+		result = exp512(_mm512_mul_pd(_mm512_sub_pd(_mm512_setzero_pd(), exp512(value)), time));
+		break;
+	case LINEAR_ON_EXP_X_TIMES_Y:
+		result = _mm512_mask_mov_pd(_mm512_set1_pd(1.), positive, value);
+		break;
+	default:
+		result = _mm512_mask_mov_pd(_mm512_set1_pd(1.), positive, exp512(value));
+		break;
+	}
+
+	return result;
+}
+
+#elif defined(__AVX2__)
+
+inline __m256d exp256(__m256d x)
+{
+	x = _mm256_max_pd(_mm256_min_pd(x, _mm256_set1_pd(708.)), _mm256_set1_pd(-708.));
+	__m256d n = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(expLog2E)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	__m256d r = _mm256_sub_pd(x, _mm256_mul_pd(n, _mm256_set1_pd(expLn2High)));
+	r = _mm256_sub_pd(r, _mm256_mul_pd(n, _mm256_set1_pd(expLn2Low)));
+
+	__m256d p = _mm256_set1_pd(expCoefficients[13]);
+	for (int k = 12; k >= 0; k--)
+	{
+		p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(expCoefficients[k]));
+	}
+
+	// 2^n built directly in the exponent bits
+	__m256i exponent = _mm256_add_epi64(_mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n)), _mm256_set1_epi64x(1023));
+	return _mm256_mul_pd(p, _mm256_castsi256_pd(_mm256_slli_epi64(exponent, 52)));
+}
+
+// segments of 4 query times: bucket lookup, then a vectorised walk to the exact segment
+inline __m256i segments4(SegmentTable const& table, __m256d time)
+{
+	__m256d front = _mm256_set1_pd(table.maturities[0]);
+	__m256d back = _mm256_set1_pd(table.maturities[table.pillars - 1]);
+
+	__m256d bucket = _mm256_div_pd(_mm256_sub_pd(time, front), _mm256_set1_pd(table.bucketWidth));
+	bucket = _mm256_max_pd(_mm256_min_pd(bucket, _mm256_set1_pd((double)table.buckets)), _mm256_setzero_pd());
+	__m256i bucketIndex = _mm256_cvtepi32_epi64(_mm256_cvttpd_epi32(bucket));
+	__m256i index = _mm256_cvtepu32_epi64(_mm256_i64gather_epi32((int const*)table.bucketSegment, bucketIndex, 4));
+
+	// walk forward then backward until every lane sits on its segment; comparison masks are all ones (-1)
+	__m256i pillars = _mm256_set1_epi64x((long long)table.pillars);
+	__m256i one = _mm256_set1_epi64x(1);
+	for (;;)
+	{
+		__m256i inRange = _mm256_cmpgt_epi64(pillars, index);
+		__m256i clamped = _mm256_blendv_epi8(_mm256_sub_epi64(pillars, one), index, inRange);
+		__m256d pillar = _mm256_i64gather_pd(table.maturities, clamped, 8);
+		__m256i move = _mm256_and_si256(inRange, _mm256_castpd_si256(_mm256_cmp_pd(pillar, time, _CMP_LT_OQ)));
+		if (_mm256_testz_si256(move, move))
+		{
+			break;
+		}
+		index = _mm256_sub_epi64(index, move);
+	}
+	for (;;)
+	{
+		__m256i positiveIndex = _mm256_cmpgt_epi64(index, _mm256_setzero_si256());
+		__m256i previous = _mm256_and_si256(_mm256_sub_epi64(index, one), positiveIndex);
+		__m256d pillar = _mm256_i64gather_pd(table.maturities, previous, 8);
+		__m256i move = _mm256_and_si256(positiveIndex, _mm256_castpd_si256(_mm256_cmp_pd(pillar, time, _CMP_GE_OQ)));
+		if (_mm256_testz_si256(move, move))
+		{
+			break;
+		}
+		index = _mm256_add_epi64(index, move);
+	}
+	index = _mm256_andnot_si256(_mm256_castpd_si256(_mm256_cmp_pd(time, front, _CMP_LE_OQ)), index);
+	index = _mm256_blendv_epi8(index, pillars, _mm256_castpd_si256(_mm256_cmp_pd(time, back, _CMP_GT_OQ)));
+
+	return index;
+}
+
+// discount factors of 4 query times on known segments: gathered segments and the interpolation method's transform
+inline __m256d discount4(SegmentTable const& table, __m256d time, __m256i index)
+{
+	__m256d start = _mm256_i64gather_pd(table.segmentStart, index, 8);
+	__m256d slope = _mm256_i64gather_pd(table.segmentSlope, index, 8);
+	__m256d value = _mm256_add_pd(_mm256_i64gather_pd(table.segmentValue, index, 8), _mm256_mul_pd(slope, _mm256_sub_pd(time, start)));
+
+	__m256d result;
+	__m256d positive = _mm256_cmp_pd(time, _mm256_setzero_pd(), _CMP_GT_OQ);
+	switch (table.interpolationMethod)
+	{
+	case LINEAR_ON_Y:
+		result = exp256(_mm256_mul_pd(_mm256_sub_pd(_mm256_setzero_pd(), value), time));
+		break;
+	case LOGLINEAR_ON_Y:
+		result = exp256(_mm256_mul_pd(_mm256_sub_pd(_mm256_setzero_pd(), exp256(value)), time));
+		break;
+	case LINEAR_ON_EXP_X_TIMES_Y:
+		result = _mm256_blendv_pd(_mm256_set1_pd(1.), value, positive);
+		break;
+	default:
+		result = _mm256_blendv_pd(_mm256_set1_pd(1.), exp256(value), positive);
+		break;
+	}
+
+	return result;
+}
+
+#endif
+
+#if defined(__AVX512F__)
+constexpr size_t discountBatchWidth = 8;
+constexpr char const* discountBatchInstructionSet = "AVX-512";
+#elif defined(__AVX2__)
+constexpr size_t discountBatchWidth = 4;
+constexpr char const* discountBatchInstructionSet = "AVX2";
+#else
+constexpr char const* discountBatchInstructionSet = "scalar";
+#endif
+
+// Discount factors at n query times. Built with AVX-512 (__AVX512F__) or AVX2 (__AVX2__, e.g. /arch:AVX2)
+// the lookups, gathers and exps run 8 or 4 lanes at a time, otherwise one at a time. Sorted query times,
+// like the payment dates of a schedule, are matched to their segments by a single merge over the pillars
+// instead of the bucket lookup.
+inline void discountBatch(SegmentTable const& table, Time const* t, Value* out, size_t n, bool sorted = false)
+{
+	size_t i = 0;
+	size_t segment = 0;
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+	long long segments[discountBatchWidth];
+
+	for (; i + discountBatchWidth <= n; i += discountBatchWidth)
+	{
+		if (sorted)
+		{
+			for (size_t lane = 0; lane < discountBatchWidth; lane++)
+			{
+				while (segment < table.pillars && table.maturities[segment] < t[i + lane])
+				{
+					segment++;
+				}
+				segments[lane] = (long long)segment;
+			}
+		}
+#if defined(__AVX512F__)
+		__m512d time = _mm512_loadu_pd(t + i);
+		__m512i index = sorted ? _mm512_loadu_si512(segments) : segments8(table, time);
+		_mm512_storeu_pd(out + i, discount8(table, time, index));
+#elif defined(__AVX2__)
+		__m256d time = _mm256_loadu_pd(t + i);
+		__m256i index = sorted ? _mm256_loadu_si256((__m256i const*)segments) : segments4(table, time);
+		_mm256_storeu_pd(out + i, discount4(table, time, index));
+#endif
+	}
+#endif
+
+	for (; i < n; i++)
+	{
+		if (sorted)
+		{
+			while (segment < table.pillars && table.maturities[segment] < t[i])
+			{
+				segment++;
+			}
+		}
+		out[i] = discountOnSegment(table, sorted ? segment : segmentOf(table, t[i]), t[i]);
+	}
+}
+
+// exp of n values, 8 or 4 lanes at a time like discountBatch; out may be x. The remainder goes through the
+// same kernel in a padded register, so that exp(x[i]) does not depend on n nor on where the batch starts.
+inline void expBatch(Value const* x, Value* out, size_t n)
+{
+	size_t i = 0;
+
+#if defined(__AVX512F__)
+	for (; i + 8 <= n; i += 8)
+	{
+		_mm512_storeu_pd(out + i, exp512(_mm512_loadu_pd(x + i)));
+	}
+	if (i < n)
+	{
+		alignas(64) Value lanes[8] = {};
+		std::copy(x + i, x + n, lanes);
+		_mm512_store_pd(lanes, exp512(_mm512_load_pd(lanes)));
+		std::copy(lanes, lanes + (n - i), out + i);
+		i = n;
+	}
+#elif defined(__AVX2__)
+	for (; i + 4 <= n; i += 4)
+	{
+		_mm256_storeu_pd(out + i, exp256(_mm256_loadu_pd(x + i)));
+	}
+	if (i < n)
+	{
+		alignas(32) Value lanes[4] = {};
+		std::copy(x + i, x + n, lanes);
+		_mm256_store_pd(lanes, exp256(_mm256_load_pd(lanes)));
+		std::copy(lanes, lanes + (n - i), out + i);
+		i = n;
+	}
+#endif
+
+	for (; i < n; i++)
+	{
+		out[i] = std::exp(x[i]);
+	}
+}
@@ -0,0 +1,470 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+// allocator of 64 byte aligned blocks, a cache line and an AVX-512 register
+template <typename T>
+struct AlignedAllocator
+{
+	using value_type = T;
+	static constexpr std::size_t alignment = 64;
+
+	AlignedAllocator() = default;
+	template <typename U>
+	AlignedAllocator(AlignedAllocator<U> const&) {}
+
+	T* allocate(std::size_t n)
+	{
+		return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignment)));
+	}
+	void deallocate(T* p, std::size_t)
+	{
+		::operator delete(p, std::align_val_t(alignment));
+	}
+
+	template <typename U>
+	bool operator==(AlignedAllocator<U> const&) const
+	{
+		return true;
+	}
+	template <typename U>
+	bool operator!=(AlignedAllocator<U> const&) const
+	{
+		return false;
+	}
+};
+
+// Dense column-major matrix in one aligned block, the leading dimension rounded up to a cache line so that
+// every column starts aligned. matrix(i, j) is row i of column j; resize() keeps the storage when it is large
+// enough, so a matrix refilled at every iteration allocates once.
+template <typename T>
+class Matrix
+{
+public:
+	Matrix() {}
+	Matrix(size_t t_iRows, size_t t_iColumns, T const& t_value = T())
+	{
+		resize(t_iRows, t_iColumns);
+		std::fill(m_vData.begin(), m_vData.end(), t_value);
+	}
+
+	void resize(size_t t_iRows, size_t t_iColumns)
+	{
+		constexpr size_t lane = std::max(AlignedAllocator<T>::alignment / sizeof(T), (size_t)1);
+		m_iRows = t_iRows;
+		m_iColumns = t_iColumns;
+		m_iLeadingDimension = (t_iRows + lane - 1) / lane * lane;
+		m_vData.resize(m_iLeadingDimension * t_iColumns);
+	}
+
+	size_t rows() const
+	{
+		return m_iRows;
+	}
+	size_t columns() const
+	{
+		return m_iColumns;
+	}
+	size_t leadingDimension() const
+	{
+		return m_iLeadingDimension;
+	}
+
+	T& operator()(size_t i, size_t j)
+	{
+		return m_vData[j * m_iLeadingDimension + i];
+	}
+	T const& operator()(size_t i, size_t j) const
+	{
+		return m_vData[j * m_iLeadingDimension + i];
+	}
+
+	T* column(size_t j)
+	{
+		return m_vData.data() + j * m_iLeadingDimension;
+	}
+	T const* column(size_t j) const
+	{
+		return m_vData.data() + j * m_iLeadingDimension;
+	}
+
+	T* data()
+	{
+		return m_vData.data();
+	}
+	T const* data() const
+	{
+		return m_vData.data();
+	}
+
+private:
+	size_t m_iRows = 0;
+	size_t m_iColumns = 0;
+	size_t m_iLeadingDimension = 0;
+	std::vector<T, AlignedAllocator<T>> m_vData;
+};
+
+// Dense LU and Cholesky factorizations of column-major matrices, on a backend chosen at build time:
+//   XVA_USE_MKL     Intel MKL (the Visual Studio project defines it)
+//   XVA_USE_LAPACK  any library exporting the Fortran LAPACK symbols: OpenBLAS, reference LAPACK, ...
+//   neither         the header-only kernels below, without any dependency
+// With a library, systems of up to XVA_SMALL_SYSTEM_SIZE unknowns still go to the header-only kernels. It
+// defaults to 0, every system going to the library: the kernels only beat it on curve sized systems (20 to 60
+// pillars) when built with -O3, and lose by about 2x at -O2, the MSVC Release default. benchmarkLinearAlgebra
+// times both on the OIS jacobian, to set it (e.g. to 64) for a build where they win. Pivots follow the LAPACK
+// convention (1-based row interchanges).
+#if defined(XVA_USE_MKL)
+#include <mkl.h>
+constexpr char const* linearAlgebraBackend = "MKL";
+#elif defined(XVA_USE_LAPACK)
+extern "C"
+{
+	void dgetrf_(int const* m, int const* n, double* a, int const* lda, int* ipiv, int* info);
+	void dgetrs_(char const* trans, int const* n, int const* nrhs, double const* a, int const* lda, int const* ipiv,
+		double* b, int const* ldb, int* info, size_t transLength);
+	void dpotrf_(char const* uplo, int const* n, double* a, int const* lda, int* info, size_t uploLength);
+	void dpotrs_(char const* uplo, int const* n, int const* nrhs, double const* a, int const* lda, double* b,
+		int const* ldb, int* info, size_t uploLength);
+}
+constexpr char const* linearAlgebraBackend = "LAPACK";
+#else
+constexpr char const* linearAlgebraBackend = "header-only";
+#endif
+
+#if !defined(XVA_SMALL_SYSTEM_SIZE)
+#define XVA_SMALL_SYSTEM_SIZE 0
+#endif
+constexpr int smallSystemSize = XVA_SMALL_SYSTEM_SIZE;
+
+// LU with partial pivoting of the n x n matrix a in place, a = P L U, L unit lower. Right looking and
+// unblocked: the update of every column is an axpy over contiguous entries. Returns 0, or k > 0 when
+// U(k - 1, k - 1) is exactly zero (LAPACK info).
+inline int smallLuFactorize(int n, double* a, int lda, int* pivots)
+{
+	int info = 0;
+	for (int k = 0; k < n; k++)
+	{
+		double* column = a + (size_t)k * lda;
+		int pivot = k;
+		for (int i = k + 1; i < n; i++)
+		{
+			if (std::abs(column[i]) > std::abs(column[pivot]))
+			{
+				pivot = i;
+			}
+		}
+		pivots[k] = pivot + 1;
+		if (column[pivot] == 0.)
+		{
+			if (info == 0)
+			{
+				info = k + 1;
+			}
+			continue;
+		}
+		if (pivot != k)
+		{
+			for (int j = 0; j < n; j++)
+			{
+				std::swap(a[(size_t)j * lda + k], a[(size_t)j * lda + pivot]);
+			}
+		}
+
+		double inversePivot = 1. / column[k];
+		for (int i = k + 1; i < n; i++)
+		{
+			column[i] *= inversePivot;
+		}
+		for (int j = k + 1; j < n; j++)
+		{
+			double* target = a + (size_t)j * lda;
+			double u = target[k];
+			for (int i = k + 1; i < n; i++)
+			{
+				target[i] -= column[i] * u;
+			}
+		}
+	}
+	return info;
+}
+
+// solves a x = b from the factors of smallLuFactorize, x overwriting b. Backward substitution by columns
+// so that the inner loops stay contiguous.
+inline void smallLuSolve(int n, double const* a, int lda, int const* pivots, double* b)
+{
+	for (int k = 0; k < n; k++)
+	{
+		if (pivots[k] - 1 != k)
+		{
+			std::swap(b[k], b[pivots[k] - 1]);
+		}
+	}
+	for (int k = 0; k < n; k++)
+	{
+		double const* column = a + (size_t)k * lda;
+		double x = b[k];
+		for (int i = k + 1; i < n; i++)
+		{
+			b[i] -= column[i] * x;
+		}
+	}
+	for (int k = n - 1; k >= 0; k--)
+	{
+		double const* column = a + (size_t)k * lda;
+		b[k] /= column[k];
+		double x = b[k];
+		for (int i = 0; i < k; i++)
+		{
+			b[i] -= column[i] * x;
+		}
+	}
+}
+
+// solves a^T x = b for the t_nrhs columns of b (leading dimension ldb) from the factors of smallLuFactorize,
+// x overwriting b: U^T then L^T by dot products down the contiguous columns of the factors, then the row
+// interchanges in reverse order. The adjoint of a linear solve, e.g. to carry gradients through a calibration.
+inline void smallLuSolveTransposed(int n, double const* a, int lda, int const* pivots, double* b, int nrhs, int ldb)
+{
+	for (int r = 0; r < nrhs; r++)
+	{
+		double* x = b + (size_t)r * ldb;
+		for (int k = 0; k < n; k++)
+		{
+			double const* column = a + (size_t)k * lda;
+			double sum = x[k];
+			for (int i = 0; i < k; i++)
+			{
+				sum -= column[i] * x[i];
+			}
+			x[k] = sum / column[k];
+		}
+		for (int k = n - 1; k >= 0; k--)
+		{
+			double const* column = a + (size_t)k * lda;
+			double sum = x[k];
+			for (int i = k + 1; i < n; i++)
+			{
+				sum -= column[i] * x[i];
+			}
+			x[k] = sum;
+		}
+		for (int k = n - 1; k >= 0; k--)
+		{
+			if (pivots[k] - 1 != k)
+			{
+				std::swap(x[k], x[pivots[k] - 1]);
+			}
+		}
+	}
+}
+
+// a = U^T U of a symmetric positive definite matrix, U written over the upper triangle (the strict lower
+// triangle is not referenced), as dpotrf("U"). Right looking: row k of U is copied to a contiguous buffer so
+// that the update of every column is an axpy. Returns 0, or k > 0 when the leading minor of order k is not
+// positive.
+inline int smallCholeskyFactorize(int n, double* a, int lda)
+{
+	constexpr int stackRows = 64;
+	double rowBuffer[stackRows];
+	std::vector<double> largeRowBuffer(n > stackRows ? n : 0);
+	double* row = n > stackRows ? largeRowBuffer.data() : rowBuffer;
+
+	for (int k = 0; k < n; k++)
+	{
+		double diagonal = a[(size_t)k * lda + k];
+		if (!(diagonal > 0.))
+		{
+			return k + 1;
+		}
+		diagonal = sqrt(diagonal);
+		a[(size_t)k * lda + k] = diagonal;
+		for (int j = k + 1; j < n; j++)
+		{
+			a[(size_t)j * lda + k] /= diagonal;
+			row[j] = a[(size_t)j * lda + k];
+		}
+		for (int j = k + 1; j < n; j++)
+		{
+			double* column = a + (size_t)j * lda;
+			double u = row[j];
+			for (int i = k + 1; i <= j; i++)
+			{
+				column[i] -= row[i] * u;
+			}
+		}
+	}
+	return 0;
+}
+
+// solves U^T U x = b from the factor of smallCholeskyFactorize, x overwriting b
+inline void smallCholeskySolve(int n, double const* a, int lda, double* b)
+{
+	for (int i = 0; i < n; i++)
+	{
+		double const* column = a + (size_t)i * lda;
+		double sum = b[i];
+		for (int k = 0; k < i; k++)
+		{
+			sum -= column[k] * b[k];
+		}
+		b[i] = sum / column[i];
+	}
+	for (int k = n - 1; k >= 0; k--)
+	{
+		double const* column = a + (size_t)k * lda;
+		b[k] /= column[k];
+		double x = b[k];
+		for (int i = 0; i < k; i++)
+		{
+			b[i] -= column[i] * x;
+		}
+	}
+}
+
+// LU factors, in the layout of smallLuFactorize, of a lower triangular matrix whose strict upper triangle is
+// zero: L = a D^-1 and U = D, the diagonal, so that no pivoting and no update is needed. O(n^2), against the
+// O(n^3) of a dense factorization. Returns 0, or k > 0 when a(k - 1, k - 1) is exactly zero.
+inline int lowerTriangularFactorize(int n, double* a, int lda, int* pivots)
+{
+	int info = 0;
+	for (int k = 0; k < n; k++)
+	{
+		double* column = a + (size_t)k * lda;
+		pivots[k] = k + 1;
+		if (column[k] == 0.)
+		{
+			if (info == 0)
+			{
+				info = k + 1;
+			}
+			continue;
+		}
+		double inversePivot = 1. / column[k];
+		for (int i = k + 1; i < n; i++)
+		{
+			column[i] *= inversePivot;
+		}
+	}
+	return info;
+}
+
+#if defined(XVA_USE_MKL) || defined(XVA_USE_LAPACK)
+// the library routines, whatever the size
+inline int libraryLuFactorize(int n, double* a, int lda, int* pivots)
+{
+	int info = 0;
+#if defined(XVA_USE_MKL)
+	dgetrf(&n, &n, a, &lda, pivots, &info);
+#else
+	dgetrf_(&n, &n, a, &lda, pivots, &info);
+#endif
+	return info;
+}
+
+inline void libraryLuSolve(int n, double const* a, int lda, int const* pivots, double* b)
+{
+	int const nrhs = 1;
+	int info = 0;
+#if defined(XVA_USE_MKL)
+	dgetrs("N", &n, &nrhs, a, &lda, pivots, b, &n, &info);
+#else
+	dgetrs_("N", &n, &nrhs, a, &lda, pivots, b, &n, &info, 1);
+#endif
+}
+
+inline void libraryLuSolveTransposed(int n, double const* a, int lda, int const* pivots, double* b, int nrhs, int ldb)
+{
+	int info = 0;
+#if defined(XVA_USE_MKL)
+	dgetrs("T", &n, &nrhs, a, &lda, pivots, b, &ldb, &info);
+#else
+	dgetrs_("T", &n, &nrhs, a, &lda, pivots, b, &ldb, &info, 1);
+#endif
+}
+
+inline int libraryCholeskyFactorize(int n, double* a, int lda)
+{
+	int info = 0;
+#if defined(XVA_USE_MKL)
+	dpotrf("U", &n, a, &lda, &info);
+#else
+	dpotrf_("U", &n, a, &lda, &info, 1);
+#endif
+	return info;
+}
+
+inline void libraryCholeskySolve(int n, double const* a, int lda, double* b)
+{
+	int const nrhs = 1;
+	int info = 0;
+#if defined(XVA_USE_MKL)
+	dpotrs("U", &n, &nrhs, a, &lda, b, &n, &info);
+#else
+	dpotrs_("U", &n, &nrhs, a, &lda, b, &n, &info, 1);
+#endif
+}
+#endif
+
+inline int luFactorize(int n, double* a, int lda, int* pivots)
+{
+#if defined(XVA_USE_MKL) || defined(XVA_USE_LAPACK)
+	if (n > smallSystemSize)
+	{
+		return libraryLuFactorize(n, a, lda, pivots);
+	}
+#endif
+	return smallLuFactorize(n, a, lda, pivots);
+}
+
+inline void luSolve(int n, double const* a, int lda, int const* pivots, double* b)
+{
+#if defined(XVA_USE_MKL) || defined(XVA_USE_LAPACK)
+	if (n > smallSystemSize)
+	{
+		libraryLuSolve(n, a, lda, pivots, b);
+		return;
+	}
+#endif
+	smallLuSolve(n, a, lda, pivots, b);
+}
+
+inline void luSolveTransposed(int n, double const* a, int lda, int const* pivots, double* b, int nrhs = 1, int ldb = 0)
+{
+	ldb = ldb > 0 ? ldb : n;
+#if defined(XVA_USE_MKL) || defined(XVA_USE_LAPACK)
+	if (n > smallSystemSize)
+	{
+		libraryLuSolveTransposed(n, a, lda, pivots, b, nrhs, ldb);
+		return;
+	}
+#endif
+	smallLuSolveTransposed(n, a, lda, pivots, b, nrhs, ldb);
+}
+
+inline int choleskyFactorize(int n, double* a, int lda)
+{
+#if defined(XVA_USE_MKL) || defined(XVA_USE_LAPACK)
+	if (n > smallSystemSize)
+	{
+		return libraryCholeskyFactorize(n, a, lda);
+	}
+#endif
+	return smallCholeskyFactorize(n, a, lda);
+}
+
+inline void choleskySolve(int n, double const* a, int lda, double* b)
+{
+#if defined(XVA_USE_MKL) || defined(XVA_USE_LAPACK)
+	if (n > smallSystemSize)
+	{
+		libraryCholeskySolve(n, a, lda, b);
+		return;
+	}
+#endif
+	smallCholeskySolve(n, a, lda, b);
+}
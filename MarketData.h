@@ -6,14 +6,14 @@
 
 int mainYieldCurve()
 {
-    std::chrono::steady_clock::time_point start = std::chrono::high_resolution_clock::now();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-    static auto swapInstruments = [&](YieldCurve& myZC)
+    static auto swapInstruments = [&](auto& myZC)
     {
-        std::vector<Swap> mySwapVect;
+        std::vector<SwapOn<decltype(myZC)>> mySwapVect;
         for (size_t i = 0; i < maturities.size(); i++)
         {
-            Swap swap(SwapType::PAYER, notional, strikes[i], 0., 0., maturities[i], (int)(4 * maturities[i]), myZC);
+            SwapOn<decltype(myZC)> swap(SwapType::PAYER, notional, strikes[i], 0., 0., maturities[i], (int)(4 * maturities[i]), myZC);
             mySwapVect.push_back(swap);
         }
         return mySwapVect;
@@ -30,9 +30,9 @@ int mainYieldCurve()
     std::cout << "\n*******************************************************************************************\n";
 
     std::cout << "\n";
-    std::chrono::steady_clock::time_point startC = std::chrono::high_resolution_clock::now();
+    std::chrono::steady_clock::time_point startC = std::chrono::steady_clock::now();
     myBootstrapp.calibrate();
-    std::chrono::steady_clock::time_point stop = std::chrono::high_resolution_clock::now();
+    std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
     std::chrono::milliseconds duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - startC);
     std::cout << "\n*******************************************************************************************\n";
 
@@ -60,7 +60,7 @@ int mainYieldCurve()
     }
     std::cout << "\n*******************************************************************************************\n";
 
-    stop = std::chrono::high_resolution_clock::now();
+    stop = std::chrono::steady_clock::now();
     duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
     std::cout << "\nRunning the code up to here took " << duration.count() << " milliseconds." << "\n";
     std::cout << "\n*******************************************************************************************\n";
@@ -78,12 +78,12 @@ int mainYieldCurve()
     std::cout << "\n*******************************************************************************************\n";
 
     // At this point we already know P(0, T) for the discount curve
-    static auto instruments = [&](YieldCurve& myFwdCurve)
+    static auto instruments = [&](auto& myFwdCurve)
     {
-        std::vector<Swap> mySwapVect;
+        std::vector<SwapOn<decltype(myFwdCurve)>> mySwapVect;
         for (size_t i = 0; i < fwdMaturities.size(); i++)
         {
-            Swap swap(SwapType::PAYER, notional, fwdStrikes[i], 0., 0., fwdMaturities[i], (int)((4 + i) * fwdMaturities[i]), myDiscountCurve, myFwdCurve);
+            SwapOn<decltype(myFwdCurve)> swap(SwapType::PAYER, notional, fwdStrikes[i], 0., 0., fwdMaturities[i], (int)((4 + i) * fwdMaturities[i]), myDiscountCurve, myFwdCurve);
             mySwapVect.push_back(swap);
         }
         return mySwapVect;
@@ -101,9 +101,9 @@ int mainYieldCurve()
     std::cout << "\n*******************************************************************************************\n";
 
     std::cout << "\n";
-    startC = std::chrono::high_resolution_clock::now();
+    startC = std::chrono::steady_clock::now();
     fwdCurveBootstrapp.calibrate();
-    stop = std::chrono::high_resolution_clock::now();
+    stop = std::chrono::steady_clock::now();
     duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - startC);
     std::cout << "\n*******************************************************************************************\n";
 
@@ -131,7 +131,7 @@ int mainYieldCurve()
     }
     std::cout << "\n*******************************************************************************************\n";
 
-    stop = std::chrono::high_resolution_clock::now();
+    stop = std::chrono::steady_clock::now();
     duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
     std::cout << "\nRunning the code up to here took " << duration.count() << " milliseconds." << "\n";
     std::cout << "\n*******************************************************************************************\n";
@@ -153,13 +153,13 @@ int mainYieldCurve()
     std::cout << "\n*******************************************************************************************\n";
 
     // At this point we already know P(0, T) for the discount curve
-    static auto bbgOIS = [&](YieldCurve& myCurve)
+    static auto bbgOIS = [&](auto& myCurve)
     {
-        std::vector<Swap> mySwapVect;
+        std::vector<SwapOn<decltype(myCurve)>> mySwapVect;
         for (size_t i = 0; i < maturitiesOIS.size(); i++)
         {
             int nbOfPayments = (int)(maturitiesOIS[i] > 1 ? maturitiesOIS[i] : 1);
-            Swap swap(SwapType::PAYER, notional, strikesOIS[i], 0., 0., maturitiesOIS[i], nbOfPayments, myCurve);
+            SwapOn<decltype(myCurve)> swap(SwapType::PAYER, notional, strikesOIS[i], 0., 0., maturitiesOIS[i], nbOfPayments, myCurve);
             mySwapVect.push_back(swap); // doesn't like the .push_back() I don't know why
         }
         return mySwapVect;
@@ -177,9 +177,9 @@ int mainYieldCurve()
     std::cout << "\n*******************************************************************************************\n";
 
     std::cout << "\n";
-    startC = std::chrono::high_resolution_clock::now();
-    bootstrappOIS.calibrate();
-    stop = std::chrono::high_resolution_clock::now();
+    startC = std::chrono::steady_clock::now();
+    bootstrappOIS.calibrate(SEQUENTIAL_BOOTSTRAP);
+    stop = std::chrono::steady_clock::now();
     duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - startC);
     std::cout << "\n*******************************************************************************************\n";
 
@@ -207,7 +207,7 @@ int mainYieldCurve()
     }
     std::cout << "\n*******************************************************************************************\n";
 
-    stop = std::chrono::high_resolution_clock::now();
+    stop = std::chrono::steady_clock::now();
     duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
     std::cout << "\nRunning the code up to here took " << duration.count() << " milliseconds." << "\n";
     std::cout << "\n*******************************************************************************************\n";
@@ -216,13 +216,13 @@ int mainYieldCurve()
     std::cout << "\n*******************************************************************************************\n";
 
     // At this point we already know P(0, T) for the discount curve
-    static auto bbgEUR3M = [&](YieldCurve& myCurve)
+    static auto bbgEUR3M = [&](auto& myCurve)
     {
-        std::vector<Swap> mySwapVect;
+        std::vector<SwapOn<decltype(myCurve)>> mySwapVect;
         for (size_t i = 0; i < maturitiesEUR3M.size(); i++)
         {
             int nbOfPayments = (int)(maturitiesEUR3M[i] > 1 ? 4 * maturitiesEUR3M[i] : 4);
-            Swap swap(SwapType::PAYER, notional, strikesEUR3M[i], 0., 0., maturitiesEUR3M[i], nbOfPayments, myOIS, myCurve);
+            SwapOn<decltype(myCurve)> swap(SwapType::PAYER, notional, strikesEUR3M[i], 0., 0., maturitiesEUR3M[i], nbOfPayments, myOIS, myCurve);
             mySwapVect.push_back(swap); // doesn't like the .push_back() I don't know why
         }
         return mySwapVect;
@@ -240,9 +240,9 @@ int mainYieldCurve()
     std::cout << "\n*******************************************************************************************\n";
 
     std::cout << "\n";
-    startC = std::chrono::high_resolution_clock::now();
-    bootstrappEUR3M.calibrate();
-    stop = std::chrono::high_resolution_clock::now();
+    startC = std::chrono::steady_clock::now();
+    bootstrappEUR3M.calibrate(SEQUENTIAL_BOOTSTRAP);
+    stop = std::chrono::steady_clock::now();
     duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - startC);
     std::cout << "\n*******************************************************************************************\n";
 
@@ -270,7 +270,7 @@ int mainYieldCurve()
     }
     std::cout << "\n*******************************************************************************************\n";
 
-    stop = std::chrono::high_resolution_clock::now();
+    stop = std::chrono::steady_clock::now();
     duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
     std::cout << "\nRunning all the code took " << duration.count() << " milliseconds." << "\n";
     std::cout << "\n*******************************************************************************************\n";
@@ -280,7 +280,7 @@ int mainYieldCurve()
 
 YieldCurve oisCurve()
 {
-    std::chrono::steady_clock::time_point start = std::chrono::high_resolution_clock::now();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
     std::cout << "\n*******************************************************************************************\n";
     std::cout << "\nLoading Bloomberg data..." << "\n";
@@ -289,13 +289,13 @@ YieldCurve oisCurve()
     std::cout << "\n*******************************************************************************************\n";
 
     // At this point we already know P(0, T) for the discount curve
-    static auto bbgOIS = [&](YieldCurve& myCurve)
+    static auto bbgOIS = [&](auto& myCurve)
     {
-        std::vector<Swap> mySwapVect;
+        std::vector<SwapOn<decltype(myCurve)>> mySwapVect;
         for (size_t i = 0; i < maturitiesOIS.size(); i++)
         {
             int nbOfPayments = (int)(maturitiesOIS[i] > 1 ? maturitiesOIS[i] : 1);
-            Swap swap(SwapType::PAYER, notional, strikesOIS[i], 0., 0., maturitiesOIS[i], nbOfPayments, myCurve);
+            SwapOn<decltype(myCurve)> swap(SwapType::PAYER, notional, strikesOIS[i], 0., 0., maturitiesOIS[i], nbOfPayments, myCurve);
             mySwapVect.push_back(swap);
         }
         return mySwapVect;
@@ -312,9 +312,9 @@ YieldCurve oisCurve()
     std::cout << "\n*******************************************************************************************\n";
 
     std::cout << "\n";
-    std::chrono::steady_clock::time_point startC = std::chrono::high_resolution_clock::now();
+    std::chrono::steady_clock::time_point startC = std::chrono::steady_clock::now();
     bootstrappOIS.calibrate();
-    std::chrono::steady_clock::time_point stop = std::chrono::high_resolution_clock::now();
+    std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
     std::chrono::milliseconds duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - startC);
     std::cout << "\n*******************************************************************************************\n";
 
@@ -337,7 +337,7 @@ YieldCurve oisCurve()
     }
     std::cout << "\n*******************************************************************************************\n";
 
-    stop = std::chrono::high_resolution_clock::now();
+    stop = std::chrono::steady_clock::now();
     duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
     std::cout << "\nRunning all the code took " << duration.count() << " milliseconds." << "\n";
     std::cout << "\n*******************************************************************************************\n";
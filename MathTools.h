@@ -1,6 +1,5 @@
 #pragma once
 
-#include <mkl.h>
 #include <vector>
 #include <functional>  // std::function, std::multiplies
 #include <numeric>    // std::accumulate, std::adjacent_difference
@@ -10,42 +9,12 @@
 #include <variant>
 #include <string>
 #include <chrono>
+#include <iostream> // std::cout
+#include <mutex> // std::call_once
 
-template <typename T>
-std::vector<T> flatten(
-	std::vector<std::vector<T>> const& inputMatrix
-)
-{
-	std::vector<T> outputVector;
-
-	for (std::vector<T> const& inputVectorElement : inputMatrix)
-	{
-		outputVector.insert(outputVector.end(), inputVectorElement.begin(), inputVectorElement.end());
-	}
-
-	return outputVector;
-}
-
-template <typename T>
-std::vector<std::vector<T>> unflatten(
-	std::vector<T> const& inputVector,
-	size_t const matrixColumnSize
-)
-{
-	size_t const matrixRowSize = (size_t)(inputVector.size() / matrixColumnSize);
-	
-	std::vector<std::vector<T>> outputMatrix(matrixRowSize, std::vector<T>(matrixColumnSize));
-
-	for (size_t i = 0; i < matrixRowSize; i++)
-	{
-		for (size_t j = 0; j < matrixColumnSize; j++)
-		{
-			outputMatrix[i][j] = inputVector[i * matrixColumnSize + j];
-		}
-	}
-
-	return outputMatrix;
-}
+#include "AutoDiff.h"
+#include "LinearAlgebra.h"
+#include "ThreadPool.h"
 
 template <typename T>
 std::vector<T> linspace(
@@ -126,6 +95,25 @@ enum InterpolationType
     LOGLINEAR_ON_EXP_X_TIMES_Y //= loglinear on zc price if Y is interest rates
 };
 
+// pillars of yAxis bracketing value (a single one when xAxis has a single point)
+template <typename T, typename U = T>
+std::vector<T> bracketAxis(
+    U const& value,
+    std::vector<U> const& xAxis,
+    std::vector<T> const& yAxis
+)
+{
+    if (xAxis.size() < 2)
+    {
+        return yAxis;
+    }
+
+    size_t upper = std::distance(xAxis.begin(), std::lower_bound(xAxis.begin(), xAxis.end(), value));
+    upper = std::min(std::max(upper, (size_t)1), xAxis.size() - 1);
+
+    return { yAxis[upper - 1], yAxis[upper] };
+}
+
 template <typename T, typename U = T>
 T interpolate(
     U const& xToInterpolate,
@@ -144,14 +132,16 @@ T interpolate(
     }
     if (m_interpolationMethod == LINEAR_ON_EXP_X_TIMES_Y)
     {
-        std::vector<U> vdExpXY = yAxis;
-        std::transform(xAxis.begin(), xAxis.end(), yAxis.begin(), vdExpXY.begin(),
+        // only the two pillars around xToInterpolate enter the interpolation, so only those are transformed
+        std::vector<U> xBracket = bracketAxis<U>(xToInterpolate, xAxis, xAxis);
+        std::vector<T> vdExpXY = bracketAxis<T, U>(xToInterpolate, xAxis, yAxis);
+        std::transform(xBracket.begin(), xBracket.end(), vdExpXY.begin(), vdExpXY.begin(),
             [](U const& x, T const& y)
             {
                 return exp(-x * y);
             }); // in order to do something like vdExpXY = exp(-xAxis * yAxis); before applying the linear interpolation to the ExpXY
 
-        T interpolated_price = linearInterpolation<T, U>(xToInterpolate, xAxis, vdExpXY);
+        T interpolated_price = linearInterpolation<T, U>(xToInterpolate, xBracket, vdExpXY);
 
         if (xToInterpolate > 0)
         {
@@ -164,14 +154,16 @@ T interpolate(
     }
     if (m_interpolationMethod == LOGLINEAR_ON_EXP_X_TIMES_Y)
     {
-        std::vector<T> vdExpXY = yAxis;
-        std::transform(xAxis.begin(), xAxis.end(), yAxis.begin(), vdExpXY.begin(),
-            [](U const& x,T const& y)
+        // only the two pillars around xToInterpolate enter the interpolation, so only those are transformed
+        std::vector<U> xBracket = bracketAxis<U>(xToInterpolate, xAxis, xAxis);
+        std::vector<T> vdExpXY = bracketAxis<T, U>(xToInterpolate, xAxis, yAxis);
+        std::transform(xBracket.begin(), xBracket.end(), vdExpXY.begin(), vdExpXY.begin(),
+            [](U const& x, T const& y)
             {
                 return exp(-x * y);
             }); // in order to do something like vdExpXY = exp(-xAxis * yAxis); before applying the log linear interpolation to the ExpXY
 
-        T interpolated_price = linearInterpolation<T, U>(xToInterpolate, xAxis, vdExpXY, true);
+        T interpolated_price = linearInterpolation<T, U>(xToInterpolate, xBracket, vdExpXY, true);
 
         if (xToInterpolate > 0)
         {
@@ -186,103 +178,705 @@ T interpolate(
     return 0;
 }
 
+// solves the square system inputMatrix x = inputVector on the linear algebra backend (LinearAlgebra.h), the
+// LU factors written over inputMatrix and the solution over inputVector: no allocation once ipiv is sized
 template <typename T>
-std::vector<T> mklSystemSolver(
-    std::vector<std::vector<T>> const& inputMatrix,
-    std::vector<T> const& inputVector
+void systemSolverInPlace(
+    Matrix<T>& inputMatrix,
+    std::vector<T>& inputVector,
+    std::vector<int>& ipiv
 )
 {
-    int const m = (int)inputMatrix.size();
     int const n = (int)inputVector.size();
-    int const nrhs = 1;
-    int info;
-    std::vector<int> ipiv(m * n);
-    std::vector<T> inputMatrixFlattened = flatten<T>(inputMatrix);
-    std::vector<T> outputVector = inputVector;
+    int const lda = (int)inputMatrix.leadingDimension();
+    ipiv.resize(n);
+
+    luFactorize(n, inputMatrix.data(), lda, ipiv.data());
+    luSolve(n, inputMatrix.data(), lda, ipiv.data(), inputVector.data());
+}
 
-    dgetrf(&m, &n, inputMatrixFlattened.data(), &m, ipiv.data(), &info);
+// same on copies
+template <typename T>
+std::vector<T> systemSolver(
+    Matrix<T> const& inputMatrix,
+    std::vector<T> const& inputVector
+)
+{
+    Matrix<T> factors = inputMatrix;
+    std::vector<T> outputVector = inputVector;
+    std::vector<int> ipiv(inputVector.size());
 
-    dgetrs("N", &n, &nrhs, inputMatrixFlattened.data(), &m, ipiv.data(), outputVector.data(), &n, &info);
+    systemSolverInPlace(factors, outputVector, ipiv);
 
     return outputVector;
 }
 
+// upper factor U of inputMatrix = U^T U, the strict lower triangle left as in inputMatrix
 template <typename T>
-std::vector<std::vector<T>> mklCholesky(
-    std::vector<std::vector<T>> const& inputMatrix
+Matrix<T> cholesky(
+    Matrix<T> const& inputMatrix
 )
 {
-    int const m = (int)inputMatrix.size();
-    int const n = (int)inputMatrix[0].size();
-    int info;
-    std::vector<int> ipiv(m * n);
-    std::vector<T> inputMatrixFlattened = flatten<T>(inputMatrix);
-    
-    dpotrf("U", &n, inputMatrixFlattened.data(), &m, &info);
-    
-    return unflatten(inputMatrixFlattened, n);
+    Matrix<T> factor = inputMatrix;
+
+    choleskyFactorize((int)factor.columns(), factor.data(), (int)factor.leadingDimension());
+
+    return factor;
 }
 
+// bumped jacobian, jacobian(j, i) the derivative of objective j with respect to xVariable[i]
 template <typename T>
-std::vector<std::vector<T>> computeJacobian(
-    std::vector<T>& xVariable, 
-    std::function<std::vector<T>(std::vector<T>)> objectiveFunction
+void computeJacobian(
+    std::vector<T>& xVariable,
+    std::function<std::vector<T>(std::vector<T>)> objectiveFunction,
+    Matrix<T>& jacobian,
+    ThreadPool* threadPool = nullptr
 )
 {
     double h = 1E-8;
     size_t xSize = xVariable.size();
-    std::vector<std::vector<T>> jacobian(xSize);
 
     std::vector<T> function = objectiveFunction(xVariable);
-    std::vector<T> shockedFunction(xSize);
-    std::vector<T> derivative(xSize);
-    std::vector<T> shockedVariable = xVariable;
+    jacobian.resize(function.size(), xSize);
+
+    // columns are independent: with a pool they are shared out between its threads,
+    // the objective function then has to be safe to call concurrently
+    auto computeColumns = [&](size_t begin, size_t end)
+    {
+        std::vector<T> shockedFunction;
+        std::vector<T> shockedVariable = xVariable;
+
+        for (size_t i = begin; i < end; i++)
+        {
+            shockedVariable[i] = xVariable[i] + h; // we will be shocking only the index i
+            shockedFunction = objectiveFunction(shockedVariable);
+            shockedVariable[i] = xVariable[i]; // back to normal in order not to affect next iteration
+
+            T* derivative = jacobian.column(i);
+            for (size_t j = 0; j < function.size(); j++)
+            {
+                derivative[j] = (shockedFunction[j] - function[j]) * (1 / h);
+            }
+        }
+    };
+
+    if (threadPool)
+    {
+        threadPool->parallelFor(xSize, computeColumns);
+    }
+    else
+    {
+        computeColumns(0, xSize);
+    }
+}
+
+template <typename T>
+Matrix<T> computeJacobian(
+    std::vector<T>& xVariable,
+    std::function<std::vector<T>(std::vector<T>)> objectiveFunction,
+    ThreadPool* threadPool = nullptr
+)
+{
+    Matrix<T> jacobian;
+    computeJacobian<T>(xVariable, objectiveFunction, jacobian, threadPool);
+    return jacobian;
+}
+
+// exact jacobian in forward sweeps: the variables are seeded by blocks of Dual<T>::width, each with its own
+// tangent direction (the others being constants), and the objective is evaluated once per block on active
+// scalars; the plain values are returned in functionValue. With a pool, every thread sweeps its own blocks.
+template <typename T>
+void computeJacobian(
+    std::vector<T>& xVariable,
+    std::function<std::vector<Dual<T>>(std::vector<Dual<T>>)> activeObjectiveFunction,
+    std::vector<T>& functionValue,
+    Matrix<T>& jacobian,
+    ThreadPool* threadPool = nullptr
+)
+{
+    size_t xSize = xVariable.size();
+    // the number of objectives is only known after a sweep: the first block to finish sizes the matrix
+    std::once_flag sized;
 
-    for (size_t i = 0; i < xVariable.size(); i++)
+    size_t width = Dual<T>::width;
+    auto computeColumns = [&](size_t begin, size_t end)
     {
-        shockedVariable[i] = xVariable[i] + h; // we will be shocking only the index i
-        shockedFunction = objectiveFunction(shockedVariable);
-        shockedVariable[i] = xVariable[i]; // back to normal in order not to affect next iteration
+        std::vector<Dual<T>> activeVariable(xVariable.begin(), xVariable.end());
+        for (size_t block = begin; block < end; block += width)
+        {
+            size_t blockEnd = std::min(block + width, end);
+            for (size_t i = block; i < blockEnd; i++)
+            {
+                activeVariable[i] = Dual<T>::variable(xVariable[i], i - block);
+            }
 
-        vdSub(xSize, shockedFunction.data(), function.data(), derivative.data());
-        cblas_dscal(xSize, 1 / h, derivative.data(), 1);
+            std::vector<Dual<T>> activeFunction = activeObjectiveFunction(activeVariable);
+            std::call_once(sized, [&] { jacobian.resize(activeFunction.size(), xSize); });
+
+            // same layout as the bumped version: column i holds the derivatives with respect to xVariable[i]
+            for (size_t i = block; i < blockEnd; i++)
+            {
+                T* derivative = jacobian.column(i);
+                for (size_t j = 0; j < activeFunction.size(); j++)
+                {
+                    derivative[j] = activeFunction[j].tangent(i - block);
+                }
+                activeVariable[i] = Dual<T>(xVariable[i]);
+            }
+            if (block == 0)
+            {
+                functionValue.resize(activeFunction.size());
+                for (size_t j = 0; j < activeFunction.size(); j++)
+                {
+                    functionValue[j] = activeFunction[j].value();
+                }
+            }
+        }
+    };
 
-        jacobian[i] = derivative;
+    if (threadPool)
+    {
+        // whole blocks per thread
+        size_t blocks = (xSize + width - 1) / width;
+        threadPool->parallelFor(xSize, computeColumns, width * ((blocks + threadPool->size() - 1) / threadPool->size()));
+    }
+    else
+    {
+        computeColumns(0, xSize);
     }
+}
 
+template <typename T>
+Matrix<T> computeJacobian(
+    std::vector<T>& xVariable,
+    std::function<std::vector<Dual<T>>(std::vector<Dual<T>>)> activeObjectiveFunction,
+    std::vector<T>& functionValue,
+    ThreadPool* threadPool = nullptr
+)
+{
+    Matrix<T> jacobian;
+    computeJacobian<T>(xVariable, activeObjectiveFunction, functionValue, jacobian, threadPool);
     return jacobian;
 }
 
+// Structural nonzeros of a jacobian, rows[i] the objectives depending on xVariable[i], with a greedy colouring
+// of its columns: the columns of one colour share no row, so that they can be bumped (or seeded) together and
+// still be told apart. Local interpolations give lower triangular patterns (instrument j only depends on the
+// pillars up to its own), whose factorization is O(n^2).
+struct JacobianPattern
+{
+    JacobianPattern() {}
+    JacobianPattern(size_t t_objectives, std::vector<std::vector<size_t>> t_rows)
+        : objectives(t_objectives), rows(std::move(t_rows))
+    {
+        std::vector<std::vector<char>> colourRows;
+        lowerTriangular = objectives == rows.size();
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            size_t colour = 0;
+            for (; colour < colourRows.size(); colour++)
+            {
+                if (std::none_of(rows[i].begin(), rows[i].end(), [&](size_t j) { return colourRows[colour][j]; }))
+                {
+                    break;
+                }
+            }
+            if (colour == colourRows.size())
+            {
+                colourRows.emplace_back(objectives, 0);
+                colours.emplace_back();
+            }
+            for (size_t j : rows[i])
+            {
+                colourRows[colour][j] = 1;
+                lowerTriangular = lowerTriangular && j >= i;
+            }
+            colours[colour].push_back(i);
+        }
+    }
+
+    bool empty() const
+    {
+        return rows.empty();
+    }
+
+    size_t objectives = 0;
+    std::vector<std::vector<size_t>> rows;
+    std::vector<std::vector<size_t>> colours; // columns of every colour
+    bool lowerTriangular = false;
+};
+
+// pattern of the entries of a computed jacobian that are not exactly zero
+template <typename T>
+JacobianPattern jacobianPattern(Matrix<T> const& jacobian)
+{
+    std::vector<std::vector<size_t>> rows(jacobian.columns());
+    for (size_t i = 0; i < jacobian.columns(); i++)
+    {
+        T const* derivative = jacobian.column(i);
+        for (size_t j = 0; j < jacobian.rows(); j++)
+        {
+            if (derivative[j] != T(0))
+            {
+                rows[i].push_back(j);
+            }
+        }
+    }
+    return JacobianPattern(jacobian.rows(), std::move(rows));
+}
+
+// bumped jacobian on a known pattern: one evaluation per colour instead of one per variable, the entries
+// outside the pattern set to zero
 template <typename T>
-void multivariateNewtonRaphson(
+void computeJacobian(
     std::vector<T>& xVariable,
     std::function<std::vector<T>(std::vector<T>)> objectiveFunction,
-    double tolerance = 1E-16, int maxIterations = 100
+    JacobianPattern const& pattern,
+    Matrix<T>& jacobian,
+    ThreadPool* threadPool = nullptr
+)
+{
+    double h = 1E-8;
+    std::vector<T> function = objectiveFunction(xVariable);
+    jacobian.resize(function.size(), xVariable.size());
+    std::fill(jacobian.data(), jacobian.data() + jacobian.leadingDimension() * jacobian.columns(), T(0));
+
+    auto computeColours = [&](size_t begin, size_t end)
+    {
+        std::vector<T> shockedFunction;
+        std::vector<T> shockedVariable = xVariable;
+
+        for (size_t colour = begin; colour < end; colour++)
+        {
+            std::vector<size_t> const& columns = pattern.colours[colour];
+            for (size_t i : columns)
+            {
+                shockedVariable[i] = xVariable[i] + h;
+            }
+            shockedFunction = objectiveFunction(shockedVariable);
+            for (size_t i : columns)
+            {
+                shockedVariable[i] = xVariable[i];
+                T* derivative = jacobian.column(i);
+                for (size_t j : pattern.rows[i])
+                {
+                    derivative[j] = (shockedFunction[j] - function[j]) * (1 / h);
+                }
+            }
+        }
+    };
+
+    if (threadPool)
+    {
+        threadPool->parallelFor(pattern.colours.size(), computeColours);
+    }
+    else
+    {
+        computeColours(0, pattern.colours.size());
+    }
+}
+
+// exact jacobian on a known pattern: the variables of one colour share a tangent direction, so the sweeps
+// carry one tangent per colour instead of one per variable
+template <typename T>
+void computeJacobian(
+    std::vector<T>& xVariable,
+    std::function<std::vector<Dual<T>>(std::vector<Dual<T>>)> activeObjectiveFunction,
+    std::vector<T>& functionValue,
+    JacobianPattern const& pattern,
+    Matrix<T>& jacobian,
+    ThreadPool* threadPool = nullptr
+)
+{
+    size_t colourCount = pattern.colours.size();
+    jacobian.resize(pattern.objectives, xVariable.size());
+    std::fill(jacobian.data(), jacobian.data() + jacobian.leadingDimension() * jacobian.columns(), T(0));
+    functionValue.resize(pattern.objectives);
+
+    size_t width = Dual<T>::width;
+    auto computeColours = [&](size_t begin, size_t end)
+    {
+        std::vector<Dual<T>> activeVariable(xVariable.begin(), xVariable.end());
+        for (size_t block = begin; block < end; block += width)
+        {
+            size_t blockEnd = std::min(block + width, end);
+            for (size_t colour = block; colour < blockEnd; colour++)
+            {
+                for (size_t i : pattern.colours[colour])
+                {
+                    activeVariable[i] = Dual<T>::variable(xVariable[i], colour - block);
+                }
+            }
+
+            std::vector<Dual<T>> activeFunction = activeObjectiveFunction(activeVariable);
+
+            for (size_t colour = block; colour < blockEnd; colour++)
+            {
+                for (size_t i : pattern.colours[colour])
+                {
+                    T* derivative = jacobian.column(i);
+                    for (size_t j : pattern.rows[i])
+                    {
+                        derivative[j] = activeFunction[j].tangent(colour - block);
+                    }
+                    activeVariable[i] = Dual<T>(xVariable[i]);
+                }
+            }
+            if (block == 0)
+            {
+                for (size_t j = 0; j < activeFunction.size(); j++)
+                {
+                    functionValue[j] = activeFunction[j].value();
+                }
+            }
+        }
+    };
+
+    if (threadPool)
+    {
+        size_t blocks = (colourCount + width - 1) / width;
+        threadPool->parallelFor(colourCount, computeColours, width * ((blocks + threadPool->size() - 1) / threadPool->size()));
+    }
+    else
+    {
+        computeColours(0, colourCount);
+    }
+}
+
+enum NewtonMethod
+{
+    NEWTON,             //= a fresh jacobian and factorization at every iteration
+    BROYDEN,            //= one factorization reused with rank one (good) Broyden updates of its inverse, a fresh jacobian when the residual stops halving
+    LEVENBERG_MARQUARDT //= a fresh jacobian at every accepted step, normal equations damped by mu diag(J^T J), mu adapted to the progress
+};
+
+template <typename T>
+T squaredNorm(std::vector<T> const& vector)
+{
+    return std::accumulate(vector.begin(), vector.end(), T(0),
+        [](const auto& a, const auto& b) { return a + b * b; });
+}
+
+// Jacobian factors kept from one solve to the next: a solve from a nearby point (a recalibration after a few
+// quotes moved) starts BROYDEN iterations from them instead of a fresh jacobian
+template <typename T>
+struct NewtonState
+{
+    Matrix<T> jacobian;      // LU factors of the last jacobian once factorized
+    std::vector<int> pivots;
+    bool factorized = false;
+    bool verbose = true;     // iterations printed to std::cout
+    // set, or read from the first jacobian when detectPattern, the jacobians are computed on the pattern and
+    // lower triangular ones factorized without pivoting
+    JacobianPattern pattern;
+    bool detectPattern = false;
+};
+
+// LU factors of a jacobian in place, O(n^2) for a lower triangular pattern
+template <typename T>
+void factorizeJacobian(Matrix<T>& jacobian, std::vector<int>& ipiv, NewtonState<T>& state)
+{
+    int const n = (int)jacobian.columns();
+    ipiv.resize(n);
+    if (state.detectPattern && state.pattern.empty())
+    {
+        state.pattern = jacobianPattern(jacobian);
+    }
+    if (state.pattern.lowerTriangular && state.pattern.rows.size() == (size_t)n)
+    {
+        lowerTriangularFactorize(n, jacobian.data(), (int)jacobian.leadingDimension(), ipiv.data());
+    }
+    else
+    {
+        luFactorize(n, jacobian.data(), (int)jacobian.leadingDimension(), ipiv.data());
+    }
+    state.factorized = true;
+}
+
+// Solver loop shared by the bumped and the exact versions below: evaluate(x, F, J) writes F(x) and, when J is
+// not null, the jacobian at x. The error is the squared norm of the last step. Returns the number of
+// jacobians computed.
+template <typename T, class Evaluate>
+int newtonSolve(
+    std::vector<T>& xVariable,
+    Evaluate evaluate,
+    double tolerance, int maxIterations,
+    NewtonMethod method,
+    NewtonState<T>* state = nullptr
 )
 {
     double error = 1E10;
     size_t xSize = xVariable.size();
+    NewtonState<T> localState;
+    NewtonState<T>& solverState = state ? *state : localState;
+    Matrix<T>& mJacobian = solverState.jacobian;
+    std::vector<int>& ipiv = solverState.pivots;
     std::vector<T> vTarget;
-    std::vector<std::vector<T>> mJacobian;
     std::vector<T> vError(xSize);
+    int jacobians = 0;
+    ipiv.resize(xSize);
 
-    for (int i = 0; i < maxIterations && error > tolerance; i++)
+    if (method == NEWTON)
     {
-        vTarget = objectiveFunction(xVariable);
-        mJacobian = computeJacobian<T>(xVariable, objectiveFunction);
-        vError = mklSystemSolver<T>(mJacobian, vTarget);
+        // the jacobian and its factors share one matrix, refilled in place at every iteration
+        for (int i = 0; i < maxIterations && error > tolerance; i++)
+        {
+            evaluate(xVariable, vError, &mJacobian);
+            jacobians++;
+            factorizeJacobian(mJacobian, ipiv, solverState);
+            luSolve((int)xSize, mJacobian.data(), (int)mJacobian.leadingDimension(), ipiv.data(), vError.data());
 
-        vdSub(xSize, xVariable.data(), vError.data(), xVariable.data());
-        // xVariable -= vError
+            for (size_t j = 0; j < xSize; j++)
+            {
+                xVariable[j] -= vError[j];
+            }
 
-        error = std::accumulate(vError.begin(), vError.end(), 0.,
-            [](const auto& a, const auto& b) { return a + b * b; });
+            error = squaredNorm(vError);
 
-        std::cout << "iteration " << i << ", error value = " << error << "\n";
+            if (solverState.verbose)
+            {
+                std::cout << "iteration " << i << ", error value = " << error << "\n";
+            }
+        }
+        return jacobians;
     }
 
+    if (method == BROYDEN)
+    {
+        // inverse jacobian H_k = H_0 + updates: H_(k+1) z = H_k z + a_k (s_k . H_k z), H_0 from the LU factors
+        std::vector<std::vector<T>> vUpdates;
+        std::vector<std::vector<T>> vSteps;
+        auto applyInverse = [&](std::vector<T>& z)
+        {
+            luSolve((int)xSize, mJacobian.data(), (int)mJacobian.leadingDimension(), ipiv.data(), z.data());
+            for (size_t k = 0; k < vUpdates.size(); k++)
+            {
+                T projection = std::inner_product(vSteps[k].begin(), vSteps[k].end(), z.begin(), T(0));
+                for (size_t j = 0; j < xSize; j++)
+                {
+                    z[j] += vUpdates[k][j] * projection;
+                }
+            }
+        };
+        bool fresh = false; // the inverse is the one of a jacobian computed at the current point
+        double previousError = 0.;
+        auto refresh = [&]()
+        {
+            evaluate(xVariable, vTarget, &mJacobian);
+            jacobians++;
+            factorizeJacobian(mJacobian, ipiv, solverState);
+            vUpdates.clear();
+            vSteps.clear();
+            fresh = true;
+        };
+
+        std::vector<T> vNextTarget;
+        std::vector<T> vUpdate(xSize);
+        if (solverState.factorized && mJacobian.columns() == xSize)
+        {
+            evaluate(xVariable, vTarget, nullptr);
+        }
+        else
+        {
+            refresh();
+        }
+        for (int i = 0; i < maxIterations; i++)
+        {
+            vError = vTarget;
+            applyInverse(vError);
+            for (size_t j = 0; j < xSize; j++)
+            {
+                xVariable[j] -= vError[j];
+            }
+
+            error = squaredNorm(vError);
+
+            if (solverState.verbose)
+            {
+                std::cout << "iteration " << i << ", error value = " << error << "\n";
+            }
+
+            // A NEWTON step below the tolerance leaves a next step of the order of its square. The updated inverse
+            // only converges superlinearly: its small steps stop the iterations once the next one, extrapolated
+            // from the ratio of the last two, is as small (or when taken from a fresh jacobian, as NEWTON).
+            if (error <= tolerance && (fresh || error * error <= tolerance * tolerance * previousError))
+            {
+                break;
+            }
+            fresh = false;
+            previousError = error;
+            evaluate(xVariable, vNextTarget, nullptr);
+            if (squaredNorm(vNextTarget) > 0.25 * squaredNorm(vTarget) || vUpdates.size() >= xSize)
+            {
+                refresh();
+                continue;
+            }
+
+            // secant condition H_(k+1) y = s with s = -vError the step and y the change of the residuals
+            for (size_t j = 0; j < xSize; j++)
+            {
+                vUpdate[j] = vNextTarget[j] - vTarget[j];
+            }
+            applyInverse(vUpdate);
+            std::vector<T> vStep(xSize);
+            for (size_t j = 0; j < xSize; j++)
+            {
+                vStep[j] = -vError[j];
+            }
+            T denominator = std::inner_product(vStep.begin(), vStep.end(), vUpdate.begin(), T(0));
+            if (denominator != T(0))
+            {
+                for (size_t j = 0; j < xSize; j++)
+                {
+                    vUpdate[j] = (vStep[j] - vUpdate[j]) / denominator;
+                }
+                vUpdates.push_back(vUpdate);
+                vSteps.push_back(vStep);
+            }
+            vTarget.swap(vNextTarget);
+        }
+        return jacobians;
+    }
+
+    // Levenberg-Marquardt: (J^T J + mu diag(J^T J)) step = J^T F, also for more instruments than pillars
+    T mu = 1E-3;
+    solverState.factorized = false;
+    Matrix<T> mNormal(xSize, xSize);
+    std::vector<T> vTrial(xSize);
+    std::vector<T> vTrialTarget;
+    evaluate(xVariable, vTarget, &mJacobian);
+    jacobians++;
+    for (int i = 0; i < maxIterations && error > tolerance; i++)
+    {
+        size_t targets = vTarget.size();
+        for (size_t j = 0; j < xSize; j++)
+        {
+            T const* column = mJacobian.column(j);
+            for (size_t k = 0; k <= j; k++)
+            {
+                mNormal(k, j) = std::inner_product(column, column + targets, mJacobian.column(k), T(0));
+            }
+            mNormal(j, j) *= 1 + mu;
+            vError[j] = std::inner_product(column, column + targets, vTarget.begin(), T(0));
+        }
+        choleskyFactorize((int)xSize, mNormal.data(), (int)mNormal.leadingDimension());
+        choleskySolve((int)xSize, mNormal.data(), (int)mNormal.leadingDimension(), vError.data());
+
+        for (size_t j = 0; j < xSize; j++)
+        {
+            vTrial[j] = xVariable[j] - vError[j];
+        }
+        error = squaredNorm(vError);
+        evaluate(vTrial, vTrialTarget, nullptr);
+        if (squaredNorm(vTrialTarget) < squaredNorm(vTarget))
+        {
+            xVariable.swap(vTrial);
+            mu = std::max(mu / 3, T(1E-12));
+            if (error > tolerance)
+            {
+                evaluate(xVariable, vTarget, &mJacobian);
+                jacobians++;
+            }
+        }
+        else
+        {
+            mu *= 4;
+        }
+
+        if (solverState.verbose)
+        {
+            std::cout << "iteration " << i << ", error value = " << error << ", damping " << mu << "\n";
+        }
+    }
+    return jacobians;
 }
 
+template <typename T>
+int multivariateNewtonRaphson(
+    std::vector<T>& xVariable,
+    std::function<std::vector<T>(std::vector<T>)> objectiveFunction,
+    double tolerance = 1E-16, int maxIterations = 100,
+    ThreadPool* threadPool = nullptr,
+    NewtonMethod method = NEWTON,
+    NewtonState<T>* state = nullptr
+)
+{
+    auto evaluate = [&](std::vector<T>& x, std::vector<T>& target, Matrix<T>* jacobian)
+    {
+        target = objectiveFunction(x);
+        if (jacobian && state && !state->pattern.empty())
+        {
+            computeJacobian<T>(x, objectiveFunction, state->pattern, *jacobian, threadPool);
+        }
+        else if (jacobian)
+        {
+            computeJacobian<T>(x, objectiveFunction, *jacobian, threadPool);
+        }
+    };
+
+    return newtonSolve<T>(xVariable, evaluate, tolerance, maxIterations, method, state);
+}
+
+template <typename T>
+int multivariateNewtonRaphson(
+    std::vector<T>& xVariable,
+    std::function<std::vector<Dual<T>>(std::vector<Dual<T>>)> activeObjectiveFunction,
+    double tolerance = 1E-16, int maxIterations = 100,
+    ThreadPool* threadPool = nullptr,
+    NewtonMethod method = NEWTON,
+    NewtonState<T>* state = nullptr
+)
+{
+    auto evaluate = [&](std::vector<T>& x, std::vector<T>& target, Matrix<T>* jacobian)
+    {
+        if (jacobian && state && !state->pattern.empty())
+        {
+            computeJacobian<T>(x, activeObjectiveFunction, target, state->pattern, *jacobian, threadPool);
+            return;
+        }
+        if (jacobian)
+        {
+            computeJacobian<T>(x, activeObjectiveFunction, target, *jacobian, threadPool);
+            return;
+        }
+        // constants only: no tangent arithmetic, a plain evaluation
+        std::vector<Dual<T>> activeFunction = activeObjectiveFunction(std::vector<Dual<T>>(x.begin(), x.end()));
+        target.resize(activeFunction.size());
+        for (size_t j = 0; j < activeFunction.size(); j++)
+        {
+            target[j] = activeFunction[j].value();
+        }
+    };
+
+    return newtonSolve<T>(xVariable, evaluate, tolerance, maxIterations, method, state);
+}
+
+// one dimensional root search with the exact derivative carried by the active scalar. Returns false when it
+// does not converge, or as soon as the function stops moving with xVariable (a zero derivative), which is
+// then left at its last value instead of being sent to inf or NaN.
+template <typename T>
+bool newtonRaphson(
+    T& xVariable,
+    std::function<Dual<T>(Dual<T>)> activeObjectiveFunction,
+    double tolerance = 1E-16, int maxIterations = 100
+)
+{
+    double error = 1E10;
+
+    for (int i = 0; i < maxIterations && error > tolerance; i++)
+    {
+        Dual<T> target = activeObjectiveFunction(Dual<T>::variable(xVariable, 0));
+        if (target.tangent(0) == T(0))
+        {
+            return false;
+        }
+        T step = target.value() / target.tangent(0);
+
+        xVariable -= step;
+        error = step * step;
+    }
+    return error <= tolerance;
+}
 
 template <typename T, class F>
 T integral(F f, T a, T b, int n = 1E3, bool trapezoidal = false)
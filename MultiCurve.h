@@ -0,0 +1,502 @@
+#pragma once
+
+#include "Pricers.h"
+
+using Time = double;
+using Value = double;
+
+// Joint calibration of a discount curve and of any number of forwarding curves, every curve being stripped
+// from as many instruments as it has pillars. Instead of one Stripper per curve, each against the curves
+// stripped before it, all the pillars are solved by one Newton iteration.
+//
+// The jacobian is only computed, and stored, by blocks: the instruments of curve b against the pillars of the
+// curves they are priced on (t_viCurves of addCurve), so OIS swaps never get columns for the forwarding curves.
+// When every curve only depends on itself and on curves added before it, the jacobian is block lower
+// triangular and the Newton step is a forward substitution over the curves, factorizing the diagonal blocks
+// alone: step_b = J_bb^-1 (F_b - sum over c < b of J_bc step_c), without pivoting for a lower triangular
+// diagonal block (local interpolations). Other dependencies fall back to a dense factorization of the
+// assembled jacobian. Swaps and basis swaps are priced on the curves compiled once per iteration, a row of
+// their block from one reverse sweep (see CompiledStrip), other instruments on active curves.
+class MultiCurveStripper
+{
+public:
+
+	using Active = Dual<Value>;
+
+	MultiCurveStripper() {}
+
+	// Adds curve number size(). t_instruments builds its instruments on the vector of all the curves, plain or
+	// active (a generic lambda, e.g. returning std::vector<SwapOn<decltype(curves[0])>>), and may only use
+	// the curves listed in t_viCurves, the new curve included.
+	template <class Builder>
+	size_t addCurve(std::vector<Time> t_vdMaturities,
+		std::vector<Value> t_vdInterestRates,
+		std::vector<size_t> t_viCurves,
+		Builder t_instruments,
+		InterpolationType t_interpolationMethod = InterpolationType::LINEAR_ON_Y)
+	{
+		size_t index = m_vCurves.size();
+		if (std::find(t_viCurves.begin(), t_viCurves.end(), index) == t_viCurves.end())
+		{
+			t_viCurves.push_back(index);
+		}
+
+		CurveBlock block;
+		block.curves = t_viCurves;
+		block.prices = [t_instruments](std::vector<YieldCurve>& t_vCurves)
+		{
+			return priceVector(t_instruments(t_vCurves));
+		};
+		block.activePrices = [t_instruments](std::vector<BasicYieldCurve<Active>>& t_vCurves)
+		{
+			return priceVector(t_instruments(t_vCurves));
+		};
+		// the prices are affine in the quotes (strikes, spreads): one unit up gives the exact derivative
+		block.quoteDerivatives = [t_instruments](std::vector<YieldCurve>& t_vCurves)
+		{
+			std::vector<Value> derivatives;
+			for (auto const& instrument : t_instruments(t_vCurves))
+			{
+				derivatives.push_back(price(instrument.withStrike(instrument.getStrike() + 1.)) - price(instrument));
+			}
+			return derivatives;
+		};
+		block.setStrip = [t_instruments](std::vector<YieldCurve>& t_vCurves, CompiledStrip& t_strip,
+			std::vector<size_t> const& t_viStripTags, std::vector<size_t> const& t_viPillars)
+		{
+			using Instrument = typename decltype(t_instruments(t_vCurves))::value_type;
+			if constexpr (compiledInstrument<Instrument>)
+			{
+				t_strip.set(t_instruments(t_vCurves), t_viStripTags, t_viPillars);
+				return true;
+			}
+			return false;
+		};
+
+		m_vBlocks.push_back(block);
+		m_vCurves.emplace_back(t_vdMaturities, t_vdInterestRates, t_interpolationMethod);
+		m_vCurves.back().setStripTag(newStripTag());
+		m_viOffsets.push_back(m_viOffsets.back() + t_vdMaturities.size());
+		return index;
+	}
+
+	size_t size() const
+	{
+		return m_vCurves.size();
+	}
+
+	// pillars of all the curves, which are also the instruments: curve c has rows [offset(c), offset(c + 1))
+	size_t unknowns() const
+	{
+		return m_viOffsets.back();
+	}
+	size_t offset(size_t t_iCurve) const
+	{
+		return m_viOffsets[t_iCurve];
+	}
+
+	std::vector<Value> evaluateInstruments(size_t t_iCurve)
+	{
+		return m_vBlocks[t_iCurve].prices(m_vCurves);
+	}
+
+	// Newton iterations on all the pillars until the squared norm of the step is below t_dTolerance, the
+	// instruments built once, again at every calibration as the builders may read quotes that moved.
+	// Returns the number of iterations.
+	int calibrate(double t_dTolerance = 1E-16, int t_iMaxIterations = 100)
+	{
+		size_t unknowns = m_viOffsets.back();
+		std::vector<Value> residuals(unknowns);
+		std::vector<Value> steps(unknowns);
+		bool triangular = blockTriangular();
+		m_bSensitivitiesReady = false;
+		for (CurveBlock& block : m_vBlocks)
+		{
+			block.stripSet = false;
+		}
+
+		double error = 1E10;
+		int i = 0;
+		for (; i < t_iMaxIterations && error > t_dTolerance; i++)
+		{
+			for (size_t b = 0; b < m_vBlocks.size(); b++)
+			{
+				computeBlockJacobian(b, residuals);
+			}
+
+			if (triangular)
+			{
+				forwardSubstitution(residuals, steps);
+			}
+			else
+			{
+				denseSolve(residuals, steps);
+			}
+
+			for (size_t c = 0; c < m_vCurves.size(); c++)
+			{
+				std::vector<Value> interestRates = m_vCurves[c].interestRates();
+				for (size_t k = 0; k < interestRates.size(); k++)
+				{
+					interestRates[k] -= steps[m_viOffsets[c] + k];
+				}
+				m_vCurves[c](m_vCurves[c].maturities(), interestRates, m_vCurves[c].getInterpolationMethod());
+			}
+
+			error = squaredNorm(steps);
+
+			if (m_bVerbose)
+			{
+				std::cout << "iteration " << i << ", error value = " << error << "\n";
+			}
+		}
+		return i;
+	}
+
+	// Sensitivities to the quotes of the instruments, through the calibration. The instruments price to zero,
+	// F(r, q) = 0, so that dr/dq = -J^-1 dF/dq (implicit function theorem) and the gradient g = dV/dr of any
+	// value priced on the curves gives dV/dq = -(J^-T g) dF/dq: one transposed solve on the jacobian at the
+	// solution, a backward substitution over the curves when it is block lower triangular, instead of
+	// recalibrating for every quote. t_gradients holds one gradient per column (unknowns() rows, the pillars of
+	// the curves in order) and receives the sensitivities to the quotes, rows in the order of the instruments.
+	void quoteSensitivities(Matrix<Value>& t_gradients)
+	{
+		prepareSensitivities();
+		bool triangular = blockTriangular();
+		size_t rows = t_gradients.leadingDimension();
+		auto sweep = [&](size_t t_iBegin, size_t t_iEnd)
+		{
+			Value* gradients = t_gradients.column(t_iBegin);
+			int columns = (int)(t_iEnd - t_iBegin);
+			if (triangular)
+			{
+				backwardSubstitution(gradients, columns, rows);
+			}
+			else
+			{
+				luSolveTransposed((int)unknowns(), m_denseJacobian.column(0), (int)m_denseJacobian.leadingDimension(),
+					m_viDensePivots.data(), gradients, columns, (int)rows);
+			}
+			for (int j = 0; j < columns; j++)
+			{
+				Value* adjoint = gradients + j * rows;
+				for (size_t u = 0; u < unknowns(); u++)
+				{
+					adjoint[u] = -adjoint[u] * m_vdQuoteDerivatives[u];
+				}
+			}
+		};
+
+		if (m_pThreadPool)
+		{
+			m_pThreadPool->parallelFor(t_gradients.columns(), sweep, 64);
+		}
+		else
+		{
+			sweep(0, t_gradients.columns());
+		}
+	}
+
+	// jacobian blocks evaluated on the threads of the pool
+	void setThreadPool(ThreadPool& t_threadPool)
+	{
+		m_pThreadPool = &t_threadPool;
+	}
+
+	// iterations of calibrate() printed to std::cout, quiet by default
+	void setVerbose(bool t_bVerbose)
+	{
+		m_bVerbose = t_bVerbose;
+	}
+
+	YieldCurve getZeroCoupon(size_t t_iCurve) const
+	{
+		return m_vCurves[t_iCurve];
+	}
+
+	FrozenYieldCurve getFrozenZeroCoupon(size_t t_iCurve) const
+	{
+		return FrozenYieldCurve(m_vCurves[t_iCurve]);
+	}
+
+private:
+
+	struct CurveBlock
+	{
+		std::vector<size_t> curves; // priced on, the columns of the jacobian block in this order
+		std::function<std::vector<Value>(std::vector<YieldCurve>&)> prices;
+		std::function<std::vector<Active>(std::vector<BasicYieldCurve<Active>>&)> activePrices;
+		std::function<std::vector<Value>(std::vector<YieldCurve>&)> quoteDerivatives;
+		// builds the instruments on the curves into strip, false when they cannot be compiled
+		std::function<bool(std::vector<YieldCurve>&, CompiledStrip&, std::vector<size_t> const&, std::vector<size_t> const&)> setStrip;
+		CompiledStrip strip;
+		bool stripSet = false;
+		bool compiled = false;
+		Matrix<Value> jacobian;
+		std::vector<int> pivots;
+	};
+
+	bool blockTriangular() const
+	{
+		for (size_t b = 0; b < m_vBlocks.size(); b++)
+		{
+			for (size_t c : m_vBlocks[b].curves)
+			{
+				if (c > b)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// first column of curve t_iCurve in the jacobian block of t_block
+	size_t blockColumn(CurveBlock const& t_block, size_t t_iCurve) const
+	{
+		size_t column = 0;
+		for (size_t c : t_block.curves)
+		{
+			if (c == t_iCurve)
+			{
+				break;
+			}
+			column += m_vCurves[c].interestRates().size();
+		}
+		return column;
+	}
+
+	// exact jacobian of the instruments of curve t_iBlock against the pillars of the curves they are priced on,
+	// their prices written in its rows of t_vdResiduals
+	void computeBlockJacobian(size_t t_iBlock, std::vector<Value>& t_vdResiduals)
+	{
+		CurveBlock& block = m_vBlocks[t_iBlock];
+		if (!block.stripSet)
+		{
+			std::vector<size_t> stripTags;
+			std::vector<size_t> pillars;
+			for (size_t c : block.curves)
+			{
+				stripTags.push_back(m_vCurves[c].stripTag());
+				pillars.push_back(m_vCurves[c].maturities().size());
+			}
+			block.compiled = block.setStrip(m_vCurves, block.strip, stripTags, pillars);
+			block.stripSet = true;
+		}
+		if (block.compiled)
+		{
+			for (size_t k = 0; k < block.curves.size(); k++)
+			{
+				YieldCurve const& curve = m_vCurves[block.curves[k]];
+				block.strip.compile(k, curve.maturities(), curve.interestRates(), curve.getInterpolationMethod());
+			}
+			block.strip.evaluate(t_vdResiduals.data() + m_viOffsets[t_iBlock], &block.jacobian, m_pThreadPool);
+			return;
+		}
+
+		std::vector<Value> interestRates;
+		for (size_t c : block.curves)
+		{
+			std::vector<Value> const& curveRates = m_vCurves[c].interestRates();
+			interestRates.insert(interestRates.end(), curveRates.begin(), curveRates.end());
+		}
+
+		std::vector<BasicYieldCurve<Active>> constantCurves(m_vCurves.begin(), m_vCurves.end());
+		std::function<std::vector<Active>(std::vector<Active>)> activeObjectiveFunction =
+			[&](std::vector<Active> t_vInterestRates)
+		{
+			std::vector<BasicYieldCurve<Active>> curves = constantCurves;
+			size_t column = 0;
+			for (size_t c : block.curves)
+			{
+				size_t pillars = m_vCurves[c].interestRates().size();
+				curves[c] = BasicYieldCurve<Active>(m_vCurves[c].maturities(),
+					std::vector<Active>(t_vInterestRates.begin() + column, t_vInterestRates.begin() + column + pillars),
+					m_vCurves[c].getInterpolationMethod());
+				column += pillars;
+			}
+			return block.activePrices(curves);
+		};
+
+		std::vector<Value> prices;
+		computeJacobian<Value>(interestRates, activeObjectiveFunction, prices, block.jacobian, m_pThreadPool);
+		std::copy(prices.begin(), prices.end(), t_vdResiduals.begin() + m_viOffsets[t_iBlock]);
+	}
+
+	// block lower triangular jacobian: the steps of the curves in order, each one from the steps of the
+	// curves it depends on and the LU factors of its diagonal block (factorized in place)
+	void forwardSubstitution(std::vector<Value> const& t_vdResiduals, std::vector<Value>& t_vdSteps)
+	{
+		for (size_t b = 0; b < m_vBlocks.size(); b++)
+		{
+			CurveBlock& block = m_vBlocks[b];
+			size_t pillars = m_vCurves[b].interestRates().size();
+			Value* step = t_vdSteps.data() + m_viOffsets[b];
+			std::copy(t_vdResiduals.begin() + m_viOffsets[b], t_vdResiduals.begin() + m_viOffsets[b + 1], step);
+
+			for (size_t c : block.curves)
+			{
+				if (c == b)
+				{
+					continue;
+				}
+				size_t column = blockColumn(block, c);
+				for (size_t k = 0; k < m_vCurves[c].interestRates().size(); k++)
+				{
+					Value const* derivative = block.jacobian.column(column + k);
+					Value otherStep = t_vdSteps[m_viOffsets[c] + k];
+					for (size_t j = 0; j < pillars; j++)
+					{
+						step[j] -= derivative[j] * otherStep;
+					}
+				}
+			}
+
+			factorizeDiagonal(b);
+			luSolve((int)pillars, block.jacobian.column(blockColumn(block, b)), (int)block.jacobian.leadingDimension(),
+				block.pivots.data(), step);
+		}
+	}
+
+	// LU factors of the diagonal block of curve t_iBlock in place, in O(n^2) without pivoting when its strict
+	// upper triangle is zero, as with local interpolations (the pattern read again from every jacobian)
+	void factorizeDiagonal(size_t t_iBlock)
+	{
+		CurveBlock& block = m_vBlocks[t_iBlock];
+		int pillars = (int)m_vCurves[t_iBlock].interestRates().size();
+		Value* diagonal = block.jacobian.column(blockColumn(block, t_iBlock));
+		int lda = (int)block.jacobian.leadingDimension();
+		block.pivots.resize(pillars);
+
+		bool lowerTriangular = true;
+		for (int k = 1; k < pillars && lowerTriangular; k++)
+		{
+			Value const* column = diagonal + (size_t)k * lda;
+			lowerTriangular = std::all_of(column, column + k, [](Value t_dDerivative) { return t_dDerivative == 0.; });
+		}
+		if (lowerTriangular)
+		{
+			lowerTriangularFactorize(pillars, diagonal, lda, block.pivots.data());
+		}
+		else
+		{
+			luFactorize(pillars, diagonal, lda, block.pivots.data());
+		}
+	}
+
+	// any other dependency: the blocks assembled into the full jacobian
+	void denseSolve(std::vector<Value> const& t_vdResiduals, std::vector<Value>& t_vdSteps)
+	{
+		Matrix<Value> jacobian;
+		assembleJacobian(jacobian);
+
+		t_vdSteps = t_vdResiduals;
+		std::vector<int> pivots;
+		systemSolverInPlace<Value>(jacobian, t_vdSteps, pivots);
+	}
+
+	void assembleJacobian(Matrix<Value>& t_jacobian) const
+	{
+		size_t unknowns = m_viOffsets.back();
+		Matrix<Value> jacobian(unknowns, unknowns, 0.);
+		for (size_t b = 0; b < m_vBlocks.size(); b++)
+		{
+			CurveBlock const& block = m_vBlocks[b];
+			size_t column = 0;
+			for (size_t c : block.curves)
+			{
+				for (size_t k = 0; k < m_vCurves[c].interestRates().size(); k++)
+				{
+					std::copy(block.jacobian.column(column + k), block.jacobian.column(column + k) + block.jacobian.rows(),
+						jacobian.column(m_viOffsets[c] + k) + m_viOffsets[b]);
+				}
+				column += m_vCurves[c].interestRates().size();
+			}
+		}
+		t_jacobian = std::move(jacobian);
+	}
+
+	// jacobian at the calibrated curves, factorized (its diagonal blocks when block lower triangular), and the
+	// derivatives of the instruments to their quotes, kept until the next calibration
+	void prepareSensitivities()
+	{
+		if (m_bSensitivitiesReady)
+		{
+			return;
+		}
+		std::vector<Value> residuals(m_viOffsets.back());
+		m_vdQuoteDerivatives.resize(m_viOffsets.back());
+		for (size_t b = 0; b < m_vBlocks.size(); b++)
+		{
+			computeBlockJacobian(b, residuals);
+			std::vector<Value> derivatives = m_vBlocks[b].quoteDerivatives(m_vCurves);
+			std::copy(derivatives.begin(), derivatives.end(), m_vdQuoteDerivatives.begin() + m_viOffsets[b]);
+		}
+
+		if (blockTriangular())
+		{
+			for (size_t b = 0; b < m_vBlocks.size(); b++)
+			{
+				factorizeDiagonal(b);
+			}
+		}
+		else
+		{
+			assembleJacobian(m_denseJacobian);
+			m_viDensePivots.resize(m_viOffsets.back());
+			luFactorize((int)m_viOffsets.back(), m_denseJacobian.column(0), (int)m_denseJacobian.leadingDimension(),
+				m_viDensePivots.data());
+		}
+		m_bSensitivitiesReady = true;
+	}
+
+	// transpose of forwardSubstitution on t_iColumns gradients: the curves in reverse order, each one taking the
+	// adjoints of the curves depending on it before the transposed solve on its diagonal block
+	void backwardSubstitution(Value* t_vdGradients, int t_iColumns, size_t t_iLeadingDimension) const
+	{
+		for (size_t b = m_vBlocks.size(); b-- > 0;)
+		{
+			size_t pillars = m_vCurves[b].interestRates().size();
+			for (size_t c = b + 1; c < m_vBlocks.size(); c++)
+			{
+				CurveBlock const& dependent = m_vBlocks[c];
+				if (std::find(dependent.curves.begin(), dependent.curves.end(), b) == dependent.curves.end())
+				{
+					continue;
+				}
+				size_t column = blockColumn(dependent, b);
+				size_t dependentPillars = m_vCurves[c].interestRates().size();
+				for (int j = 0; j < t_iColumns; j++)
+				{
+					Value* gradient = t_vdGradients + j * t_iLeadingDimension;
+					Value const* adjoint = gradient + m_viOffsets[c];
+					for (size_t k = 0; k < pillars; k++)
+					{
+						Value const* derivative = dependent.jacobian.column(column + k);
+						Value sum = 0.;
+						for (size_t i = 0; i < dependentPillars; i++)
+						{
+							sum += derivative[i] * adjoint[i];
+						}
+						gradient[m_viOffsets[b] + k] -= sum;
+					}
+				}
+			}
+
+			CurveBlock const& block = m_vBlocks[b];
+			luSolveTransposed((int)pillars, block.jacobian.column(blockColumn(block, b)), (int)block.jacobian.leadingDimension(),
+				block.pivots.data(), t_vdGradients + m_viOffsets[b], t_iColumns, (int)t_iLeadingDimension);
+		}
+	}
+
+	std::vector<YieldCurve> m_vCurves;
+	std::vector<CurveBlock> m_vBlocks;
+	std::vector<size_t> m_viOffsets{ 0 }; // first unknown of every curve, then the number of unknowns
+	ThreadPool* m_pThreadPool = nullptr;
+	bool m_bVerbose = false;
+
+	bool m_bSensitivitiesReady = false;
+	std::vector<Value> m_vdQuoteDerivatives;
+	Matrix<Value> m_denseJacobian;
+	std::vector<int> m_viDensePivots;
+};
@@ -6,39 +6,387 @@
 using Time = double;
 using Value = double;
 
-Value price(YieldCurve zcInstrument, Time t_dPricingDate = 0.) {
+template <typename T>
+T price(BasicYieldCurve<T> const& zcInstrument, Time t_dPricingDate = 0.) {
 
-	std::vector<Time> maturities = zcInstrument.getMaturities();
-	std::vector<Value> interest_rates = zcInstrument.getInterestRates();
+	std::vector<Time> const& maturities = zcInstrument.maturities();
+	std::vector<T> const& interest_rates = zcInstrument.interestRates();
 	InterpolationType interpolation_method = zcInstrument.getInterpolationMethod();
 
-	Value interest_rate = interpolate(t_dPricingDate, maturities, interest_rates, interpolation_method);
+	T interest_rate = interpolate<T, Time>(t_dPricingDate, maturities, interest_rates, interpolation_method);
 
 	return exp(-interest_rate * t_dPricingDate);
 }
-Value price(Swap swapInstrument, Time t_dPricingDate = 0.)
+
+Value price(FrozenYieldCurve const& zcInstrument, Time t_dPricingDate = 0.)
 {
-	std::unordered_map<std::string, Swap::Parameter>  parameters = swapInstrument.getParameters();
-	long notional = std::get<long>(parameters["notional"]);
-	Value swap_strike = std::get<double>(parameters["strike"]);
-	SwapType swap_type = std::get<SwapType>(parameters["swap_type"]);
-	YieldCurve zc_instrument = std::get<YieldCurve>(parameters["zero_coupon"]);
-	YieldCurve forward_instrument = std::get<YieldCurve>(parameters["forward_curve"]);
-	std::vector<Time> payment_dates = std::get<std::vector<Time>>(parameters["payment_dates"]);
-	
-	std::vector<Time> deltas(1);//(payment_dates.size());
-	deltas[0] = payment_dates[1] - payment_dates[0];
-	//std::adjacent_difference(payment_dates.begin(), payment_dates.end(), deltas);
+	return zcInstrument.discount(t_dPricingDate);
+}
+
+// scratch space for the swap pricers, owned by the caller and reused from one call to the next
+struct SwapPricingBuffers
+{
+	std::vector<Value> zeroCouponPrices;
+	std::vector<Value> forwardPrices;
+	std::vector<Value> cashFlows;
+};
+
+// swap on compiled curves: one batched discount evaluation per leg over the remaining payment dates.
+// Reads the payment dates and accruals of its schedule in place and prices into t_buffers, no heap allocation
+// once they are large enough.
+// The segment tables may point into any storage, a FrozenYieldCurve or a mapped snapshot file.
+Value price(Swap const& swapInstrument, SegmentTable const& zcCurve, SegmentTable const& forwardCurve, Time t_dPricingDate, SwapPricingBuffers& t_buffers)
+{
+	std::vector<Time> const& payment_dates = swapInstrument.getPaymentDates();
+	Time const* accruals = swapInstrument.getAccruals().data();
+
+	// same aging rule as price(Swap): the first remaining payment date replaces the start date,
+	// so an aged swap starts with an empty period on that date
+	size_t first = std::lower_bound(payment_dates.begin(), payment_dates.end(), t_dPricingDate) - payment_dates.begin();
+	if (first == payment_dates.size())
+	{
+		return 0.;
+	}
+
+	size_t size = payment_dates.size() - first;
+	t_buffers.zeroCouponPrices.resize(size);
+	t_buffers.forwardPrices.resize(size);
+	Value* vdZeroCouponPrice = t_buffers.zeroCouponPrices.data();
+	Value* vdForwardPrice = t_buffers.forwardPrices.data();
+	discountBatch(zcCurve, payment_dates.data() + first, vdZeroCouponPrice, size, true);
+	discountBatch(forwardCurve, payment_dates.data() + first, vdForwardPrice, size, true);
+
+	Value dStrike = swapInstrument.getStrike();
+	Value dPreviousForwardPrice = vdForwardPrice[0];
+	Value m_dAnnuity = 0.;
+	for (size_t i = first == 0 ? 1 : 0; i < size; i++)
+	{
+		// period first + i - 1 ends on the i-th remaining payment date
+		Time delta = accruals[first + i - 1];
+		Value dForwardRate = (dPreviousForwardPrice / vdForwardPrice[i] - 1) / delta;
+		m_dAnnuity += delta * vdZeroCouponPrice[i] * (dForwardRate - dStrike);
+		dPreviousForwardPrice = vdForwardPrice[i];
+	}
+
+	long notional = swapInstrument.getNotional();
+	return swapInstrument.getSwapType() == PAYER ? notional * m_dAnnuity : -notional * m_dAnnuity;
+}
+
+// adjoint of discountOnSegment: adds t_dDiscountBar dP(t)/dr to t_vdRateBar, the gradient against the rates of
+// the pillars of the curve. The node value on a segment is linear in the node values of its two pillars (the
+// flat extrapolations in the one pillar they start from), and every node value a function of its own rate.
+inline void discountAdjoint(SegmentTable const& table, Time t, Value t_dDiscountBar, Value* t_vdRateBar)
+{
+	size_t segment = segmentOf(table, t);
+	Value value = table.segmentValue[segment] + table.segmentSlope[segment] * (t - table.segmentStart[segment]);
+
+	// dP / dvalue
+	Value valueBar = 0.;
+	switch (table.interpolationMethod)
+	{
+	case LINEAR_ON_Y:
+		valueBar = -t * exp(-value * t);
+		break;
+	case LOGLINEAR_ON_Y:
+		valueBar = -t * exp(value) * exp(-exp(value) * t);
+		break;
+	case LINEAR_ON_EXP_X_TIMES_Y:
+		valueBar = t > 0 ? 1. : 0.;
+		break;
+	case LOGLINEAR_ON_EXP_X_TIMES_Y:
+		valueBar = t > 0 ? exp(value) : 0.;
+		break;
+	}
+	valueBar *= t_dDiscountBar;
+
+	// pillar k has node value segmentValue[k + 1]
+	auto addPillar = [&](size_t k, Value t_dWeight)
+	{
+		Value nodeValue = table.segmentValue[k + 1];
+		Value maturity = table.maturities[k];
+		Value nodeDerivative = 1.;
+		switch (table.interpolationMethod)
+		{
+		case LINEAR_ON_Y:
+			nodeDerivative = 1.;
+			break;
+		case LOGLINEAR_ON_Y:
+			nodeDerivative = exp(-nodeValue);
+			break;
+		case LINEAR_ON_EXP_X_TIMES_Y:
+			nodeDerivative = -maturity * nodeValue;
+			break;
+		case LOGLINEAR_ON_EXP_X_TIMES_Y:
+			nodeDerivative = -maturity;
+			break;
+		}
+		t_vdRateBar[k] += valueBar * t_dWeight * nodeDerivative;
+	};
+
+	if (segment == 0)
+	{
+		addPillar(0, 1.);
+	}
+	else if (segment == table.pillars)
+	{
+		addPillar(table.pillars - 1, 1.);
+	}
+	else
+	{
+		Time weight = (t - table.maturities[segment - 1]) / (table.maturities[segment] - table.maturities[segment - 1]);
+		addPillar(segment - 1, 1. - weight);
+		addPillar(segment, weight);
+	}
+}
+
+// Reverse sweep of price(Swap, SegmentTable, SegmentTable, t, buffers): adds t_dPriceBar times the gradient of the
+// price against the pillars of the discount and forwarding curves to t_vdZeroCouponBar and t_vdForwardBar (the
+// same array when both legs are on one curve). Returns the price. Every period is
+// Z_i (F_{i-1} / F_i - 1) - delta_i K Z_i, with Z and F the discount factors of the two curves on its end date.
+inline Value priceAdjoint(Swap const& swapInstrument, SegmentTable const& zcCurve, SegmentTable const& forwardCurve,
+	Time t_dPricingDate, Value t_dPriceBar, Value* t_vdZeroCouponBar, Value* t_vdForwardBar, SwapPricingBuffers& t_buffers)
+{
+	std::vector<Time> const& payment_dates = swapInstrument.getPaymentDates();
+	Time const* accruals = swapInstrument.getAccruals().data();
+
+	size_t first = std::lower_bound(payment_dates.begin(), payment_dates.end(), t_dPricingDate) - payment_dates.begin();
+	if (first == payment_dates.size())
+	{
+		return 0.;
+	}
+
+	size_t size = payment_dates.size() - first;
+	t_buffers.zeroCouponPrices.resize(size);
+	t_buffers.forwardPrices.resize(size);
+	t_buffers.cashFlows.assign(2 * size, 0.);
+	Value* vdZeroCouponPrice = t_buffers.zeroCouponPrices.data();
+	Value* vdForwardPrice = t_buffers.forwardPrices.data();
+	Value* vdZeroCouponPriceBar = t_buffers.cashFlows.data();
+	Value* vdForwardPriceBar = vdZeroCouponPriceBar + size;
+	discountBatch(zcCurve, payment_dates.data() + first, vdZeroCouponPrice, size, true);
+	discountBatch(forwardCurve, payment_dates.data() + first, vdForwardPrice, size, true);
+
+	long notional = swapInstrument.getNotional();
+	Value sign = swapInstrument.getSwapType() == PAYER ? notional : -notional;
+	Value dStrike = swapInstrument.getStrike();
+	Value m_dAnnuity = 0.;
+	for (size_t i = first == 0 ? 1 : 0; i < size; i++)
+	{
+		// the period running over the pricing date of an aged swap starts and ends on the same forward price
+		size_t previous = i == 0 ? 0 : i - 1;
+		Time delta = accruals[first + i - 1];
+		Value growth = vdForwardPrice[previous] / vdForwardPrice[i];
+		m_dAnnuity += vdZeroCouponPrice[i] * (growth - 1) - delta * dStrike * vdZeroCouponPrice[i];
+
+		Value cashFlowBar = sign * t_dPriceBar;
+		vdZeroCouponPriceBar[i] += cashFlowBar * (growth - 1 - delta * dStrike);
+		vdForwardPriceBar[previous] += cashFlowBar * vdZeroCouponPrice[i] / vdForwardPrice[i];
+		vdForwardPriceBar[i] -= cashFlowBar * vdZeroCouponPrice[i] * growth / vdForwardPrice[i];
+	}
+
+	for (size_t i = 0; i < size; i++)
+	{
+		if (vdZeroCouponPriceBar[i] != 0.)
+		{
+			discountAdjoint(zcCurve, payment_dates[first + i], vdZeroCouponPriceBar[i], t_vdZeroCouponBar);
+		}
+		if (vdForwardPriceBar[i] != 0.)
+		{
+			discountAdjoint(forwardCurve, payment_dates[first + i], vdForwardPriceBar[i], t_vdForwardBar);
+		}
+	}
+	return sign * m_dAnnuity;
+}
+
+Value price(Swap const& swapInstrument, FrozenYieldCurve const& zcCurve, FrozenYieldCurve const& forwardCurve, Time t_dPricingDate, SwapPricingBuffers& t_buffers)
+{
+	return price(swapInstrument, zcCurve.table(), forwardCurve.table(), t_dPricingDate, t_buffers);
+}
+
+Value price(Swap const& swapInstrument, FrozenYieldCurve const& zcCurve, FrozenYieldCurve const& forwardCurve, Time t_dPricingDate = 0.)
+{
+	thread_local SwapPricingBuffers buffers;
+	return price(swapInstrument, zcCurve, forwardCurve, t_dPricingDate, buffers);
+}
+
+// discounted cash flow of periods [t_begin, t_end) of a book, from the discount factors of both curves on its date grid.
+// Same aging rule as price(Swap): periods paid before the pricing date are dropped and the period running
+// over it keeps an empty forward. Runs 8 or 4 periods at a time when built for AVX-512 or AVX2.
+inline void periodCashFlows(SwapPortfolio const& portfolio, Value const* t_vdZeroCouponPrice, Value const* t_vdForwardPrice,
+	Time t_dPricingDate, Value* out, size_t t_begin, size_t t_end)
+{
+	// dates are compared to the pricing date through their position on the sorted date grid
+	std::vector<Time> const& dates = portfolio.dates();
+	unsigned int firstDate = (unsigned int)(std::lower_bound(dates.begin(), dates.end(), t_dPricingDate) - dates.begin());
+
+	Time const* vdAccrual = portfolio.periodAccrual().data();
+	Value const* vdStrike = portfolio.periodStrike().data();
+	unsigned int const* viStartDate = portfolio.periodStartDate().data();
+	unsigned int const* viEndDate = portfolio.periodEndDate().data();
+	size_t n = t_end;
+	size_t i = t_begin;
+
+#if defined(__AVX512F__)
+	__m512i first = _mm512_set1_epi64(firstDate);
+	__m512d one = _mm512_set1_pd(1.);
+	for (; i + 8 <= n; i += 8)
+	{
+		__m512i startDate = _mm512_cvtepu32_epi64(_mm256_loadu_si256((__m256i const*)(viStartDate + i)));
+		__m512i endDate = _mm512_cvtepu32_epi64(_mm256_loadu_si256((__m256i const*)(viEndDate + i)));
+		__m512d accrual = _mm512_loadu_pd(vdAccrual + i);
+		__m512d forwardStart = _mm512_i64gather_pd(startDate, t_vdForwardPrice, 8);
+		__m512d forwardEnd = _mm512_i64gather_pd(endDate, t_vdForwardPrice, 8);
+		__m512d zeroCoupon = _mm512_i64gather_pd(endDate, t_vdZeroCouponPrice, 8);
+
+		__mmask8 started = _mm512_cmpge_epi64_mask(startDate, first);
+		__mmask8 paid = _mm512_cmpge_epi64_mask(endDate, first);
+		__m512d forwardRate = _mm512_maskz_div_pd(started, _mm512_sub_pd(_mm512_div_pd(forwardStart, forwardEnd), one), accrual);
+		__m512d cashFlow = _mm512_mul_pd(_mm512_mul_pd(accrual, zeroCoupon), _mm512_sub_pd(forwardRate, _mm512_loadu_pd(vdStrike + i)));
+		_mm512_storeu_pd(out + i, _mm512_maskz_mov_pd(paid, cashFlow));
+	}
+#elif defined(__AVX2__)
+	__m128i beforeFirst = _mm_set1_epi32((int)firstDate - 1);
+	__m256d one = _mm256_set1_pd(1.);
+	for (; i + 4 <= n; i += 4)
+	{
+		__m128i startDate = _mm_loadu_si128((__m128i const*)(viStartDate + i));
+		__m128i endDate = _mm_loadu_si128((__m128i const*)(viEndDate + i));
+		__m256d accrual = _mm256_loadu_pd(vdAccrual + i);
+		__m256d forwardStart = _mm256_i32gather_pd(t_vdForwardPrice, startDate, 8);
+		__m256d forwardEnd = _mm256_i32gather_pd(t_vdForwardPrice, endDate, 8);
+		__m256d zeroCoupon = _mm256_i32gather_pd(t_vdZeroCouponPrice, endDate, 8);
+
+		__m256d started = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmpgt_epi32(startDate, beforeFirst)));
+		__m256d paid = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmpgt_epi32(endDate, beforeFirst)));
+		__m256d forwardRate = _mm256_and_pd(started, _mm256_div_pd(_mm256_sub_pd(_mm256_div_pd(forwardStart, forwardEnd), one), accrual));
+		__m256d cashFlow = _mm256_mul_pd(_mm256_mul_pd(accrual, zeroCoupon), _mm256_sub_pd(forwardRate, _mm256_loadu_pd(vdStrike + i)));
+		_mm256_storeu_pd(out + i, _mm256_and_pd(paid, cashFlow));
+	}
+#endif
+
+	for (; i < n; i++)
+	{
+		Value dForwardRate = viStartDate[i] >= firstDate
+			? (t_vdForwardPrice[viStartDate[i]] / t_vdForwardPrice[viEndDate[i]] - 1) / vdAccrual[i]
+			: 0.;
+		out[i] = viEndDate[i] >= firstDate
+			? vdAccrual[i] * t_vdZeroCouponPrice[viEndDate[i]] * (dForwardRate - vdStrike[i])
+			: 0.;
+	}
+}
+
+// whole book on shared compiled curves: one batched discount evaluation per curve over the date grid of the
+// book, then one pass over the flattened periods (see periodCashFlows), written to out (one price per swap).
+// With a pool the pass is shared out by blocks of swaps.
+void price(SwapPortfolio const& portfolio, FrozenYieldCurve const& zcCurve, FrozenYieldCurve const& forwardCurve,
+	Time t_dPricingDate, Value* out, SwapPricingBuffers& t_buffers, ThreadPool* t_pThreadPool = nullptr)
+{
+	std::vector<Time> const& dates = portfolio.dates();
+	t_buffers.zeroCouponPrices.resize(dates.size());
+	t_buffers.cashFlows.resize(portfolio.periods());
+	Value* vdZeroCouponPrice = t_buffers.zeroCouponPrices.data();
+	Value* vdForwardPrice = vdZeroCouponPrice;
+	zcCurve.discount(dates.data(), vdZeroCouponPrice, dates.size(), true);
+	if (&forwardCurve != &zcCurve)
+	{
+		t_buffers.forwardPrices.resize(dates.size());
+		vdForwardPrice = t_buffers.forwardPrices.data();
+		forwardCurve.discount(dates.data(), vdForwardPrice, dates.size(), true);
+	}
+
+	Value* vdCashFlow = t_buffers.cashFlows.data();
+	std::vector<size_t> const& offsets = portfolio.periodOffsets();
+	auto priceSwaps = [&](size_t begin, size_t end)
+	{
+		periodCashFlows(portfolio, vdZeroCouponPrice, vdForwardPrice, t_dPricingDate, vdCashFlow, offsets[begin], offsets[end]);
+
+		for (size_t i = begin; i < end; i++)
+		{
+			Value m_dAnnuity = 0.;
+			for (size_t j = offsets[i]; j < offsets[i + 1]; j++)
+			{
+				m_dAnnuity += vdCashFlow[j];
+			}
+			long notional = portfolio.notionals()[i];
+			out[i] = portfolio.swapTypes()[i] == PAYER ? notional * m_dAnnuity : -notional * m_dAnnuity;
+		}
+	};
+
+	if (t_pThreadPool)
+	{
+		t_pThreadPool->parallelFor(portfolio.size(), priceSwaps, 256);
+	}
+	else
+	{
+		priceSwaps(0, portfolio.size());
+	}
+}
+
+std::vector<Value> priceVector(SwapPortfolio const& portfolio, FrozenYieldCurve const& zcCurve, FrozenYieldCurve const& forwardCurve,
+	Time pricingDate = 0.)
+{
+	thread_local SwapPricingBuffers buffers;
+	std::vector<Value> priceVect(portfolio.size());
+	price(portfolio, zcCurve, forwardCurve, pricingDate, priceVect.data(), buffers);
+	return priceVect;
+}
+
+std::vector<Value> priceVector(SwapPortfolio const& portfolio, FrozenYieldCurve const& zcCurve, FrozenYieldCurve const& forwardCurve,
+	Time pricingDate, ThreadPool& threadPool)
+{
+	thread_local SwapPricingBuffers buffers;
+	std::vector<Value> priceVect(portfolio.size());
+	price(portfolio, zcCurve, forwardCurve, pricingDate, priceVect.data(), buffers, &threadPool);
+	return priceVect;
+}
+
+template <typename T>
+T price(BasicSwap<T> const& swapInstrument, Time t_dPricingDate = 0.)
+{
+	if constexpr (std::is_same_v<T, Value>)
+	{
+		// plain curves are compiled into per-thread storage rather than re-interpolated at every payment date,
+		// recompiling in place keeps the call free of heap allocation once warm, and the instruments of a
+		// strip priced one after the other on the same curve compile it once
+		thread_local FrozenYieldCurve zcCurve;
+		thread_local FrozenYieldCurve forwardCurve;
+		if (!zcCurve.compiledFrom(swapInstrument.getZeroCoupon()))
+		{
+			zcCurve.compile(swapInstrument.getZeroCoupon());
+		}
+		if (swapInstrument.getForwardCurve() == swapInstrument.getZeroCoupon())
+		{
+			return price(swapInstrument, zcCurve, zcCurve, t_dPricingDate);
+		}
+		if (!forwardCurve.compiledFrom(swapInstrument.getForwardCurve()))
+		{
+			forwardCurve.compile(swapInstrument.getForwardCurve());
+		}
+		return price(swapInstrument, zcCurve, forwardCurve, t_dPricingDate);
+	}
+
+	long notional = swapInstrument.getNotional();
+	Value swap_strike = swapInstrument.getStrike();
+	SwapType swap_type = swapInstrument.getSwapType();
+	BasicYieldCurve<T> const& zc_instrument = swapInstrument.getZeroCoupon();
+	BasicYieldCurve<T> const& forward_instrument = swapInstrument.getForwardCurve();
+	std::vector<Time> payment_dates = swapInstrument.getPaymentDates();
+	std::vector<Time> const& accruals = swapInstrument.getAccruals();
 
 	// overwriting the start_date if the pricing_date comes later
 	auto itStartDate = std::lower_bound(
 		payment_dates.begin(),
 		payment_dates.end(),
 		t_dPricingDate);
-	if (itStartDate != payment_dates.end())
+	if (itStartDate == payment_dates.end())
 	{
-		payment_dates.front() = *itStartDate;
+		return T(0.);
 	}
+	payment_dates.front() = *itStartDate;
+
+	// accruals of the remaining periods, an aged swap starting with the period running over the pricing date
+	size_t first = itStartDate - payment_dates.begin();
+	std::vector<Time> deltas(accruals.begin() + (first == 0 ? 0 : first - 1), accruals.end());
 
 	// also need to consider the case where payments where already made
 	std::vector<Time> vdPricingDates;
@@ -54,7 +402,7 @@ Value price(Swap swapInstrument, Time t_dPricingDate = 0.)
 	payment_dates = vdPricingDates;
 
 	// compute the zero coupon prices
-	std::vector<Value> vdZeroCouponPrice;
+	std::vector<T> vdZeroCouponPrice;
 
 	// compute the zero coupon prices and forward curve prices
 	std::transform(
@@ -63,48 +411,37 @@ Value price(Swap swapInstrument, Time t_dPricingDate = 0.)
 		std::back_inserter(vdZeroCouponPrice),
 		[&](Time t) { return price(zc_instrument, t); });
 
-	std::vector<Value> vdForwardPrice;
+	std::vector<T> vdForwardPrice;
 	std::transform(
 		payment_dates.begin(),
 		payment_dates.end(),
 		std::back_inserter(vdForwardPrice),
 		[&](Time t) { return price(forward_instrument, t); });
 	
-	// compute the forward rates
-	std::vector<Value> vdForwardRates;
-	std::transform(
-		vdForwardPrice.begin(),
-		vdForwardPrice.end() - 1,
-		vdForwardPrice.begin() + 1,
-		std::back_inserter(vdForwardRates),
-		[&](const Value& P1, const Value& P2)
-		{
-			return (P1 / P2 - 1) / deltas.front();
-		});
-
-
-	// compute the vector to cumulate
-	std::vector<Value> vdDiscountedCashFlow;
-	std::transform(
-		vdZeroCouponPrice.begin() + 1,
-		vdZeroCouponPrice.end(),
-		vdForwardRates.begin(),
-		std::back_inserter(vdDiscountedCashFlow),
-		[&](const Value& dZeroCoupon, const Value& dForwardRate)
-		{
-			return deltas.front() * dZeroCoupon * (dForwardRate - swap_strike);
-		});
+	// compute the forward rates and the vector to cumulate, period by period on its own accrual
+	std::vector<T> vdDiscountedCashFlow;
+	for (size_t i = 0; i + 1 < vdForwardPrice.size(); i++)
+	{
+		T dForwardRate = (vdForwardPrice[i] / vdForwardPrice[i + 1] - 1) / deltas[i];
+		vdDiscountedCashFlow.push_back(deltas[i] * vdZeroCouponPrice[i + 1] * (dForwardRate - swap_strike));
+	}
 
 
 	// compute the annuity
-	Value m_dAnnuity = std::accumulate(
+	T m_dAnnuity = std::accumulate(
 		vdDiscountedCashFlow.begin(),
-		vdDiscountedCashFlow.end(), 0.);
+		vdDiscountedCashFlow.end(), T(0.));
 
 	return swap_type == PAYER ? notional * m_dAnnuity : -notional * m_dAnnuity;
 
 }
 
+template <typename T>
+T price(BasicBasisSwap<T> const& basisSwapInstrument, Time t_dPricingDate = 0.)
+{
+	return price(basisSwapInstrument.getFirstLeg(), t_dPricingDate) - price(basisSwapInstrument.getSecondLeg(), t_dPricingDate);
+}
+
 template <class Instrument>
 Value price(Instrument instrument, Time pricingDate = 0.)
 {
@@ -112,21 +449,211 @@ Value price(Instrument instrument, Time pricingDate = 0.)
 }
 
 template <class Instrument>
-std::vector<Value> priceVector(std::vector<Instrument> instruments, Time pricingDate = 0.)
+std::vector<typename Instrument::value_type> priceVector(std::vector<Instrument> const& instruments, Time pricingDate = 0.)
 {
-	std::vector<Value> priceVect;
+	std::vector<typename Instrument::value_type> priceVect;
 	for (auto const& instrument : instruments)
 	{
-		priceVect.push_back(price<Instrument>(instrument, pricingDate));
+		priceVect.push_back(price(instrument, pricingDate));
 	}
 	return priceVect;
 }
 
+// instruments shared out between the threads of the pool, prices in the order of the instruments
+template <class Instrument>
+std::vector<typename Instrument::value_type> priceVector(std::vector<Instrument> const& instruments, Time pricingDate,
+	ThreadPool& threadPool)
+{
+	std::vector<typename Instrument::value_type> priceVect(instruments.size());
+	threadPool.parallelFor(instruments.size(), [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			priceVect[i] = price(instruments[i], pricingDate);
+		}
+	});
+	return priceVect;
+}
+
+// Instruments of a calibration priced on compiled curves. They are built once: their legs on the curves solved
+// for, told by their strip tag, are priced on these curves compiled once per evaluation (compile), the legs on
+// any other curve on a copy compiled once when the instruments are set. Every price goes through the batched
+// swap pricer, and a jacobian row is one reverse sweep of it (priceAdjoint): the exact derivatives against
+// all the pillars at the cost of about two pricings, whatever their number. Swaps and basis swaps, the latter
+// priced as the difference of their legs.
+class CompiledStrip
+{
+public:
+
+	// t_viStripTags: the curves solved for, of t_viPillars pillars, in the order of their columns in a jacobian row
+	template <class Instrument>
+	void set(std::vector<Instrument> const& t_vInstruments, std::vector<size_t> const& t_viStripTags,
+		std::vector<size_t> const& t_viPillars)
+	{
+		m_iSolvedCurves = t_viStripTags.size();
+		m_vCurves.assign(m_iSolvedCurves, FrozenYieldCurve());
+		m_viOffsets.assign(1, 0);
+		for (size_t pillars : t_viPillars)
+		{
+			m_viOffsets.push_back(m_viOffsets.back() + pillars);
+		}
+
+		auto curveIndex = [&](YieldCurve const& t_curve)
+		{
+			size_t solved = std::find(t_viStripTags.begin(), t_viStripTags.end(), t_curve.stripTag()) - t_viStripTags.begin();
+			if (t_curve.stripTag() != 0 && solved < m_iSolvedCurves)
+			{
+				return solved;
+			}
+			for (size_t c = m_iSolvedCurves; c < m_vCurves.size(); c++)
+			{
+				if (m_vCurves[c].compiledFrom(t_curve))
+				{
+					return c;
+				}
+			}
+			m_vCurves.emplace_back(t_curve);
+			m_viOffsets.push_back(m_viOffsets.back() + t_curve.maturities().size());
+			return m_vCurves.size() - 1;
+		};
+
+		m_vLegs.clear();
+		m_viLegOffsets.assign(1, 0);
+		for (Instrument const& instrument : t_vInstruments)
+		{
+			forEachLeg(instrument, [&](Swap const& t_leg, Value t_dSign)
+			{
+				m_vLegs.push_back(Leg{ t_leg, t_dSign, curveIndex(t_leg.getZeroCoupon()), curveIndex(t_leg.getForwardCurve()) });
+			});
+			m_viLegOffsets.push_back(m_vLegs.size());
+		}
+	}
+
+	size_t instruments() const
+	{
+		return m_viLegOffsets.size() - 1;
+	}
+
+	// columns of a jacobian row, the pillars of the curves solved for
+	size_t columns() const
+	{
+		return m_viOffsets[m_iSolvedCurves];
+	}
+
+	// quote of instrument t_iInstrument moved, without building it again: the strike of a swap, the spread of a
+	// basis swap, that is minus the strike of its first leg (see BasicBasisSwap::withStrike)
+	template <class Instrument>
+	void requote(size_t t_iInstrument, Value t_dQuote)
+	{
+		Leg& leg = m_vLegs[m_viLegOffsets[t_iInstrument]];
+		leg.swap = leg.swap.withStrike(std::is_same_v<Instrument, BasisSwap> ? -t_dQuote : t_dQuote);
+	}
+
+	// curve t_iCurve solved for, at new rates: no allocation once compiled on as many pillars
+	void compile(size_t t_iCurve, std::vector<Time> const& t_vdMaturities, std::vector<Value> const& t_vdInterestRates,
+		InterpolationType t_interpolationMethod)
+	{
+		m_vCurves[t_iCurve].compile(t_vdMaturities, t_vdInterestRates, t_interpolationMethod);
+	}
+
+	// prices of the instruments to t_vdPrices and, when t_pJacobian is not null, their jacobian against the
+	// pillars of the curves solved for. With a pool the instruments are shared out between its threads.
+	void evaluate(Value* t_vdPrices, Matrix<Value>* t_pJacobian, ThreadPool* t_pThreadPool = nullptr, Time t_dPricingDate = 0.)
+	{
+		if (t_pJacobian)
+		{
+			t_pJacobian->resize(instruments(), columns());
+		}
+
+		auto sweep = [&](size_t t_iBegin, size_t t_iEnd, SwapPricingBuffers& t_buffers, std::vector<Value>& t_vdGradient)
+		{
+			t_vdGradient.resize(t_pJacobian ? m_viOffsets.back() : 0);
+			for (size_t i = t_iBegin; i < t_iEnd; i++)
+			{
+				std::fill(t_vdGradient.begin(), t_vdGradient.end(), 0.);
+				Value value = 0.;
+				for (size_t l = m_viLegOffsets[i]; l < m_viLegOffsets[i + 1]; l++)
+				{
+					Leg const& leg = m_vLegs[l];
+					SegmentTable discountCurve = m_vCurves[leg.discountCurve].table();
+					SegmentTable forwardCurve = m_vCurves[leg.forwardCurve].table();
+					value += leg.sign * (t_pJacobian
+						? priceAdjoint(leg.swap, discountCurve, forwardCurve, t_dPricingDate, leg.sign,
+							t_vdGradient.data() + m_viOffsets[leg.discountCurve], t_vdGradient.data() + m_viOffsets[leg.forwardCurve], t_buffers)
+						: price(leg.swap, discountCurve, forwardCurve, t_dPricingDate, t_buffers));
+				}
+				t_vdPrices[i] = value;
+				for (size_t k = 0; t_pJacobian && k < columns(); k++)
+				{
+					(*t_pJacobian)(i, k) = t_vdGradient[k];
+				}
+			}
+		};
+
+		if (t_pThreadPool)
+		{
+			t_pThreadPool->parallelFor(instruments(), [&](size_t t_iBegin, size_t t_iEnd)
+			{
+				SwapPricingBuffers buffers;
+				std::vector<Value> gradient;
+				sweep(t_iBegin, t_iEnd, buffers, gradient);
+			});
+		}
+		else
+		{
+			sweep(0, instruments(), m_buffers, m_vdGradient);
+		}
+	}
+
+private:
+
+	struct Leg
+	{
+		Swap swap;
+		Value sign;
+		size_t discountCurve; // in m_vCurves
+		size_t forwardCurve;
+	};
+
+	template <class F>
+	static void forEachLeg(Swap const& t_swap, F t_f)
+	{
+		t_f(t_swap, 1.);
+	}
+	template <class F>
+	static void forEachLeg(BasisSwap const& t_swap, F t_f)
+	{
+		t_f(t_swap.getFirstLeg(), 1.);
+		t_f(t_swap.getSecondLeg(), -1.);
+	}
+
+	size_t m_iSolvedCurves = 0;
+	std::vector<FrozenYieldCurve> m_vCurves; // the curves solved for, then the other ones
+	std::vector<size_t> m_viOffsets{ 0 };    // of the pillars of every curve in a gradient over all of them
+	std::vector<Leg> m_vLegs;
+	std::vector<size_t> m_viLegOffsets{ 0 }; // legs of instrument i are [m_viLegOffsets[i], m_viLegOffsets[i + 1])
+	SwapPricingBuffers m_buffers;
+	std::vector<Value> m_vdGradient;
+};
+
+// instruments the strips price on compiled curves (see CompiledStrip), the other ones on their own curves
+template <class Instrument>
+constexpr bool compiledInstrument = std::is_same_v<Instrument, Swap> || std::is_same_v<Instrument, BasisSwap>;
+
+enum CalibrationMethod
+{
+	NEWTON_RAPHSON,      //= all pillars solved at once against all instruments (see setNewtonMethod)
+	SEQUENTIAL_BOOTSTRAP //= one pillar at a time, instrument i only depending on pillars 0..i (local interpolation)
+};
+
 template <class Instrument>
 class Stripper
 {
 public:
 
+	using Active = Dual<Value>;
+	using ActiveInstrument = typename Instrument::template rebind<Active>;
+
 	Stripper() {}
 	Stripper(std::vector<Time> t_vdMaturities,
 		std::vector<Value> t_vdInterestRates,
@@ -134,47 +661,433 @@ public:
 		InterpolationType t_interpolationMethod = InterpolationType::LINEAR_ON_Y)
 		: m_vdMaturities(t_vdMaturities),
 		m_vdInterestRates(t_vdInterestRates),
-		m_instruments(t_instruments),
 		m_interpolationMethod(t_interpolationMethod),
-		m_ZeroCoupon(t_vdMaturities, t_vdInterestRates, t_interpolationMethod)
-	{}
+		m_ZeroCoupon(t_vdMaturities, t_vdInterestRates, t_interpolationMethod),
+		m_instruments(t_instruments)
+	{
+		m_ZeroCoupon.setStripTag(newStripTag());
+	}
+
+	// builders written for any curve type (e.g. a generic lambda returning std::vector<SwapOn<decltype(curve)>>)
+	// are also instantiated on active curves, which gives calibrate() an exact jacobian instead of bumping
+	template <class Builder, typename = std::enable_if_t<std::is_invocable_v<Builder&, BasicYieldCurve<Active>&>>>
+	Stripper(std::vector<Time> t_vdMaturities,
+		std::vector<Value> t_vdInterestRates,
+		Builder t_instruments,
+		InterpolationType t_interpolationMethod = InterpolationType::LINEAR_ON_Y)
+		: m_vdMaturities(t_vdMaturities),
+		m_vdInterestRates(t_vdInterestRates),
+		m_interpolationMethod(t_interpolationMethod),
+		m_ZeroCoupon(t_vdMaturities, t_vdInterestRates, t_interpolationMethod),
+		m_instruments(t_instruments),
+		m_activeInstruments(t_instruments)
+	{
+		m_ZeroCoupon.setStripTag(newStripTag());
+	}
 
 	std::vector<Value> evaluateInstruments()
 	{
-		std::vector<Instrument> swapInstruments = m_instruments(m_ZeroCoupon);
+		std::vector<Instrument> swapInstruments = quotedInstruments(m_instruments, m_ZeroCoupon);
 		std::vector<Value> swapPrices = priceVector<Instrument>(swapInstruments);
 		
 		return swapPrices;
 	}
 
-	void calibrate()
+	std::vector<Active> evaluateActiveInstruments(std::vector<Active> const& t_vInterestRates)
+	{
+		BasicYieldCurve<Active> activeCurve(m_vdMaturities, t_vInterestRates, m_interpolationMethod);
+		std::vector<ActiveInstrument> swapInstruments = quotedInstruments(m_activeInstruments, activeCurve);
+
+		return priceVector<ActiveInstrument>(swapInstruments);
+	}
+
+	// The instruments are built again: a builder may read quotes that moved since the last calibration.
+	void calibrate(CalibrationMethod t_calibrationMethod = CalibrationMethod::NEWTON_RAPHSON)
 	{
-		auto objectiveFunction = [&](std::vector<Value> t_vdInterestRates)
+		m_calibrationMethod = t_calibrationMethod;
+		m_bCalibrated = true;
+		m_bStripSet = false;
+
+		if (t_calibrationMethod == SEQUENTIAL_BOOTSTRAP)
 		{
-			m_ZeroCoupon(m_vdMaturities, t_vdInterestRates);
-			std::vector<Value> priceVector = evaluateInstruments();
-			return priceVector;
-		};
+			bootstrap();
+			return;
+		}
+
+		m_newtonState.verbose = m_bVerbose;
+		solve(m_newtonMethod);
+	}
+
+	// Moves the quotes (strikes) of the instruments given by their index and strips the curve again from the
+	// current one, quietly. After a bootstrap only the pillars whose instrument was requoted, or depends on a
+	// pillar solved again, are solved again: the dependencies are read once from the jacobian of the strip.
+	// After a Newton calibration, BROYDEN iterations start from the factors of the last jacobian.
+	// Returns false, without moving any quote, when an index is not the one of an instrument.
+	bool recalibrate(std::vector<std::pair<size_t, Value>> const& t_vQuoteUpdates)
+	{
+		for (auto const& quote : t_vQuoteUpdates)
+		{
+			if (quote.first >= m_vdMaturities.size())
+			{
+				return false;
+			}
+		}
+		for (auto const& quote : t_vQuoteUpdates)
+		{
+			m_quotes[quote.first] = quote.second;
+			if constexpr (compiledInstrument<Instrument>)
+			{
+				if (m_bStripSet)
+				{
+					m_strip.requote<Instrument>(quote.first, quote.second);
+				}
+			}
+		}
+
+		if (!m_bCalibrated)
+		{
+			calibrate();
+			return true;
+		}
+
+		if (m_calibrationMethod == NEWTON_RAPHSON)
+		{
+			m_newtonState.verbose = false;
+			solve(BROYDEN);
+			return true;
+		}
+
+		if (m_vDependents.empty())
+		{
+			computeDependents();
+		}
+
+		std::vector<char> affected(m_vdMaturities.size(), 0);
+		for (auto const& quote : t_vQuoteUpdates)
+		{
+			affected[quote.first] = 1;
+		}
+
+		m_ZeroCoupon(m_vdMaturities, m_vdInterestRates, m_interpolationMethod);
+		std::vector<Instrument> instruments = quotedInstruments(m_instruments, m_ZeroCoupon);
+
+		for (size_t i = 0; i < m_vdMaturities.size(); i++)
+		{
+			if (!affected[i])
+			{
+				continue;
+			}
+			if (!resolvePillar(i, instruments[i]))
+			{
+				bootstrapPillar(i, instruments[i]);
+			}
+			for (size_t dependent : m_vDependents[i])
+			{
+				affected[dependent] = 1;
+			}
+		}
+
+		m_ZeroCoupon(m_vdMaturities, m_vdInterestRates, m_interpolationMethod);
+		return true;
+	}
+
+	// jacobian columns of calibrate() evaluated on the threads of the pool
+	void setThreadPool(ThreadPool& t_threadPool)
+	{
+		m_pThreadPool = &t_threadPool;
+	}
+
+	// iterations of calibrate(NEWTON_RAPHSON), and the pillars a bootstrap could not solve, printed to
+	// std::cout, the default
+	void setVerbose(bool t_bVerbose)
+	{
+		m_bVerbose = t_bVerbose;
+	}
+
+	// iterations of calibrate(NEWTON_RAPHSON): BROYDEN when recalibrating from a nearby curve (one jacobian),
+	// LEVENBERG_MARQUARDT from a poor initial guess
+	void setNewtonMethod(NewtonMethod t_newtonMethod)
+	{
+		m_newtonMethod = t_newtonMethod;
+	}
+
+	// jacobians of calibrate(NEWTON_RAPHSON) computed on a sparsity pattern, by default the one of the first
+	// jacobian: one bump (or tangent) per colour of columns, and without pivoting when lower triangular, as
+	// with local interpolations
+	void setSparseJacobian(JacobianPattern t_pattern = JacobianPattern())
+	{
+		m_newtonState.pattern = t_pattern;
+		m_newtonState.detectPattern = true;
+	}
+
+	// pillar i is solved with pillars 0..i-1 already stripped: the instruments are built once and only
+	// instrument i is repriced, on its legs that were built on the stripped curve (the ones carrying its
+	// strip tag, whatever the content of the other ones)
+	void bootstrap()
+	{
+		m_ZeroCoupon(m_vdMaturities, m_vdInterestRates, m_interpolationMethod);
+		std::vector<Instrument> instruments = quotedInstruments(m_instruments, m_ZeroCoupon);
 
-		multivariateNewtonRaphson<Value>(
-			m_vdInterestRates,
-			objectiveFunction);
+		for (size_t i = 0; i < m_vdMaturities.size(); i++)
+		{
+			if (!bootstrapPillar(i, instruments[i]) && m_bVerbose)
+			{
+				std::cout << "pillar " << i << " not solved: instrument " << i << " does not depend on it or does not converge\n";
+			}
+		}
 
+		m_ZeroCoupon(m_vdMaturities, m_vdInterestRates, m_interpolationMethod);
 	}
 
 	YieldCurve getZeroCoupon()
 	{
-		m_ZeroCoupon(m_vdMaturities, m_vdInterestRates);
+		m_ZeroCoupon(m_vdMaturities, m_vdInterestRates, m_interpolationMethod);
 		return m_ZeroCoupon;
 	}
 
+	FrozenYieldCurve getFrozenZeroCoupon()
+	{
+		return FrozenYieldCurve(getZeroCoupon());
+	}
+
 private:
 
+	// instruments of the builder with the quotes moved by recalibrate()
+	template <class Builder, class Curve>
+	auto quotedInstruments(Builder const& t_builder, Curve& t_curve) const
+	{
+		auto instruments = t_builder(t_curve);
+		for (auto const& quote : m_quotes)
+		{
+			instruments[quote.first] = instruments[quote.first].withStrike(quote.second);
+		}
+		return instruments;
+	}
+
+	// all pillars solved at once, the factors of the last jacobian kept in m_newtonState. The residuals of swaps
+	// are priced on the curve compiled once (compiledPrices), of other instruments on plain curves; only the
+	// jacobians need the reverse sweeps, the active instruments or the bumps.
+	void solve(NewtonMethod t_newtonMethod)
+	{
+		std::function<std::vector<Value>(std::vector<Value>)> objectiveFunction = plainObjectiveFunction();
+		std::function<std::vector<Active>(std::vector<Active>)> activeObjectiveFunction =
+			[&](std::vector<Active> t_vInterestRates)
+		{
+			return evaluateActiveInstruments(t_vInterestRates);
+		};
+
+		auto evaluate = [&](std::vector<Value>& t_vdRates, std::vector<Value>& t_vdTarget, Matrix<Value>* t_pJacobian)
+		{
+			JacobianPattern const& pattern = m_newtonState.pattern;
+			if (!t_pJacobian && compiledPrices(t_vdRates, t_vdTarget))
+			{
+			}
+			else if (!t_pJacobian)
+			{
+				t_vdTarget = objectiveFunction(t_vdRates);
+			}
+			else if (compiledJacobian(t_vdRates, t_vdTarget, *t_pJacobian))
+			{
+				// every row from one reverse sweep, the pattern only serves the factorization
+			}
+			else if (m_activeInstruments && !pattern.empty())
+			{
+				computeJacobian<Value>(t_vdRates, activeObjectiveFunction, t_vdTarget, pattern, *t_pJacobian, m_pThreadPool);
+			}
+			else if (m_activeInstruments)
+			{
+				computeJacobian<Value>(t_vdRates, activeObjectiveFunction, t_vdTarget, *t_pJacobian, m_pThreadPool);
+			}
+			else if (!pattern.empty())
+			{
+				t_vdTarget = objectiveFunction(t_vdRates);
+				computeJacobian<Value>(t_vdRates, objectiveFunction, pattern, *t_pJacobian, m_pThreadPool);
+			}
+			else
+			{
+				t_vdTarget = objectiveFunction(t_vdRates);
+				computeJacobian<Value>(t_vdRates, objectiveFunction, *t_pJacobian, m_pThreadPool);
+			}
+		};
+
+		newtonSolve<Value>(m_vdInterestRates, evaluate, 1E-16, 100, t_newtonMethod, &m_newtonState);
+
+		m_ZeroCoupon(m_vdMaturities, m_vdInterestRates, m_interpolationMethod);
+	}
+
+	// the instruments built once per calibrate() on the curve being stripped, the first time they are priced on
+	// it compiled, then requoted by recalibrate()
+	void setCompiledStrip()
+	{
+		if constexpr (compiledInstrument<Instrument>)
+		{
+			if (!m_bStripSet)
+			{
+				m_strip.set(quotedInstruments(m_instruments, m_ZeroCoupon), { m_ZeroCoupon.stripTag() }, { m_vdMaturities.size() });
+				m_bStripSet = true;
+			}
+		}
+	}
+
+	// Exact jacobian at t_vdRates of swaps from a generic builder, and their prices to t_vdTarget: the curve
+	// compiled once and every row from one reverse sweep of the pricer (see CompiledStrip), instead of the
+	// tangents of the active instruments. False, without evaluating, for other instruments or builders.
+	bool compiledJacobian(std::vector<Value> const& t_vdRates, std::vector<Value>& t_vdTarget, Matrix<Value>& t_jacobian)
+	{
+		if constexpr (compiledInstrument<Instrument>)
+		{
+			if (m_activeInstruments)
+			{
+				setCompiledStrip();
+				m_strip.compile(0, m_vdMaturities, t_vdRates, m_interpolationMethod);
+				t_vdTarget.resize(m_strip.instruments());
+				m_strip.evaluate(t_vdTarget.data(), &t_jacobian, m_pThreadPool);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Prices at t_vdRates of swaps from any builder, on the curve compiled once (see CompiledStrip), for the
+	// residuals of the Newton iterations. False, without evaluating, for other instruments.
+	bool compiledPrices(std::vector<Value> const& t_vdRates, std::vector<Value>& t_vdTarget)
+	{
+		if constexpr (compiledInstrument<Instrument>)
+		{
+			setCompiledStrip();
+			m_strip.compile(0, m_vdMaturities, t_vdRates, m_interpolationMethod);
+			t_vdTarget.resize(m_strip.instruments());
+			m_strip.evaluate(t_vdTarget.data(), nullptr);
+			return true;
+		}
+		return false;
+	}
+
+	// priced on a curve of its own so that the bumped columns can be evaluated concurrently
+	std::function<std::vector<Value>(std::vector<Value>)> plainObjectiveFunction()
+	{
+		return [this](std::vector<Value> t_vdInterestRates)
+		{
+			YieldCurve zeroCoupon(m_vdMaturities, t_vdInterestRates, m_interpolationMethod);
+			return priceVector<Instrument>(quotedInstruments(m_instruments, zeroCoupon));
+		};
+	}
+
+	// m_vDependents[k]: the instruments after k whose price moves with pillar k, m_vdSlopes[k] the derivative
+	// of instrument k with respect to pillar k
+	void computeDependents()
+	{
+		Matrix<Value> jacobian;
+		std::vector<Value> prices;
+		if (compiledJacobian(m_vdInterestRates, prices, jacobian))
+		{
+		}
+		else if (m_activeInstruments)
+		{
+			std::function<std::vector<Active>(std::vector<Active>)> activeObjectiveFunction =
+				[&](std::vector<Active> t_vInterestRates)
+			{
+				return evaluateActiveInstruments(t_vInterestRates);
+			};
+			std::vector<Value> swapPrices;
+			computeJacobian<Value>(m_vdInterestRates, activeObjectiveFunction, swapPrices, jacobian, m_pThreadPool);
+		}
+		else
+		{
+			computeJacobian<Value>(m_vdInterestRates, plainObjectiveFunction(), jacobian, m_pThreadPool);
+		}
+
+		m_vDependents.assign(m_vdMaturities.size(), {});
+		m_vdSlopes.resize(m_vdMaturities.size());
+		for (size_t k = 0; k < m_vdMaturities.size(); k++)
+		{
+			m_vdSlopes[k] = jacobian(k, k);
+			for (size_t j = k + 1; j < jacobian.rows(); j++)
+			{
+				if (jacobian(j, k) != 0.)
+				{
+					m_vDependents[k].push_back(j);
+				}
+			}
+		}
+	}
+
+	// Warm start of a pillar from its previous value: chord iterations on plain prices with the slope of the
+	// strip, each one a single repricing. False when they do not converge, the pillar is left where it was.
+	bool resolvePillar(size_t t_index, Instrument const& t_instrument)
+	{
+		bool strippedDiscount = t_instrument.getZeroCoupon().stripTag() == m_ZeroCoupon.stripTag();
+		bool strippedForward = t_instrument.getForwardCurve().stripTag() == m_ZeroCoupon.stripTag();
+		std::vector<Time> maturities(m_vdMaturities.begin(), m_vdMaturities.begin() + t_index + 1);
+		std::vector<Value> interestRates(m_vdInterestRates.begin(), m_vdInterestRates.begin() + t_index + 1);
+		Value slope = m_vdSlopes[t_index];
+		if (slope == 0.)
+		{
+			return false;
+		}
+
+		// convergence is only linear: one more step after the tolerance of newtonRaphson is reached
+		bool converged = false;
+		for (int i = 0; i < 10; i++)
+		{
+			YieldCurve curve(maturities, interestRates, m_interpolationMethod);
+			Value step = price(t_instrument.withCurves(
+				strippedDiscount ? curve : t_instrument.getZeroCoupon(),
+				strippedForward ? curve : t_instrument.getForwardCurve())) / slope;
+			interestRates.back() -= step;
+			if (converged)
+			{
+				m_vdInterestRates[t_index] = interestRates.back();
+				return true;
+			}
+			converged = step * step <= 1E-16;
+		}
+		return false;
+	}
+
+	// false when the instrument does not depend on its pillar, which is left where it was
+	bool bootstrapPillar(size_t t_index, Instrument const& t_instrument)
+	{
+		bool strippedDiscount = t_instrument.getZeroCoupon().stripTag() == m_ZeroCoupon.stripTag();
+		bool strippedForward = t_instrument.getForwardCurve().stripTag() == m_ZeroCoupon.stripTag();
+		BasicYieldCurve<Active> discountCurve(t_instrument.getZeroCoupon());
+		BasicYieldCurve<Active> forwardCurve(t_instrument.getForwardCurve());
+
+		// instrument t_index only sees the pillars up to its own
+		std::vector<Time> maturities(m_vdMaturities.begin(), m_vdMaturities.begin() + t_index + 1);
+		std::vector<Active> interestRates(m_vdInterestRates.begin(), m_vdInterestRates.begin() + t_index + 1);
+
+		std::function<Active(Active)> pillarFunction = [&](Active t_rate)
+		{
+			interestRates.back() = t_rate;
+			BasicYieldCurve<Active> activeCurve(maturities, interestRates, m_interpolationMethod);
+
+			return price(t_instrument.withCurves(
+				strippedDiscount ? activeCurve : discountCurve,
+				strippedForward ? activeCurve : forwardCurve));
+		};
+
+		return newtonRaphson<Value>(m_vdInterestRates[t_index], pillarFunction);
+	}
+
 	std::vector<Time> m_vdMaturities{};
 	std::vector<Value> m_vdInterestRates{};
 	InterpolationType m_interpolationMethod;
 
 	YieldCurve m_ZeroCoupon;
 	std::function<std::vector<Instrument>(YieldCurve&)> m_instruments;
+	std::function<std::vector<ActiveInstrument>(BasicYieldCurve<Active>&)> m_activeInstruments;
+	ThreadPool* m_pThreadPool = nullptr;
+	NewtonMethod m_newtonMethod = NEWTON;
+	bool m_bVerbose = true;
 
-};
+	std::unordered_map<size_t, Value> m_quotes;             // instrument index -> quote set by recalibrate()
+	CalibrationMethod m_calibrationMethod = NEWTON_RAPHSON; // of the last calibrate()
+	bool m_bCalibrated = false;
+	NewtonState<Value> m_newtonState;
+	CompiledStrip m_strip;
+	bool m_bStripSet = false; // m_strip built, kept on the quotes by recalibrate()
+	std::vector<std::vector<size_t>> m_vDependents;
+	std::vector<Value> m_vdSlopes;
+
+};
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <iomanip>
 #include <vector>
 
+#include "LinearAlgebra.h"
+
 template <typename T>
 void myPrinter(
 	std::vector<T> const& inputVector,
@@ -34,4 +36,24 @@ void myPrinter(
 		myPrinter(inputMatrix[i], "", preview);
 
 	}
-}
\ No newline at end of file
+}
+
+template <typename T>
+void myPrinter(
+	Matrix<T> const& inputMatrix,
+	std::string title = "Matrix values:",
+	size_t preview = 10
+)
+{
+	size_t rowIndex = std::min(preview, inputMatrix.rows());
+	size_t columnIndex = std::min(preview, inputMatrix.columns());
+	std::cout << "\n" << title << "\n";
+	for (size_t i = 0; i < rowIndex; i++)
+	{
+		for (size_t j = 0; j < columnIndex; j++)
+		{
+			std::cout << std::setw(10) << inputMatrix(i, j) << " " << std::fixed;
+		}
+		std::cout << "\n";
+	}
+}
@@ -0,0 +1,337 @@
+#pragma once
+
+#include <charconv>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using Time = double;
+using Value = double;
+
+// quotes of one curve on one date, in file order
+struct CurveQuotes
+{
+	std::string curve;
+	std::vector<Time> maturities;
+	std::vector<Value> quotes;
+};
+
+struct QuoteDate
+{
+	int date = 0;                    // yyyymmdd
+	std::vector<CurveQuotes> curves; // only the first curveCount are filled, the others keep their storage
+	size_t curveCount = 0;
+
+	CurveQuotes const* find(std::string_view t_curve) const
+	{
+		for (size_t c = 0; c < curveCount; c++)
+		{
+			if (curves[c].curve == t_curve)
+			{
+				return &curves[c];
+			}
+		}
+		return nullptr;
+	}
+};
+
+// Streaming reader of quote files of one row per date and instrument:
+//   date,curve,maturity,quote
+//   20150102,EUR-OIS,0.0194444,-0.00069
+// dates as yyyymmdd, maturities in years, quotes as decimals. The rows of one date are contiguous; a first
+// line that does not start with a digit (a header), blank lines and lines starting with '#' are skipped.
+// The file is read by blocks into a fixed buffer and the fields are parsed in place with std::from_chars, so
+// that once the QuoteDate filled by next() has grown to the largest date, reading allocates nothing.
+class QuoteReader
+{
+public:
+	static constexpr size_t bufferSize = 1 << 20;
+
+	QuoteReader() {}
+	QuoteReader(QuoteReader const&) = delete;
+	QuoteReader& operator=(QuoteReader const&) = delete;
+	~QuoteReader()
+	{
+		close();
+	}
+
+	bool open(std::string const& t_path)
+	{
+		close();
+		m_pFile = std::fopen(t_path.c_str(), "rb");
+		m_vBuffer.resize(bufferSize);
+		m_iBegin = m_iEnd = 0;
+		m_iLine = 0;
+		m_bFailed = false;
+		m_bPending = false;
+		return m_pFile != nullptr;
+	}
+
+	void close()
+	{
+		if (m_pFile)
+		{
+			std::fclose(m_pFile);
+			m_pFile = nullptr;
+		}
+	}
+
+	// Fills t_quotes with the next date. False at the end of the file or on a malformed row (failed()).
+	bool next(QuoteDate& t_quotes)
+	{
+		t_quotes.curveCount = 0;
+		t_quotes.date = 0;
+		if (m_bPending)
+		{
+			m_bPending = false;
+			t_quotes.date = m_pending.date;
+			add(t_quotes, m_pending.curve, m_pending.maturity, m_pending.quote);
+		}
+
+		std::string_view line;
+		while (!m_bFailed && readLine(line))
+		{
+			Row row;
+			if (!parse(line, row))
+			{
+				continue;
+			}
+			if (t_quotes.date != 0 && row.date != t_quotes.date)
+			{
+				m_pending = row;
+				m_bPending = true;
+				return true;
+			}
+			t_quotes.date = row.date;
+			add(t_quotes, row.curve, row.maturity, row.quote);
+		}
+		return !m_bFailed && t_quotes.date != 0;
+	}
+
+	bool failed() const
+	{
+		return m_bFailed;
+	}
+	// line number of the last line read, the malformed one when failed()
+	size_t line() const
+	{
+		return m_iLine;
+	}
+
+private:
+	struct Row
+	{
+		int date = 0;
+		std::string_view curve;
+		Time maturity = 0.;
+		Value quote = 0.;
+	};
+
+	// next line of the file without its end of line, valid until the next call
+	bool readLine(std::string_view& t_line)
+	{
+		for (;;)
+		{
+			char const* begin = m_vBuffer.data() + m_iBegin;
+			char const* end = m_vBuffer.data() + m_iEnd;
+			char const* newline = static_cast<char const*>(std::memchr(begin, '\n', end - begin));
+			if (newline || (!m_pFile && begin != end))
+			{
+				char const* lineEnd = newline ? newline : end;
+				m_iBegin = newline ? newline + 1 - m_vBuffer.data() : m_iEnd;
+				if (lineEnd != begin && lineEnd[-1] == '\r')
+				{
+					lineEnd--;
+				}
+				t_line = std::string_view(begin, lineEnd - begin);
+				m_iLine++;
+				return true;
+			}
+			if (!m_pFile)
+			{
+				return false;
+			}
+
+			// the partial line moves to the front and the rest of the buffer is refilled
+			size_t partial = m_iEnd - m_iBegin;
+			if (partial == m_vBuffer.size())
+			{
+				m_bFailed = true;
+				return false;
+			}
+			std::memmove(m_vBuffer.data(), m_vBuffer.data() + m_iBegin, partial);
+			m_iBegin = 0;
+			m_iEnd = partial + std::fread(m_vBuffer.data() + partial, 1, m_vBuffer.size() - partial, m_pFile);
+			if (m_iEnd == partial)
+			{
+				close();
+			}
+		}
+	}
+
+	// false on lines to skip, sets failed() on malformed rows
+	bool parse(std::string_view t_line, Row& t_row)
+	{
+		if (t_line.empty() || t_line.front() == '#')
+		{
+			return false;
+		}
+		if (t_line.front() < '0' || t_line.front() > '9')
+		{
+			m_bFailed = m_iLine != 1;
+			return false;
+		}
+
+		std::string_view fields[4];
+		size_t field = 0;
+		size_t start = 0;
+		for (size_t i = 0; i <= t_line.size() && field < 4; i++)
+		{
+			if (i == t_line.size() || t_line[i] == ',')
+			{
+				fields[field++] = t_line.substr(start, i - start);
+				start = i + 1;
+			}
+		}
+
+		bool valid = field == 4 && !fields[1].empty()
+			&& std::from_chars(fields[0].data(), fields[0].data() + fields[0].size(), t_row.date).ec == std::errc()
+			&& std::from_chars(fields[2].data(), fields[2].data() + fields[2].size(), t_row.maturity).ec == std::errc()
+			&& std::from_chars(fields[3].data(), fields[3].data() + fields[3].size(), t_row.quote).ec == std::errc();
+		t_row.curve = fields[1];
+		m_bFailed = !valid;
+		return valid;
+	}
+
+	static void add(QuoteDate& t_quotes, std::string_view t_curve, Time t_maturity, Value t_quote)
+	{
+		size_t c = 0;
+		while (c < t_quotes.curveCount && t_quotes.curves[c].curve != t_curve)
+		{
+			c++;
+		}
+		if (c == t_quotes.curveCount)
+		{
+			if (c == t_quotes.curves.size())
+			{
+				t_quotes.curves.emplace_back();
+			}
+			CurveQuotes& curve = t_quotes.curves[c];
+			curve.curve.assign(t_curve);
+			curve.maturities.clear();
+			curve.quotes.clear();
+			t_quotes.curveCount++;
+		}
+		t_quotes.curves[c].maturities.push_back(t_maturity);
+		t_quotes.curves[c].quotes.push_back(t_quote);
+	}
+
+	std::FILE* m_pFile = nullptr;
+	std::vector<char> m_vBuffer;
+	size_t m_iBegin = 0;
+	size_t m_iEnd = 0;
+	size_t m_iLine = 0;
+	bool m_bFailed = false;
+
+	// first row of the next date, its curve still pointing into the buffer: next() takes it over before
+	// reading any line
+	Row m_pending;
+	bool m_bPending = false;
+};
+
+// Reads t_path on a thread of its own, at most t_iDepth dates ahead of the consumer, and hands every date to
+// t_onDate in file order on the calling thread, so that parsing overlaps the calibrations. The QuoteDate
+// buffers circulate between the two threads and are reused. Returns the number of dates, or -1 when the file
+// cannot be opened or has a malformed row (t_pErrorLine then receives its line number).
+inline long streamQuotes(std::string const& t_path, std::function<void(QuoteDate const&)> t_onDate,
+	size_t t_iDepth = 4, size_t* t_pErrorLine = nullptr)
+{
+	QuoteReader reader;
+	if (!reader.open(t_path))
+	{
+		return -1;
+	}
+
+	std::vector<QuoteDate> buffers(t_iDepth + 1);
+	std::deque<QuoteDate*> free;
+	std::deque<QuoteDate*> full;
+	for (QuoteDate& buffer : buffers)
+	{
+		free.push_back(&buffer);
+	}
+	std::mutex mutex;
+	std::condition_variable changed;
+	bool done = false;
+
+	std::thread producer([&]
+	{
+		for (;;)
+		{
+			QuoteDate* buffer;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [&] { return !free.empty(); });
+				buffer = free.front();
+				free.pop_front();
+			}
+			bool read = reader.next(*buffer);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (read)
+				{
+					full.push_back(buffer);
+				}
+				else
+				{
+					done = true;
+				}
+			}
+			changed.notify_all();
+			if (!read)
+			{
+				return;
+			}
+		}
+	});
+
+	long dates = 0;
+	for (;;)
+	{
+		QuoteDate* buffer;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [&] { return !full.empty() || done; });
+			if (full.empty())
+			{
+				break;
+			}
+			buffer = full.front();
+			full.pop_front();
+		}
+		t_onDate(*buffer);
+		dates++;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			free.push_back(buffer);
+		}
+		changed.notify_all();
+	}
+	producer.join();
+
+	if (reader.failed())
+	{
+		if (t_pErrorLine)
+		{
+			*t_pErrorLine = reader.line();
+		}
+		return -1;
+	}
+	return dates;
+}
@@ -0,0 +1,386 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "SobolDirections.h"
+
+using Time = double;
+using Value = double;
+
+// Acklam's rational approximation of the inverse normal cumulative distribution (relative error 1.2E-9),
+// over a batch: a first branch-free pass of the central rational function, which vectorizes and covers 95%
+// of the draws, then the tails patched in a second pass
+inline void inverseNormalBatch(Value const* t_vdUniforms, Value* out, size_t t_iSize)
+{
+	constexpr Value a0 = -3.969683028665376e+01, a1 = 2.209460984245205e+02, a2 = -2.759285104469687e+02,
+		a3 = 1.383577518672690e+02, a4 = -3.066479806614716e+01, a5 = 2.506628277459239e+00;
+	constexpr Value b0 = -5.447609879822406e+01, b1 = 1.615858368580409e+02, b2 = -1.556989798598866e+02,
+		b3 = 6.680131188771972e+01, b4 = -1.328068155288572e+01;
+	constexpr Value c0 = -7.784894002430293e-03, c1 = -3.223964580411365e-01, c2 = -2.400758277161838e+00,
+		c3 = -2.549732539343734e+00, c4 = 4.374664141464968e+00, c5 = 2.938163982698783e+00;
+	constexpr Value d0 = 7.784695709041462e-03, d1 = 3.224671290700398e-01, d2 = 2.445134137142996e+00,
+		d3 = 3.754408661907416e+00;
+	constexpr Value tail = 0.02425;
+
+	// chunks, so that out may be the input
+	constexpr size_t chunk = 64;
+	Value uniforms[chunk];
+	for (size_t begin = 0; begin < t_iSize; begin += chunk)
+	{
+		size_t size = std::min(chunk, t_iSize - begin);
+		std::copy(t_vdUniforms + begin, t_vdUniforms + begin + size, uniforms);
+		for (size_t i = 0; i < size; i++)
+		{
+			Value q = uniforms[i] - 0.5;
+			Value r = q * q;
+			out[begin + i] = (((((a0 * r + a1) * r + a2) * r + a3) * r + a4) * r + a5) * q
+				/ (((((b0 * r + b1) * r + b2) * r + b3) * r + b4) * r + 1.);
+		}
+		for (size_t i = 0; i < size; i++)
+		{
+			Value u = uniforms[i];
+			if (u < tail || u > 1. - tail)
+			{
+				Value q = sqrt(-2. * log(u < tail ? u : 1. - u));
+				Value x = (((((c0 * q + c1) * q + c2) * q + c3) * q + c4) * q + c5)
+					/ ((((d0 * q + d1) * q + d2) * q + d3) * q + 1.);
+				out[begin + i] = u < tail ? x : -x;
+			}
+		}
+	}
+}
+
+// Philox4x32-10 counter based generator (Salmon, Moraes, Dror, Shaw 2011): the random words are a keyed
+// bijection of a counter, so any draw of any stream is computed directly, without state nor lock. A Monte
+// Carlo path is a stream, draw i of path p is the same whichever thread computes it and whatever the batches.
+class Philox
+{
+public:
+	explicit Philox(unsigned long long t_iSeed = 42)
+		: m_iKey0((uint32_t)t_iSeed),
+		m_iKey1((uint32_t)(t_iSeed >> 32))
+	{}
+
+	// 4 random words of counter (c0, c1, c2, c3)
+	void block(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, uint32_t out[4]) const
+	{
+		uint32_t k0 = m_iKey0;
+		uint32_t k1 = m_iKey1;
+		for (int round = 0; round < 10; round++)
+		{
+			uint64_t product0 = (uint64_t)0xD2511F53u * c0;
+			uint64_t product1 = (uint64_t)0xCD9E8D57u * c2;
+			uint32_t next0 = (uint32_t)(product1 >> 32) ^ c1 ^ k0;
+			uint32_t next2 = (uint32_t)(product0 >> 32) ^ c3 ^ k1;
+			c0 = next0;
+			c1 = (uint32_t)product1;
+			c2 = next2;
+			c3 = (uint32_t)product0;
+			k0 += 0x9E3779B9u;
+			k1 += 0xBB67AE85u;
+		}
+		out[0] = c0;
+		out[1] = c1;
+		out[2] = c2;
+		out[3] = c3;
+	}
+
+	// draws [t_iFirst, t_iFirst + t_iSize) of stream t_iStream, uniform in (0, 1) with 53 bits: one counter
+	// (draw / 2, stream) gives draws 2i and 2i + 1
+	void uniforms(unsigned long long t_iStream, unsigned long long t_iFirst, Value* out, size_t t_iSize) const
+	{
+		uint32_t words[4];
+		for (size_t i = 0; i < t_iSize; i++)
+		{
+			unsigned long long draw = t_iFirst + i;
+			if (i == 0 || draw % 2 == 0)
+			{
+				unsigned long long counter = draw / 2;
+				block((uint32_t)counter, (uint32_t)(counter >> 32), (uint32_t)t_iStream, (uint32_t)(t_iStream >> 32), words);
+			}
+			uint64_t word = ((uint64_t)words[2 * (draw % 2) + 1] << 32) | words[2 * (draw % 2)];
+			out[i] = ((word >> 11) + 0.5) * 0x1p-53;
+		}
+	}
+
+	// standard normal draws, one per uniform so that draw i stays draw i
+	void normals(unsigned long long t_iStream, unsigned long long t_iFirst, Value* out, size_t t_iSize) const
+	{
+		uniforms(t_iStream, t_iFirst, out, t_iSize);
+		inverseNormalBatch(out, out, t_iSize);
+	}
+
+private:
+	uint32_t m_iKey0;
+	uint32_t m_iKey1;
+};
+
+// Sobol low discrepancy sequence in gray code order with 32 bits per coordinate. The first dimension is the
+// van der Corput sequence, the next ones use primitive polynomials by increasing degree, with the initial
+// direction numbers of Joe and Kuo up to degree 13 (joeKuoDimensions, two factors on 555 dates) and fixed
+// pseudo random odd ones past it. Point n is skipped to directly from the gray code of n, the next point is
+// one xor per dimension.
+// With a seed the coordinates are xored with a random digital shift per dimension (drawn from Philox): every
+// point stays uniform, the estimates are unbiased and independent seeds give an error estimate.
+class Sobol
+{
+public:
+	explicit Sobol(size_t t_iDimensions = 0, unsigned long long t_iSeed = 0)
+		: m_iDimensions(t_iDimensions),
+		m_viDirections(t_iDimensions * 32),
+		m_viShift(t_iDimensions, 0u)
+	{
+		if (t_iSeed != 0)
+		{
+			Philox generator(t_iSeed);
+			uint32_t words[4];
+			for (size_t d = 0; d < m_iDimensions; d++)
+			{
+				if (d % 4 == 0)
+				{
+					generator.block((uint32_t)(d / 4), 0u, 0u, 0u, words);
+				}
+				m_viShift[d] = words[d % 4];
+			}
+		}
+
+		for (unsigned int bit = 0; bit < 32 && m_iDimensions > 0; bit++)
+		{
+			m_viDirections[bit] = 1u << (31 - bit);
+		}
+
+		unsigned int degree = 1;
+		unsigned int coefficients = 0;
+		uint64_t state = 0x853C49E6748FEA9Bull;
+		for (size_t d = 1; d < m_iDimensions; d++)
+		{
+			uint32_t* v = m_viDirections.data() + d * 32;
+			if (d < joeKuoDimensions)
+			{
+				SobolInitial const& initial = joeKuo[d - 1];
+				degree = initial.degree;
+				coefficients = initial.coefficients;
+				for (unsigned int i = 0; i < degree; i++)
+				{
+					v[i] = (uint32_t)initial.m[i] << (31 - i);
+				}
+			}
+			else
+			{
+				// the next primitive polynomial after the table, with odd initial numbers below 2^(i + 1)
+				do
+				{
+					if (++coefficients == (1u << (degree - 1)))
+					{
+						degree++;
+						coefficients = 0;
+					}
+				} while (!primitive(degree, coefficients));
+				for (unsigned int i = 0; i < degree && i < 32; i++)
+				{
+					state = state * 6364136223846793005ull + 1442695040888963407ull;
+					uint32_t m = ((uint32_t)(state >> 33) & ((1u << (i + 1)) - 1)) | 1u;
+					v[i] = m << (31 - i);
+				}
+			}
+			for (unsigned int i = degree; i < 32; i++)
+			{
+				v[i] = v[i - degree] ^ (v[i - degree] >> degree);
+				for (unsigned int k = 1; k < degree; k++)
+				{
+					v[i] ^= ((coefficients >> (degree - 1 - k)) & 1u) * v[i - k];
+				}
+			}
+		}
+	}
+
+	size_t dimensions() const
+	{
+		return m_iDimensions;
+	}
+
+	// integer coordinates of point t_iIndex (the origin at index 0 without shift, usually skipped)
+	void integers(unsigned long long t_iIndex, uint32_t* out) const
+	{
+		unsigned long long gray = t_iIndex ^ (t_iIndex >> 1);
+		for (size_t d = 0; d < m_iDimensions; d++)
+		{
+			uint32_t const* v = m_viDirections.data() + d * 32;
+			uint32_t x = m_viShift[d];
+			for (unsigned int bit = 0; bit < 32 && (gray >> bit) != 0; bit++)
+			{
+				if ((gray >> bit) & 1u)
+				{
+					x ^= v[bit];
+				}
+			}
+			out[d] = x;
+		}
+	}
+
+	// point t_iIndex + 1 from the coordinates of point t_iIndex
+	void next(unsigned long long t_iIndex, uint32_t* t_viCoordinates) const
+	{
+		unsigned int bit = 0;
+		for (unsigned long long index = t_iIndex + 1; (index & 1u) == 0; index >>= 1)
+		{
+			bit++;
+		}
+		for (size_t d = 0; d < m_iDimensions; d++)
+		{
+			t_viCoordinates[d] ^= m_viDirections[d * 32 + bit];
+		}
+	}
+
+	// coordinates as uniforms in (0, 1), at the middle of their 2^-32 cell
+	void uniforms(uint32_t const* t_viCoordinates, Value* out) const
+	{
+		for (size_t d = 0; d < m_iDimensions; d++)
+		{
+			out[d] = (t_viCoordinates[d] + 0.5) * 0x1p-32;
+		}
+	}
+
+	void normals(uint32_t const* t_viCoordinates, Value* out) const
+	{
+		uniforms(t_viCoordinates, out);
+		inverseNormalBatch(out, out, m_iDimensions);
+	}
+
+private:
+	// x^degree + a_1 x^(degree - 1) + ... + a_(degree - 1) x + 1 is primitive over GF(2) when x has order 2^degree - 1
+	static bool primitive(unsigned int t_iDegree, unsigned int t_iCoefficients)
+	{
+		uint64_t polynomial = (1ull << t_iDegree) | ((uint64_t)t_iCoefficients << 1) | 1ull;
+		uint64_t order = (1ull << t_iDegree) - 1;
+		uint64_t power = 1;
+		for (uint64_t k = 1; k <= order; k++)
+		{
+			power <<= 1;
+			if ((power >> t_iDegree) & 1u)
+			{
+				power ^= polynomial;
+			}
+			if (power == 1)
+			{
+				return k == order;
+			}
+		}
+		return false;
+	}
+
+	size_t m_iDimensions;
+	std::vector<uint32_t> m_viDirections; // [dimension * 32 + bit]
+	std::vector<uint32_t> m_viShift;
+};
+
+// Brownian bridge over a time grid: the first normal draws the terminal value of the Brownian motion, the next
+// ones the midpoints of the remaining intervals, so that the leading dimensions of a low discrepancy sequence
+// carry most of the variance of the path. The output is the path as standard normal increments, one per step.
+class BrownianBridge
+{
+public:
+	BrownianBridge() {}
+	// increasing dates after 0
+	explicit BrownianBridge(std::vector<Time> const& t_vdDates)
+		: m_vdDates(t_vdDates)
+	{
+		size_t steps = m_vdDates.size();
+		m_viPoint.resize(steps);
+		m_viLeft.resize(steps);
+		m_viRight.resize(steps);
+		m_vdLeftWeight.resize(steps);
+		m_vdRightWeight.resize(steps);
+		m_vdStdDev.resize(steps);
+		m_vdStepStdDev.resize(steps);
+		if (steps == 0)
+		{
+			return;
+		}
+
+		std::vector<bool> filled(steps, false);
+		filled[steps - 1] = true;
+		m_viPoint[0] = steps - 1;
+		m_vdStdDev[0] = sqrt(m_vdDates[steps - 1]);
+
+		size_t j = 0;
+		for (size_t i = 1; i < steps; i++)
+		{
+			// next interval [j, k) of unfilled points, bounded by point j - 1 (or the origin) and point k
+			while (filled[j])
+			{
+				j = j + 1 == steps ? 0 : j + 1;
+			}
+			size_t k = j;
+			while (!filled[k])
+			{
+				k++;
+			}
+			size_t l = j + (k - 1 - j) / 2;
+			filled[l] = true;
+
+			Time left = j == 0 ? 0. : m_vdDates[j - 1];
+			Time middle = m_vdDates[l];
+			Time right = m_vdDates[k];
+			m_viPoint[i] = l;
+			m_viLeft[i] = j;
+			m_viRight[i] = k;
+			m_vdLeftWeight[i] = (right - middle) / (right - left);
+			m_vdRightWeight[i] = (middle - left) / (right - left);
+			m_vdStdDev[i] = sqrt((middle - left) * (right - middle) / (right - left));
+
+			j = k + 1;
+			if (j >= steps)
+			{
+				j = 0;
+			}
+		}
+
+		for (size_t k = 0; k < steps; k++)
+		{
+			m_vdStepStdDev[k] = sqrt(m_vdDates[k] - (k == 0 ? 0. : m_vdDates[k - 1]));
+		}
+	}
+
+	size_t size() const
+	{
+		return m_vdDates.size();
+	}
+
+	// t_vdNormals in bridge order to the normalized increments (W(t_k) - W(t_(k - 1))) / sqrt(t_k - t_(k - 1)),
+	// out of size() values, distinct from the input
+	void transform(Value const* t_vdNormals, Value* out) const
+	{
+		size_t steps = m_vdDates.size();
+		if (steps == 0)
+		{
+			return;
+		}
+		// the path itself first, in out
+		out[steps - 1] = m_vdStdDev[0] * t_vdNormals[0];
+		for (size_t i = 1; i < steps; i++)
+		{
+			size_t j = m_viLeft[i];
+			Value left = j == 0 ? 0. : m_vdLeftWeight[i] * out[j - 1];
+			out[m_viPoint[i]] = left + m_vdRightWeight[i] * out[m_viRight[i]] + m_vdStdDev[i] * t_vdNormals[i];
+		}
+		for (size_t k = steps - 1; k > 0; k--)
+		{
+			out[k] = (out[k] - out[k - 1]) / m_vdStepStdDev[k];
+		}
+		out[0] /= m_vdStepStdDev[0];
+	}
+
+private:
+	std::vector<Time> m_vdDates;
+	std::vector<size_t> m_viPoint;
+	std::vector<size_t> m_viLeft;
+	std::vector<size_t> m_viRight;
+	std::vector<Value> m_vdLeftWeight;
+	std::vector<Value> m_vdRightWeight;
+	std::vector<Value> m_vdStdDev;
+	std::vector<Value> m_vdStepStdDev;
+};
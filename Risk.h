@@ -0,0 +1,79 @@
+#pragma once
+
+#include "MultiCurve.h"
+
+using Time = double;
+using Value = double;
+
+// Bucketed DV01 of a book of swaps against the quotes of a calibrated MultiCurveStripper: swap k discounted on
+// curve t_viDiscountCurves[k] and forwarding on t_viForwardCurves[k] of the stripper (the curves its legs were
+// built on are not read). The gradient of every swap against the pillars comes from one reverse sweep of its
+// pricer on the compiled curves, then all of them go through the calibration in one adjoint solve (see
+// MultiCurveStripper::quoteSensitivities). Column k holds the change of swap k for every quote up 1bp, rows in
+// the order of the instruments.
+inline Matrix<Value> bucketedDV01(MultiCurveStripper& t_stripper,
+	std::vector<Swap> const& t_vSwaps,
+	std::vector<size_t> const& t_viDiscountCurves,
+	std::vector<size_t> const& t_viForwardCurves,
+	Time t_dPricingDate = 0.,
+	ThreadPool* t_pThreadPool = nullptr)
+{
+	std::vector<FrozenYieldCurve> curves;
+	for (size_t c = 0; c < t_stripper.size(); c++)
+	{
+		curves.push_back(t_stripper.getFrozenZeroCoupon(c));
+	}
+
+	Matrix<Value> gradients(t_stripper.unknowns(), t_vSwaps.size(), 0.);
+	auto sweep = [&](size_t t_iBegin, size_t t_iEnd)
+	{
+		SwapPricingBuffers buffers;
+		for (size_t k = t_iBegin; k < t_iEnd; k++)
+		{
+			size_t discount = t_viDiscountCurves[k];
+			size_t forward = t_viForwardCurves[k];
+			Value* gradient = gradients.column(k);
+			priceAdjoint(t_vSwaps[k], curves[discount].table(), curves[forward].table(), t_dPricingDate, 1E-4,
+				gradient + t_stripper.offset(discount), gradient + t_stripper.offset(forward), buffers);
+		}
+	};
+	if (t_pThreadPool)
+	{
+		t_pThreadPool->parallelFor(t_vSwaps.size(), sweep, 256);
+	}
+	else
+	{
+		sweep(0, t_vSwaps.size());
+	}
+
+	t_stripper.quoteSensitivities(gradients);
+	return gradients;
+}
+
+// DV01 of the whole book against every quote: the gradients of the swaps summed before the adjoint solve, so
+// that the calibration is gone through once whatever the size of the book
+inline std::vector<Value> portfolioDV01(MultiCurveStripper& t_stripper,
+	std::vector<Swap> const& t_vSwaps,
+	std::vector<size_t> const& t_viDiscountCurves,
+	std::vector<size_t> const& t_viForwardCurves,
+	Time t_dPricingDate = 0.)
+{
+	std::vector<FrozenYieldCurve> curves;
+	for (size_t c = 0; c < t_stripper.size(); c++)
+	{
+		curves.push_back(t_stripper.getFrozenZeroCoupon(c));
+	}
+
+	Matrix<Value> gradient(t_stripper.unknowns(), 1, 0.);
+	SwapPricingBuffers buffers;
+	for (size_t k = 0; k < t_vSwaps.size(); k++)
+	{
+		size_t discount = t_viDiscountCurves[k];
+		size_t forward = t_viForwardCurves[k];
+		priceAdjoint(t_vSwaps[k], curves[discount].table(), curves[forward].table(), t_dPricingDate, 1E-4,
+			gradient.column(0) + t_stripper.offset(discount), gradient.column(0) + t_stripper.offset(forward), buffers);
+	}
+
+	t_stripper.quoteSensitivities(gradient);
+	return std::vector<Value>(gradient.column(0), gradient.column(0) + t_stripper.unknowns());
+}
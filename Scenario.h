@@ -0,0 +1,286 @@
+#pragma once
+
+#include "HistoricalCalibration.h"
+
+using Time = double;
+using Value = double;
+
+enum ShiftType
+{
+	QUOTE_SHIFT,    //= the quotes of the curves move and the curves are stripped again, from the base curves
+	ZERO_RATE_SHIFT //= the zero rates of the pillars of the base curves move, without calibration
+};
+
+// One shock of the market: per curve of the ScenarioEngine, one shift per quote (or pillar, they are as many),
+// no shift for a curve left empty.
+struct Scenario
+{
+	std::string name;
+	ShiftType shiftType = QUOTE_SHIFT;
+	std::vector<std::vector<Value>> shifts;
+};
+
+// Revaluation of a book under many scenarios (historical moves of the quotes, stress shifts) against its value
+// on the base curves. The curves are defined as for the historical calibration (HistoricalCurve), the base
+// ones stripped from their base quotes; a quote scenario strips every curve again from the shifted quotes,
+// warm-started from the base curve, a zero rate scenario shifts the pillars of the base curves. The scenarios
+// are shared out between the threads of the pool, each one compiling its curves and pricing the books in place:
+// the trades are read from the books (SwapPortfolio, shared and never copied) and no Swap is built.
+class ScenarioEngine
+{
+public:
+
+	ScenarioEngine() {}
+
+	// Adds curve number size(), with its quotes on the base date.
+	size_t addCurve(HistoricalCurve t_curve, CurveQuotes t_quotes)
+	{
+		m_vCurves.push_back(t_curve);
+		m_vQuotes.push_back(t_quotes);
+		m_bCalibrated = false;
+		return m_vCurves.size() - 1;
+	}
+
+	// Adds a book priced on two of the curves, kept by reference. Its trades follow the trades of the books
+	// added before it in the P&L.
+	void addBook(SwapPortfolio const& t_portfolio, size_t t_iDiscountCurve, size_t t_iForwardCurve)
+	{
+		m_vBooks.push_back(Book{ &t_portfolio, t_iDiscountCurve, t_iForwardCurve, m_iTrades });
+		m_iTrades += t_portfolio.size();
+		m_bCalibrated = false;
+	}
+
+	size_t size() const
+	{
+		return m_vCurves.size();
+	}
+	size_t trades() const
+	{
+		return m_iTrades;
+	}
+
+	void setThreadPool(ThreadPool& t_threadPool)
+	{
+		m_pThreadPool = &t_threadPool;
+	}
+
+	// base curves and base prices of the trades on t_dPricingDate
+	void calibrate(Time t_dPricingDate = 0.)
+	{
+		m_dPricingDate = t_dPricingDate;
+		m_vBaseCurves.clear();
+		for (size_t c = 0; c < m_vCurves.size(); c++)
+		{
+			std::vector<Value> initialRates(m_vQuotes[c].maturities.size(), m_vCurves[c].initialRate);
+			Stripper<Swap> stripper = m_vCurves[c].stripper(m_vQuotes[c], initialRates, m_vBaseCurves);
+			stripper.calibrate(m_vCurves[c].calibrationMethod);
+			m_vBaseCurves.push_back(stripper.getZeroCoupon());
+		}
+
+		std::vector<FrozenYieldCurve> curves(m_vBaseCurves.begin(), m_vBaseCurves.end());
+		m_vdBasePrices.resize(m_iTrades);
+		SwapPricingBuffers buffers;
+		priceBooks(curves, m_vdBasePrices.data(), buffers);
+		m_bCalibrated = true;
+	}
+
+	YieldCurve const& getBaseCurve(size_t t_iCurve) const
+	{
+		return m_vBaseCurves[t_iCurve];
+	}
+	std::vector<Value> const& getBasePrices() const
+	{
+		return m_vdBasePrices;
+	}
+
+	// The P&L of the book under every scenario, and of every trade (trades() rows, a column per scenario) when
+	// t_pTradePnL is given.
+	std::vector<Value> run(std::vector<Scenario> const& t_vScenarios, Matrix<Value>* t_pTradePnL = nullptr)
+	{
+		if (!m_bCalibrated)
+		{
+			calibrate(m_dPricingDate);
+		}
+
+		std::vector<Value> bookPnL(t_vScenarios.size());
+		if (t_pTradePnL)
+		{
+			t_pTradePnL->resize(m_iTrades, t_vScenarios.size());
+		}
+		auto runScenarios = [&](size_t t_iBegin, size_t t_iEnd)
+		{
+			SwapPricingBuffers buffers;
+			std::vector<Value> prices(m_iTrades);
+			std::vector<FrozenYieldCurve> curves(m_vCurves.size());
+			for (size_t s = t_iBegin; s < t_iEnd; s++)
+			{
+				scenarioCurves(t_vScenarios[s], curves);
+				Value* tradePnL = t_pTradePnL ? t_pTradePnL->column(s) : prices.data();
+				priceBooks(curves, tradePnL, buffers);
+
+				Value pnl = 0.;
+				for (size_t k = 0; k < m_iTrades; k++)
+				{
+					tradePnL[k] -= m_vdBasePrices[k];
+					pnl += tradePnL[k];
+				}
+				bookPnL[s] = pnl;
+			}
+		};
+
+		if (m_pThreadPool)
+		{
+			m_pThreadPool->parallelFor(t_vScenarios.size(), runScenarios);
+		}
+		else
+		{
+			runScenarios(0, t_vScenarios.size());
+		}
+		return bookPnL;
+	}
+
+	// the same shift on every quote (or pillar) of every curve
+	Scenario parallelShift(std::string t_name, ShiftType t_shiftType, Value t_dShift) const
+	{
+		Scenario scenario{ t_name, t_shiftType, {} };
+		for (CurveQuotes const& quotes : m_vQuotes)
+		{
+			scenario.shifts.emplace_back(quotes.quotes.size(), t_dShift);
+		}
+		return scenario;
+	}
+
+	// Moves of the quotes over t_iHorizon dates of a history (quotes read by streamQuotes, say), one scenario per
+	// date: the quotes of the date minus the quotes t_iHorizon dates before, on the curves of the engine. Dates
+	// missing a curve, or quoting it on other maturities than the base date, give no scenario.
+	std::vector<Scenario> historicalScenarios(std::vector<QuoteDate> const& t_vDates, size_t t_iHorizon = 1) const
+	{
+		std::vector<Scenario> scenarios;
+		for (size_t d = t_iHorizon; d < t_vDates.size(); d++)
+		{
+			Scenario scenario{ std::to_string(t_vDates[d].date), QUOTE_SHIFT, {} };
+			for (size_t c = 0; c < m_vCurves.size(); c++)
+			{
+				CurveQuotes const* after = t_vDates[d].find(m_vCurves[c].name);
+				CurveQuotes const* before = t_vDates[d - t_iHorizon].find(m_vCurves[c].name);
+				if (!after || !before || after->maturities != m_vQuotes[c].maturities || before->maturities != m_vQuotes[c].maturities)
+				{
+					break;
+				}
+				std::vector<Value> shifts(after->quotes.size());
+				for (size_t i = 0; i < shifts.size(); i++)
+				{
+					shifts[i] = after->quotes[i] - before->quotes[i];
+				}
+				scenario.shifts.push_back(shifts);
+			}
+			if (scenario.shifts.size() == m_vCurves.size())
+			{
+				scenarios.push_back(scenario);
+			}
+		}
+		return scenarios;
+	}
+
+private:
+
+	struct Book
+	{
+		SwapPortfolio const* portfolio;
+		size_t discountCurve;
+		size_t forwardCurve;
+		size_t firstTrade;
+	};
+
+	// the curves of a scenario compiled into t_vCurves, reusing their storage
+	void scenarioCurves(Scenario const& t_scenario, std::vector<FrozenYieldCurve>& t_vCurves) const
+	{
+		std::vector<YieldCurve> curves;
+		bool moved = false;
+		for (size_t c = 0; c < m_vCurves.size(); c++)
+		{
+			bool shifted = c < t_scenario.shifts.size() && !t_scenario.shifts[c].empty();
+			YieldCurve const& base = m_vBaseCurves[c];
+			if (!shifted && (!moved || t_scenario.shiftType == ZERO_RATE_SHIFT))
+			{
+				curves.push_back(base);
+			}
+			else if (t_scenario.shiftType == ZERO_RATE_SHIFT)
+			{
+				std::vector<Value> interestRates = base.interestRates();
+				for (size_t k = 0; k < interestRates.size(); k++)
+				{
+					interestRates[k] += t_scenario.shifts[c][k];
+				}
+				curves.emplace_back(base.maturities(), interestRates, base.getInterpolationMethod());
+			}
+			else
+			{
+				// a curve stripped after shifted curves moves with them, even with its own quotes unchanged
+				CurveQuotes quotes = m_vQuotes[c];
+				for (size_t i = 0; shifted && i < quotes.quotes.size(); i++)
+				{
+					quotes.quotes[i] += t_scenario.shifts[c][i];
+				}
+				Stripper<Swap> stripper = m_vCurves[c].stripper(quotes, base.interestRates(), curves);
+				stripper.calibrate(m_vCurves[c].calibrationMethod);
+				curves.push_back(stripper.getZeroCoupon());
+			}
+			moved = moved || shifted;
+			if (!t_vCurves[c].compiledFrom(curves.back()))
+			{
+				t_vCurves[c].compile(curves.back());
+			}
+		}
+	}
+
+	void priceBooks(std::vector<FrozenYieldCurve> const& t_vCurves, Value* t_vdPrices, SwapPricingBuffers& t_buffers) const
+	{
+		for (Book const& book : m_vBooks)
+		{
+			price(*book.portfolio, t_vCurves[book.discountCurve], t_vCurves[book.forwardCurve], m_dPricingDate,
+				t_vdPrices + book.firstTrade, t_buffers);
+		}
+	}
+
+	std::vector<HistoricalCurve> m_vCurves;
+	std::vector<CurveQuotes> m_vQuotes;
+	std::vector<Book> m_vBooks;
+	size_t m_iTrades = 0;
+	ThreadPool* m_pThreadPool = nullptr;
+
+	bool m_bCalibrated = false;
+	Time m_dPricingDate = 0.;
+	std::vector<YieldCurve> m_vBaseCurves;
+	std::vector<Value> m_vdBasePrices;
+};
+
+// Loss not exceeded with probability t_dConfidence over the scenarios (historical VaR), a positive number
+// for a loss
+inline Value valueAtRisk(std::vector<Value> t_vdPnL, Value t_dConfidence = 0.99)
+{
+	if (t_vdPnL.empty())
+	{
+		return 0.;
+	}
+	size_t quantile = std::min((size_t)((1. - t_dConfidence) * t_vdPnL.size()), t_vdPnL.size() - 1);
+	std::nth_element(t_vdPnL.begin(), t_vdPnL.begin() + quantile, t_vdPnL.end());
+	return -t_vdPnL[quantile];
+}
+
+// average loss over the scenarios at or beyond the VaR (expected shortfall)
+inline Value expectedShortfall(std::vector<Value> t_vdPnL, Value t_dConfidence = 0.99)
+{
+	if (t_vdPnL.empty())
+	{
+		return 0.;
+	}
+	size_t quantile = std::min((size_t)((1. - t_dConfidence) * t_vdPnL.size()), t_vdPnL.size() - 1);
+	std::nth_element(t_vdPnL.begin(), t_vdPnL.begin() + quantile, t_vdPnL.end());
+	Value loss = 0.;
+	for (size_t i = 0; i <= quantile; i++)
+	{
+		loss -= t_vdPnL[i];
+	}
+	return loss / (quantile + 1);
+}
@@ -0,0 +1,384 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "MathTools.h"
+
+using Time = double;
+
+// Calendar date as a number of days since 1970-01-01 (proleptic Gregorian calendar).
+class Date
+{
+public:
+	Date() {}
+	explicit Date(int t_iSerial)
+		: m_iSerial(t_iSerial)
+	{}
+	Date(int t_iYear, int t_iMonth, int t_iDay)
+	{
+		// days from civil, eras of 400 years starting on March 1st
+		int year = t_iMonth <= 2 ? t_iYear - 1 : t_iYear;
+		int era = (year >= 0 ? year : year - 399) / 400;
+		int yearOfEra = year - era * 400;
+		int dayOfYear = (153 * (t_iMonth + (t_iMonth > 2 ? -3 : 9)) + 2) / 5 + t_iDay - 1;
+		int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+		m_iSerial = era * 146097 + dayOfEra - 719468;
+	}
+
+	// from yyyymmdd, as in the quote files
+	static Date fromYyyymmdd(int t_iDate)
+	{
+		return Date(t_iDate / 10000, t_iDate / 100 % 100, t_iDate % 100);
+	}
+
+	int serial() const
+	{
+		return m_iSerial;
+	}
+	int year() const
+	{
+		int year, month, day;
+		civil(year, month, day);
+		return year;
+	}
+	int month() const
+	{
+		int year, month, day;
+		civil(year, month, day);
+		return month;
+	}
+	int day() const
+	{
+		int year, month, day;
+		civil(year, month, day);
+		return day;
+	}
+	int yyyymmdd() const
+	{
+		int year, month, day;
+		civil(year, month, day);
+		return 10000 * year + 100 * month + day;
+	}
+
+	// 0 for Monday to 6 for Sunday
+	int weekday() const
+	{
+		return ((m_iSerial + 3) % 7 + 7) % 7;
+	}
+
+	static bool isLeapYear(int t_iYear)
+	{
+		return (t_iYear % 4 == 0 && t_iYear % 100 != 0) || t_iYear % 400 == 0;
+	}
+	static int daysInMonth(int t_iYear, int t_iMonth)
+	{
+		static constexpr int days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+		return t_iMonth == 2 && isLeapYear(t_iYear) ? 29 : days[t_iMonth - 1];
+	}
+	bool isEndOfMonth() const
+	{
+		int year, month, day;
+		civil(year, month, day);
+		return day == daysInMonth(year, month);
+	}
+
+	Date addDays(int t_iDays) const
+	{
+		return Date(m_iSerial + t_iDays);
+	}
+	// same day t_iMonths later, or the last day of a shorter month; the last day of the month when t_bEndOfMonth
+	// and this date is a month end
+	Date addMonths(int t_iMonths, bool t_bEndOfMonth = false) const
+	{
+		int year, month, day;
+		civil(year, month, day);
+		int months = year * 12 + month - 1 + t_iMonths;
+		int newYear = (months >= 0 ? months : months - 11) / 12;
+		int newMonth = months - newYear * 12 + 1;
+		int lastDay = daysInMonth(newYear, newMonth);
+		bool endOfMonth = t_bEndOfMonth && day == daysInMonth(year, month);
+		return Date(newYear, newMonth, endOfMonth ? lastDay : std::min(day, lastDay));
+	}
+
+	int operator-(Date const& t_date) const
+	{
+		return m_iSerial - t_date.m_iSerial;
+	}
+	bool operator==(Date const& t_date) const
+	{
+		return m_iSerial == t_date.m_iSerial;
+	}
+	bool operator!=(Date const& t_date) const
+	{
+		return m_iSerial != t_date.m_iSerial;
+	}
+	bool operator<(Date const& t_date) const
+	{
+		return m_iSerial < t_date.m_iSerial;
+	}
+	bool operator<=(Date const& t_date) const
+	{
+		return m_iSerial <= t_date.m_iSerial;
+	}
+	bool operator>(Date const& t_date) const
+	{
+		return m_iSerial > t_date.m_iSerial;
+	}
+	bool operator>=(Date const& t_date) const
+	{
+		return m_iSerial >= t_date.m_iSerial;
+	}
+
+private:
+	// civil from days
+	void civil(int& t_iYear, int& t_iMonth, int& t_iDay) const
+	{
+		int days = m_iSerial + 719468;
+		int era = (days >= 0 ? days : days - 146096) / 146097;
+		int dayOfEra = days - era * 146097;
+		int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+		int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+		int monthIndex = (5 * dayOfYear + 2) / 153;
+		t_iDay = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+		t_iMonth = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+		t_iYear = yearOfEra + era * 400 + (t_iMonth <= 2 ? 1 : 0);
+	}
+
+	int m_iSerial = 0;
+};
+
+enum CalendarType
+{
+	WEEKENDS_ONLY, //= Saturdays and Sundays
+	TARGET         //= weekends, January 1st, Good Friday, Easter Monday, May 1st, December 25th and 26th
+};
+
+enum BusinessDayConvention
+{
+	UNADJUSTED,
+	FOLLOWING,          //= next business day
+	MODIFIED_FOLLOWING, //= next business day, unless in the next month: previous business day
+	PRECEDING,          //= previous business day
+	MODIFIED_PRECEDING  //= previous business day, unless in the previous month: next business day
+};
+
+enum DayCountConvention
+{
+	ACT_360,
+	ACT_365_FIXED, //= also the time axis of the curves, from their reference date
+	THIRTY_360,    //= bond basis: day 31 becomes 30, on the second date only when the first one is a 30th or 31st
+	THIRTY_E_360   //= eurobond basis: day 31 always becomes 30
+};
+
+enum StubType
+{
+	SHORT_FRONT, //= dates rolled backward from the end date, the odd period first
+	SHORT_BACK   //= dates rolled forward from the start date, the odd period last
+};
+
+class Calendar
+{
+public:
+	Calendar(CalendarType t_calendarType = TARGET, std::vector<Date> t_vHolidays = {})
+		: m_calendarType(t_calendarType),
+		m_vHolidays(t_vHolidays)
+	{
+		std::sort(m_vHolidays.begin(), m_vHolidays.end());
+	}
+
+	bool isBusinessDay(Date t_date) const
+	{
+		if (t_date.weekday() >= 5 || std::binary_search(m_vHolidays.begin(), m_vHolidays.end(), t_date))
+		{
+			return false;
+		}
+		if (m_calendarType == TARGET)
+		{
+			int year = t_date.year();
+			int month = t_date.month();
+			int day = t_date.day();
+			if ((month == 1 && day == 1) || (month == 5 && day == 1) || (month == 12 && (day == 25 || day == 26)))
+			{
+				return false;
+			}
+			int fromEaster = t_date - easterSunday(year);
+			if (fromEaster == -2 || fromEaster == 1)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	Date adjust(Date t_date, BusinessDayConvention t_convention) const
+	{
+		if (t_convention == UNADJUSTED)
+		{
+			return t_date;
+		}
+		int step = t_convention == FOLLOWING || t_convention == MODIFIED_FOLLOWING ? 1 : -1;
+		Date adjusted = t_date;
+		while (!isBusinessDay(adjusted))
+		{
+			adjusted = adjusted.addDays(step);
+		}
+		if ((t_convention == MODIFIED_FOLLOWING || t_convention == MODIFIED_PRECEDING) && adjusted.month() != t_date.month())
+		{
+			adjusted = t_date;
+			while (!isBusinessDay(adjusted))
+			{
+				adjusted = adjusted.addDays(-step);
+			}
+		}
+		return adjusted;
+	}
+
+	// t_iDays business days later (earlier when negative)
+	Date advance(Date t_date, int t_iDays) const
+	{
+		int step = t_iDays >= 0 ? 1 : -1;
+		for (int i = 0; i != t_iDays; i += step)
+		{
+			do
+			{
+				t_date = t_date.addDays(step);
+			} while (!isBusinessDay(t_date));
+		}
+		return t_date;
+	}
+
+	// anonymous Gregorian algorithm
+	static Date easterSunday(int t_iYear)
+	{
+		int a = t_iYear % 19;
+		int b = t_iYear / 100;
+		int c = t_iYear % 100;
+		int d = b / 4;
+		int e = b % 4;
+		int f = (b + 8) / 25;
+		int g = (b - f + 1) / 3;
+		int h = (19 * a + b - d - g + 15) % 30;
+		int i = c / 4;
+		int k = c % 4;
+		int l = (32 + 2 * e + 2 * i - h - k) % 7;
+		int m = (a + 11 * h + 22 * l) / 451;
+		int month = (h + l - 7 * m + 114) / 31;
+		int day = (h + l - 7 * m + 114) % 31 + 1;
+		return Date(t_iYear, month, day);
+	}
+
+private:
+	CalendarType m_calendarType;
+	std::vector<Date> m_vHolidays;
+};
+
+inline Time yearFraction(Date t_start, Date t_end, DayCountConvention t_dayCount)
+{
+	switch (t_dayCount)
+	{
+	case ACT_360:
+		return (t_end - t_start) / 360.;
+	case ACT_365_FIXED:
+		return (t_end - t_start) / 365.;
+	default:
+	{
+		int startDay = t_start.day();
+		int endDay = t_end.day();
+		if (t_dayCount == THIRTY_E_360)
+		{
+			endDay = std::min(endDay, 30);
+		}
+		else if (endDay == 31 && startDay >= 30)
+		{
+			endDay = 30;
+		}
+		startDay = std::min(startDay, 30);
+		int days = 360 * (t_end.year() - t_start.year()) + 30 * (t_end.month() - t_start.month()) + endDay - startDay;
+		return days / 360.;
+	}
+	}
+}
+
+// Payment schedule of a leg, computed once per trade and shared by its copies: the start and payment times as
+// year fractions (ACT/365F) from the reference date of the curves, and the accrual fraction of every period.
+struct Schedule
+{
+	std::vector<Time> paymentTimes; // start, then the end of every period
+	std::vector<Time> accruals;     // period i runs from paymentTimes[i] to paymentTimes[i + 1]
+	std::vector<Date> dates;        // adjusted dates of paymentTimes, empty for schedules built on times
+
+	size_t periods() const
+	{
+		return accruals.size();
+	}
+};
+
+// t_iNbPayments dates evenly spaced from t_dStart to t_dEnd, as the swaps built on times always had
+// (linspace: a single date is the period from t_dStart to t_dEnd), every period accruing its length
+inline Schedule equalSchedule(Time t_dStart, Time t_dEnd, size_t t_iNbPayments)
+{
+	Schedule schedule;
+	schedule.paymentTimes = linspace<Time>(t_dStart, t_dEnd, t_iNbPayments);
+	if (schedule.paymentTimes.size() > 1)
+	{
+		schedule.accruals.assign(schedule.paymentTimes.size() - 1, schedule.paymentTimes[1] - schedule.paymentTimes[0]);
+	}
+	return schedule;
+}
+
+// Dates of a leg paying every t_iTenorMonths months from t_start to t_end (a single period when not positive),
+// rolled from the end or from the start date (t_stub) on the same day of the month, or on month ends
+// (t_bEndOfMonth and a month end anchor), then adjusted on t_calendar. Each period accrues on t_dayCount.
+inline Schedule makeSchedule(Date t_reference,
+	Date t_start,
+	Date t_end,
+	int t_iTenorMonths,
+	Calendar const& t_calendar,
+	BusinessDayConvention t_convention = MODIFIED_FOLLOWING,
+	DayCountConvention t_dayCount = ACT_360,
+	StubType t_stub = SHORT_FRONT,
+	bool t_bEndOfMonth = false)
+{
+	std::vector<Date> unadjusted{ t_start };
+	if (t_iTenorMonths > 0)
+	{
+		if (t_stub == SHORT_FRONT)
+		{
+			// rolled from the anchor rather than from the previous date, so that short months do not shift the day
+			std::vector<Date> backward;
+			for (int k = 1; t_end.addMonths(-k * t_iTenorMonths, t_bEndOfMonth) > t_start; k++)
+			{
+				backward.push_back(t_end.addMonths(-k * t_iTenorMonths, t_bEndOfMonth));
+			}
+			unadjusted.insert(unadjusted.end(), backward.rbegin(), backward.rend());
+		}
+		else
+		{
+			for (int k = 1; t_start.addMonths(k * t_iTenorMonths, t_bEndOfMonth) < t_end; k++)
+			{
+				unadjusted.push_back(t_start.addMonths(k * t_iTenorMonths, t_bEndOfMonth));
+			}
+		}
+	}
+	unadjusted.push_back(t_end);
+
+	Schedule schedule;
+	for (Date date : unadjusted)
+	{
+		Date adjusted = t_calendar.adjust(date, t_convention);
+		if (schedule.dates.empty() || adjusted > schedule.dates.back())
+		{
+			schedule.dates.push_back(adjusted);
+		}
+	}
+	for (size_t i = 0; i < schedule.dates.size(); i++)
+	{
+		schedule.paymentTimes.push_back(yearFraction(t_reference, schedule.dates[i], ACT_365_FIXED));
+		if (i > 0)
+		{
+			schedule.accruals.push_back(yearFraction(schedule.dates[i - 1], schedule.dates[i], t_dayCount));
+		}
+	}
+	return schedule;
+}
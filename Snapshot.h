@@ -0,0 +1,474 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Pricers.h"
+
+using Time = double;
+using Value = double;
+
+// Binary snapshot of quotes and calibrated curves, read in place from a memory mapping: the pages are shared
+// by every process mapping the file and a curve is priced on them without parsing or copying.
+//
+// Layout (version 1, little endian, every array 64 byte aligned):
+//   SnapshotHeader                      magic "XVACURVE", version, number of records, file size
+//   SnapshotRecord[records]             metadata of every curve and the byte offsets of its arrays
+//   arrays                              pillars and rates, the compiled segment table of FrozenYieldCurve,
+//                                       the maturities and values of the quotes the curve was stripped from
+// The compiled table is stored so that the mapped curve discounts through the same kernels as a
+// FrozenYieldCurve. Files are written and read on little endian hosts only.
+constexpr char snapshotMagic[8] = { 'X', 'V', 'A', 'C', 'U', 'R', 'V', 'E' };
+constexpr uint32_t snapshotVersion = 1;
+constexpr size_t snapshotAlignment = 64;
+
+struct SnapshotHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t records;
+	uint64_t fileSize;
+	uint64_t reserved[5];
+};
+static_assert(sizeof(SnapshotHeader) == 64, "snapshot header layout");
+
+struct SnapshotRecord
+{
+	char name[32];              // zero padded
+	int32_t date;               // yyyymmdd
+	uint32_t interpolationMethod;
+	uint32_t calibrationMethod;
+	uint32_t pillars;
+	uint32_t quotes;
+	uint32_t buckets;
+	double bucketWidth;
+	double largestResidual;     // largest repricing error of the quotes after calibration
+	uint64_t maturities;        // byte offsets of the arrays from the start of the file
+	uint64_t interestRates;
+	uint64_t segmentStart;      // pillars + 1 entries
+	uint64_t segmentValue;
+	uint64_t segmentSlope;
+	uint64_t bucketSegment;     // buckets + 1 unsigned 32 bit entries
+	uint64_t quoteMaturities;
+	uint64_t quoteValues;
+};
+static_assert(sizeof(SnapshotRecord) == 136, "snapshot record layout");
+
+inline bool hostIsLittleEndian()
+{
+	uint16_t one = 1;
+	unsigned char first = 0;
+	std::memcpy(&first, &one, 1);
+	return first == 1;
+}
+
+// a calibrated curve to write, with its metadata
+struct CurveSnapshot
+{
+	std::string name;
+	int date = 0;
+	YieldCurve curve;
+	CalibrationMethod calibrationMethod = NEWTON_RAPHSON;
+	std::vector<Time> quoteMaturities;
+	std::vector<Value> quotes;
+	Value largestResidual = 0.;
+};
+
+// Writes the curves to t_path. Returns false on a big endian host or when the file cannot be written.
+inline bool writeSnapshot(std::string const& t_path, std::vector<CurveSnapshot> const& t_vCurves)
+{
+	if (!hostIsLittleEndian())
+	{
+		return false;
+	}
+
+	std::vector<char> buffer(sizeof(SnapshotHeader) + t_vCurves.size() * sizeof(SnapshotRecord));
+	auto append = [&](void const* t_data, size_t t_bytes)
+	{
+		size_t offset = (buffer.size() + snapshotAlignment - 1) / snapshotAlignment * snapshotAlignment;
+		buffer.resize(offset + t_bytes);
+		if (t_bytes > 0)
+		{
+			std::memcpy(buffer.data() + offset, t_data, t_bytes);
+		}
+		return (uint64_t)offset;
+	};
+
+	std::vector<SnapshotRecord> records(t_vCurves.size());
+	FrozenYieldCurve frozen;
+	for (size_t c = 0; c < t_vCurves.size(); c++)
+	{
+		CurveSnapshot const& snapshot = t_vCurves[c];
+		SnapshotRecord& record = records[c];
+		std::memset(&record, 0, sizeof(record));
+		std::strncpy(record.name, snapshot.name.c_str(), sizeof(record.name) - 1);
+
+		frozen.compile(snapshot.curve);
+		SegmentTable table = frozen.table();
+		record.date = snapshot.date;
+		record.interpolationMethod = (uint32_t)table.interpolationMethod;
+		record.calibrationMethod = (uint32_t)snapshot.calibrationMethod;
+		record.pillars = (uint32_t)table.pillars;
+		record.quotes = (uint32_t)snapshot.quotes.size();
+		record.buckets = (uint32_t)table.buckets;
+		record.bucketWidth = table.bucketWidth;
+		record.largestResidual = snapshot.largestResidual;
+
+		std::vector<Value> const& interestRates = snapshot.curve.interestRates();
+		record.maturities = append(table.maturities, table.pillars * sizeof(Time));
+		record.interestRates = append(interestRates.data(), interestRates.size() * sizeof(Value));
+		record.segmentStart = append(table.segmentStart, (table.pillars + 1) * sizeof(Time));
+		record.segmentValue = append(table.segmentValue, (table.pillars + 1) * sizeof(Value));
+		record.segmentSlope = append(table.segmentSlope, (table.pillars + 1) * sizeof(Value));
+		record.bucketSegment = append(table.bucketSegment, (table.buckets + 1) * sizeof(uint32_t));
+		record.quoteMaturities = append(snapshot.quoteMaturities.data(), snapshot.quoteMaturities.size() * sizeof(Time));
+		record.quoteValues = append(snapshot.quotes.data(), snapshot.quotes.size() * sizeof(Value));
+	}
+	buffer.resize((buffer.size() + snapshotAlignment - 1) / snapshotAlignment * snapshotAlignment);
+
+	SnapshotHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+	header.version = snapshotVersion;
+	header.records = (uint32_t)records.size();
+	header.fileSize = buffer.size();
+	std::memcpy(buffer.data(), &header, sizeof(header));
+	if (!records.empty())
+	{
+		std::memcpy(buffer.data() + sizeof(header), records.data(), records.size() * sizeof(SnapshotRecord));
+	}
+
+	std::ofstream file(t_path, std::ios::binary | std::ios::trunc);
+	file.write(buffer.data(), (std::streamsize)buffer.size());
+	return (bool)file;
+}
+
+// Curve of a mapped snapshot: pointers into the mapping, valid as long as the SnapshotFile is open
+class MappedYieldCurve
+{
+public:
+	MappedYieldCurve(char const* t_base, SnapshotRecord const* t_record)
+		: m_base(t_base),
+		m_record(t_record)
+	{}
+
+	std::string name() const
+	{
+		return std::string(m_record->name, strnlen(m_record->name, sizeof(m_record->name)));
+	}
+	int date() const
+	{
+		return m_record->date;
+	}
+	CalibrationMethod calibrationMethod() const
+	{
+		return (CalibrationMethod)m_record->calibrationMethod;
+	}
+	Value largestResidual() const
+	{
+		return m_record->largestResidual;
+	}
+
+	size_t pillars() const
+	{
+		return m_record->pillars;
+	}
+	Time const* maturities() const
+	{
+		return array<Time>(m_record->maturities);
+	}
+	Value const* interestRates() const
+	{
+		return array<Value>(m_record->interestRates);
+	}
+	size_t quotes() const
+	{
+		return m_record->quotes;
+	}
+	Time const* quoteMaturities() const
+	{
+		return array<Time>(m_record->quoteMaturities);
+	}
+	Value const* quoteValues() const
+	{
+		return array<Value>(m_record->quoteValues);
+	}
+
+	// the compiled curve, in place
+	SegmentTable table() const
+	{
+		return SegmentTable{
+			(InterpolationType)m_record->interpolationMethod,
+			maturities(),
+			m_record->pillars,
+			array<Time>(m_record->segmentStart),
+			array<Value>(m_record->segmentValue),
+			array<Value>(m_record->segmentSlope),
+			array<unsigned int>(m_record->bucketSegment),
+			m_record->buckets,
+			m_record->bucketWidth };
+	}
+
+	Value discount(Time t) const
+	{
+		SegmentTable segments = table();
+		return discountOnSegment(segments, segmentOf(segments, t), t);
+	}
+
+	void discount(const Time* t, Value* out, size_t n, bool sorted = false) const
+	{
+		discountBatch(table(), t, out, n, sorted);
+	}
+
+	// copy of the curve, to strip it again or to price on active curves
+	YieldCurve yieldCurve() const
+	{
+		return YieldCurve(std::vector<Time>(maturities(), maturities() + pillars()),
+			std::vector<Value>(interestRates(), interestRates() + pillars()),
+			(InterpolationType)m_record->interpolationMethod);
+	}
+
+private:
+	template <typename T>
+	T const* array(uint64_t t_offset) const
+	{
+		return reinterpret_cast<T const*>(m_base + t_offset);
+	}
+
+	char const* m_base;
+	SnapshotRecord const* m_record;
+};
+
+Value price(Swap const& swapInstrument, MappedYieldCurve const& zcCurve, MappedYieldCurve const& forwardCurve, Time t_dPricingDate = 0.)
+{
+	thread_local SwapPricingBuffers buffers;
+	return price(swapInstrument, zcCurve.table(), forwardCurve.table(), t_dPricingDate, buffers);
+}
+
+// Read-only mapping of a snapshot file. open() checks the magic, the version, that every array lies in the
+// file and that the indexing fields of every curve are consistent, and returns false (leaving the object
+// closed) otherwise.
+class SnapshotFile
+{
+public:
+	SnapshotFile() {}
+	SnapshotFile(SnapshotFile const&) = delete;
+	SnapshotFile& operator=(SnapshotFile const&) = delete;
+	~SnapshotFile()
+	{
+		close();
+	}
+
+	bool open(std::string const& t_path)
+	{
+		close();
+		if (!hostIsLittleEndian() || !map(t_path) || !valid())
+		{
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close()
+	{
+		if (!m_pData)
+		{
+			return;
+		}
+#if defined(_WIN32)
+		UnmapViewOfFile(m_pData);
+#else
+		munmap(const_cast<char*>(m_pData), m_iSize);
+#endif
+		m_pData = nullptr;
+		m_iSize = 0;
+	}
+
+	bool isOpen() const
+	{
+		return m_pData != nullptr;
+	}
+
+	size_t size() const
+	{
+		return m_pData ? header().records : 0;
+	}
+
+	MappedYieldCurve operator[](size_t t_index) const
+	{
+		return MappedYieldCurve(m_pData, records() + t_index);
+	}
+
+	// index of the curve t_name of date t_date, or size() when there is none
+	size_t find(std::string const& t_name, int t_date) const
+	{
+		for (size_t c = 0; c < size(); c++)
+		{
+			SnapshotRecord const& record = records()[c];
+			if (record.date == t_date && t_name == std::string(record.name, strnlen(record.name, sizeof(record.name))))
+			{
+				return c;
+			}
+		}
+		return size();
+	}
+
+private:
+	bool map(std::string const& t_path)
+	{
+#if defined(_WIN32)
+		HANDLE file = CreateFileA(t_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		HANDLE mapping = nullptr;
+		if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+		{
+			mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		}
+		CloseHandle(file);
+		if (!mapping)
+		{
+			return false;
+		}
+		void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		if (!data)
+		{
+			return false;
+		}
+		m_pData = static_cast<char const*>(data);
+		m_iSize = (size_t)fileSize.QuadPart;
+#else
+		int file = ::open(t_path.c_str(), O_RDONLY);
+		if (file < 0)
+		{
+			return false;
+		}
+		struct stat status;
+		void* data = MAP_FAILED;
+		if (fstat(file, &status) == 0 && status.st_size > 0)
+		{
+			data = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_SHARED, file, 0);
+		}
+		::close(file);
+		if (data == MAP_FAILED)
+		{
+			return false;
+		}
+		m_pData = static_cast<char const*>(data);
+		m_iSize = (size_t)status.st_size;
+#endif
+		return true;
+	}
+
+	bool valid() const
+	{
+		if (m_iSize < sizeof(SnapshotHeader))
+		{
+			return false;
+		}
+		SnapshotHeader const& fileHeader = header();
+		if (std::memcmp(fileHeader.magic, snapshotMagic, sizeof(snapshotMagic)) != 0
+			|| fileHeader.version != snapshotVersion
+			|| fileHeader.fileSize != m_iSize
+			|| sizeof(SnapshotHeader) + (uint64_t)fileHeader.records * sizeof(SnapshotRecord) > m_iSize)
+		{
+			return false;
+		}
+
+		auto inFile = [&](uint64_t t_offset, uint64_t t_bytes)
+		{
+			return t_offset % sizeof(double) == 0 && t_offset <= m_iSize && t_bytes <= m_iSize - t_offset;
+		};
+		for (size_t c = 0; c < fileHeader.records; c++)
+		{
+			SnapshotRecord const& record = records()[c];
+			uint64_t pillars = record.pillars;
+			if (pillars == 0
+				|| !inFile(record.maturities, pillars * sizeof(Time))
+				|| !inFile(record.interestRates, pillars * sizeof(Value))
+				|| !inFile(record.segmentStart, (pillars + 1) * sizeof(Time))
+				|| !inFile(record.segmentValue, (pillars + 1) * sizeof(Value))
+				|| !inFile(record.segmentSlope, (pillars + 1) * sizeof(Value))
+				|| !inFile(record.bucketSegment, ((uint64_t)record.buckets + 1) * sizeof(uint32_t))
+				|| !inFile(record.quoteMaturities, (uint64_t)record.quotes * sizeof(Time))
+				|| !inFile(record.quoteValues, (uint64_t)record.quotes * sizeof(Value)))
+			{
+				return false;
+			}
+			if (!contentValid(record))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// the fields segmentOf and discountOnSegment index with: a known interpolation method, finite increasing
+	// maturities, a positive bucket width that maps every time of the curve to one of its buckets, and buckets
+	// pointing at segments of the curve. Called once the arrays are known to lie in the file.
+	bool contentValid(SnapshotRecord const& t_record) const
+	{
+		if (t_record.interpolationMethod > LOGLINEAR_ON_EXP_X_TIMES_Y
+			|| !std::isfinite(t_record.bucketWidth)
+			|| !(t_record.bucketWidth > 0.))
+		{
+			return false;
+		}
+
+		Time const* maturities = reinterpret_cast<Time const*>(m_pData + t_record.maturities);
+		for (size_t i = 0; i < t_record.pillars; i++)
+		{
+			if (!std::isfinite(maturities[i]) || (i > 0 && !(maturities[i - 1] <= maturities[i])))
+			{
+				return false;
+			}
+		}
+		if (maturities[t_record.pillars - 1] - maturities[0] > t_record.bucketWidth * ((double)t_record.buckets + 1.))
+		{
+			return false;
+		}
+
+		uint32_t const* bucketSegment = reinterpret_cast<uint32_t const*>(m_pData + t_record.bucketSegment);
+		for (size_t b = 0; b <= t_record.buckets; b++)
+		{
+			if (bucketSegment[b] > t_record.pillars)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	SnapshotHeader const& header() const
+	{
+		return *reinterpret_cast<SnapshotHeader const*>(m_pData);
+	}
+	SnapshotRecord const* records() const
+	{
+		return reinterpret_cast<SnapshotRecord const*>(m_pData + sizeof(SnapshotHeader));
+	}
+
+	char const* m_pData = nullptr;
+	size_t m_iSize = 0;
+};
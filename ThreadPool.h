@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool: every worker owns a queue of tasks, takes its newest task first and, once its queue is
+// empty, steals the oldest task of the other queues. The thread calling parallelFor works through the queued
+// tasks too until its loop is done, so that loops can be nested and a pool of one thread runs inline.
+class ThreadPool
+{
+public:
+	explicit ThreadPool(size_t t_threads = std::max(std::thread::hardware_concurrency(), 1u))
+	{
+		start(t_threads);
+	}
+	~ThreadPool()
+	{
+		stop();
+	}
+
+	ThreadPool(ThreadPool const&) = delete;
+	ThreadPool& operator=(ThreadPool const&) = delete;
+
+	// threads taking part in a loop, the calling one included
+	size_t size() const
+	{
+		return m_vWorkers.size() + 1;
+	}
+
+	void resize(size_t t_threads)
+	{
+		stop();
+		start(t_threads);
+	}
+
+	// t_body(begin, end) over chunks of [0, t_size) of at least t_grain indices. Results written by index
+	// do not depend on the number of threads nor on which thread ran which chunk.
+	template <class F>
+	void parallelFor(size_t t_size, F&& t_body, size_t t_grain = 1)
+	{
+		if (t_size == 0)
+		{
+			return;
+		}
+		// a few chunks per thread so that stealing evens out chunks of uneven cost
+		size_t chunk = std::max(t_grain, (t_size + 4 * size() - 1) / (4 * size()));
+		if (m_vWorkers.empty() || chunk >= t_size)
+		{
+			t_body(size_t(0), t_size);
+			return;
+		}
+
+		Batch batch;
+		batch.body = [&](size_t t_begin, size_t t_end) { t_body(t_begin, t_end); };
+		batch.remaining = (t_size + chunk - 1) / chunk;
+
+		size_t queue = m_iNextQueue++;
+		for (size_t begin = 0; begin < t_size; begin += chunk, queue++)
+		{
+			Queue& target = *m_vQueues[queue % m_vQueues.size()];
+			std::lock_guard<std::mutex> lock(target.mutex);
+			target.tasks.push_back(Task{ &batch, begin, std::min(begin + chunk, t_size) });
+			m_iQueued++;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+		}
+		m_wakeUp.notify_all();
+
+		while (batch.remaining.load(std::memory_order_acquire) > 0)
+		{
+			Task task;
+			if (tryPop(m_vQueues.size(), task))
+			{
+				run(task);
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+private:
+
+	struct Batch
+	{
+		std::function<void(size_t, size_t)> body;
+		std::atomic<size_t> remaining{ 0 };
+	};
+
+	struct Task
+	{
+		Batch* batch = nullptr;
+		size_t begin = 0;
+		size_t end = 0;
+	};
+
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	void start(size_t t_threads)
+	{
+		m_bStop = false;
+		size_t workers = t_threads > 1 ? t_threads - 1 : 0;
+		for (size_t i = 0; i < workers; i++)
+		{
+			m_vQueues.push_back(std::make_unique<Queue>());
+		}
+		for (size_t i = 0; i < workers; i++)
+		{
+			m_vWorkers.emplace_back([this, i] { work(i); });
+		}
+	}
+
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+			m_bStop = true;
+		}
+		m_wakeUp.notify_all();
+		for (std::thread& worker : m_vWorkers)
+		{
+			worker.join();
+		}
+		m_vWorkers.clear();
+		m_vQueues.clear();
+	}
+
+	void work(size_t t_index)
+	{
+		while (true)
+		{
+			Task task;
+			if (tryPop(t_index, task))
+			{
+				run(task);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_wakeUp.wait(lock, [&] { return m_bStop || m_iQueued.load() > 0; });
+			if (m_bStop && m_iQueued.load() == 0)
+			{
+				return;
+			}
+		}
+	}
+
+	// own queue from the back, then the other queues from the front (t_index past the end: steal only)
+	bool tryPop(size_t t_index, Task& t_task)
+	{
+		if (m_iQueued.load() == 0)
+		{
+			return false;
+		}
+		if (t_index < m_vQueues.size())
+		{
+			Queue& own = *m_vQueues[t_index];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (!own.tasks.empty())
+			{
+				t_task = own.tasks.back();
+				own.tasks.pop_back();
+				m_iQueued--;
+				return true;
+			}
+		}
+		for (size_t i = 1; i <= m_vQueues.size(); i++)
+		{
+			Queue& victim = *m_vQueues[(t_index + i) % m_vQueues.size()];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (!victim.tasks.empty())
+			{
+				t_task = victim.tasks.front();
+				victim.tasks.pop_front();
+				m_iQueued--;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static void run(Task const& t_task)
+	{
+		t_task.batch->body(t_task.begin, t_task.end);
+		t_task.batch->remaining.fetch_sub(1, std::memory_order_release);
+	}
+
+	std::vector<std::unique_ptr<Queue>> m_vQueues;
+	std::vector<std::thread> m_vWorkers;
+	std::atomic<size_t> m_iQueued{ 0 };
+	std::atomic<size_t> m_iNextQueue{ 0 };
+
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wakeUp;
+	bool m_bStop = false;
+};
+
+// pool shared by the pricers and the calibration, sized on the machine; resize() sets the thread count
+inline ThreadPool& threadPool()
+{
+	static ThreadPool pool;
+	return pool;
+}